@@ -102,16 +102,20 @@ void resolve_cat_option_conflicts(cat_options_t *opts) {
 /* Обработка файлов */
 int process_cat_files(const file_list_t *files, const cat_options_t *opts) {
   int result = SUCCESS;
+  escape_table_t escapes;
 
   if (!files || !opts) {
     return ERROR_MEMORY_ALLOCATION;
   }
 
+  build_escape_table(opts, &escapes);
+
   if (files->file_count == 0) {
-    result = process_single_cat_file("-", opts);
+    result = process_single_cat_file("-", opts, &escapes);
   } else {
     for (int i = 0; i < files->file_count; i++) {
-      int file_result = process_single_cat_file(files->files[i], opts);
+      int file_result =
+          process_single_cat_file(files->files[i], opts, &escapes);
       if (file_result != SUCCESS && result == SUCCESS) {
         result = file_result;
       }
@@ -122,16 +126,17 @@ int process_cat_files(const file_list_t *files, const cat_options_t *opts) {
 }
 
 /* Обработка одного файла */
-int process_single_cat_file(const char *filename, const cat_options_t *opts) {
+int process_single_cat_file(const char *filename, const cat_options_t *opts,
+                            const escape_table_t *escapes) {
   FILE *file;
   char *line = NULL;
   size_t line_capacity = 0;
   ssize_t line_length;
-  int line_counter = 1;
+  line_number_t line_counter;
   int empty_line_counter = 0;
   int result = SUCCESS;
 
-  if (!filename || !opts) {
+  if (!filename || !opts || !escapes) {
     return ERROR_MEMORY_ALLOCATION;
   }
 
@@ -140,9 +145,12 @@ int process_single_cat_file(const char *filename, const cat_options_t *opts) {
     return handle_file_error("cat", filename);
   }
 
+  init_line_number(&line_counter);
+
   while ((line_length = getline(&line, &line_capacity, file)) != -1) {
-    int process_result = process_file_line(line, line_length, opts,
-                                           &line_counter, &empty_line_counter);
+    int process_result =
+        process_file_line(line, line_length, opts, escapes, &line_counter,
+                          &empty_line_counter);
     if (process_result != SUCCESS && result == SUCCESS) {
       result = process_result;
     }
@@ -162,9 +170,9 @@ int process_single_cat_file(const char *filename, const cat_options_t *opts) {
 
 /* Обработка строки файла */
 int process_file_line(const char *line, size_t length,
-                      const cat_options_t *opts, int *line_counter,
-                      int *empty_line_counter) {
-  if (!line || !opts || !line_counter || !empty_line_counter) {
+                      const cat_options_t *opts, const escape_table_t *escapes,
+                      line_number_t *line_counter, int *empty_line_counter) {
+  if (!line || !opts || !escapes || !line_counter || !empty_line_counter) {
     return ERROR_MEMORY_ALLOCATION;
   }
 
@@ -182,22 +190,44 @@ int process_file_line(const char *line, size_t length,
 
   /* Нумерация строк */
   if ((opts->number_nonempty && !is_empty) || opts->number_all) {
-    print_line_number((*line_counter)++);
-  } else if (opts->number_all) {
-    (*line_counter)++;
+    print_line_number(line_counter);
   }
 
   /* Вывод содержимого строки */
-  for (size_t i = 0; i < length; i++) {
-    print_character_with_options((unsigned char)line[i], opts);
-  }
+  print_escaped(escapes, line, length);
 
   return SUCCESS;
 }
 
-/* Вывод номера строки */
-void print_line_number(int line_number) {
-  printf("%*d\t", LINE_NUMBER_WIDTH, line_number);
+/* Начальный номер строки: 1 */
+void init_line_number(line_number_t *number) {
+  memset(number->text, ' ', LINE_NUMBER_DIGITS);
+  number->text[LINE_NUMBER_DIGITS - 1] = '1';
+  number->text[LINE_NUMBER_DIGITS] = TAB_CHAR;
+  number->start = LINE_NUMBER_DIGITS - 1;
+  number->print = LINE_NUMBER_DIGITS - LINE_NUMBER_WIDTH;
+}
+
+/* Вывод номера строки и переход к следующему без printf: девятки справа
+   становятся нулями, перенос в новый разряд расширяет число влево */
+void print_line_number(line_number_t *number) {
+  int i = LINE_NUMBER_DIGITS - 1;
+
+  fwrite(number->text + number->print, 1,
+         (size_t)(LINE_NUMBER_DIGITS + 1 - number->print), stdout);
+
+  while (i >= number->start && number->text[i] == '9') {
+    number->text[i--] = '0';
+  }
+  if (i >= number->start) {
+    number->text[i]++;
+  } else if (i >= 0) {
+    number->text[i] = '1';
+    number->start = i;
+    if (number->print > i) {
+      number->print = i;
+    }
+  }
 }
 
 /* Проверка, нужно ли пропустить пустую строку */
@@ -210,29 +240,83 @@ int is_empty_line(const char *line, size_t length) {
   return (length == 1 && line[0] == NEWLINE_CHAR);
 }
 
-/* Вывод символа с учетом опций */
-void print_character_with_options(unsigned char c, const cat_options_t *opts) {
-  if (!opts) {
-    putchar(c);
+/* Запись байта c по правилам GNU cat */
+static void build_escape(unsigned char c, const cat_options_t *opts,
+                         cat_escape_t *escape) {
+  size_t length = 0;
+
+  if (c == NEWLINE_CHAR) {
+    if (opts->show_ends) {
+      escape->text[length++] = '$';
+    }
+    escape->text[length++] = (char)c;
+  } else if (c == TAB_CHAR) {
+    if (opts->show_tabs) {
+      escape->text[length++] = '^';
+      escape->text[length++] = 'I';
+    } else {
+      escape->text[length++] = (char)c;
+    }
+  } else if (opts->show_nonprinting) {
+    /* Байты со старшим битом: M- и запись байта без него (M-^I, M-^?) */
+    if (c >= HIGH_BIT_MASK) {
+      escape->text[length++] = 'M';
+      escape->text[length++] = '-';
+      c -= HIGH_BIT_MASK;
+    }
+    if (c < PRINTABLE_START) {
+      escape->text[length++] = '^';
+      escape->text[length++] = (char)(c + CTRL_OFFSET);
+    } else if (c == DEL_CHAR) {
+      escape->text[length++] = '^';
+      escape->text[length++] = '?';
+    } else {
+      escape->text[length++] = (char)c;
+    }
+  } else {
+    escape->text[length++] = (char)c;
+  }
+
+  escape->length = (unsigned char)length;
+}
+
+/* Построение таблицы замен */
+void build_escape_table(const cat_options_t *opts, escape_table_t *table) {
+  if (!opts || !table) {
     return;
   }
 
-  if (opts->show_ends && c == NEWLINE_CHAR) {
-    print_end_character();
-    putchar(c);
-  } else if (opts->show_tabs && c == TAB_CHAR) {
-    print_tab_character();
-  } else if (opts->show_nonprinting && c < PRINTABLE_START &&
-             c != NEWLINE_CHAR && c != TAB_CHAR) {
-    print_nonprinting_character(c);
-  } else if (opts->show_nonprinting && c >= HIGH_BIT_MASK &&
-             c <= CTRL_RANGE_END) {
-    print_extended_character(c);
-  } else if (opts->show_nonprinting && c >= EXTENDED_START) {
-    printf("M-%c", c - HIGH_BIT_MASK);
-  } else {
-    putchar(c);
+  memset(table, 0, sizeof(*table));
+  table->identity =
+      !opts->show_ends && !opts->show_tabs && !opts->show_nonprinting;
+  for (int c = 0; c < 256; c++) {
+    build_escape((unsigned char)c, opts, &table->bytes[c]);
+  }
+}
+
+/* Вывод данных через таблицу замен; вывод копится в буфере */
+void print_escaped(const escape_table_t *table, const char *data,
+                   size_t length) {
+  char buffer[ESCAPE_BUFFER_SIZE];
+  size_t used = 0;
+
+  if (table->identity) {
+    fwrite(data, 1, length, stdout);
+    return;
+  }
+
+  for (size_t i = 0; i < length; i++) {
+    const cat_escape_t *escape = &table->bytes[(unsigned char)data[i]];
+    if (used > ESCAPE_BUFFER_SIZE - sizeof(escape->text)) {
+      fwrite(buffer, 1, used, stdout);
+      used = 0;
+    }
+    /* Запись копируется целиком, буфер сдвигается на её длину */
+    memcpy(buffer + used, escape->text, sizeof(escape->text));
+    used += escape->length;
   }
+
+  fwrite(buffer, 1, used, stdout);
 }
 
 /* GNU long и short опции */
@@ -253,19 +337,3 @@ void preprocess_gnu_options(int argc, char *argv[]) {
         }
     }
 }
-
-/* Вывод символа табуляции */
-void print_tab_character(void) { printf("^I"); }
-
-/* Вывод символа конца строки */
-void print_end_character(void) { printf("$"); }
-
-/* Вывод непечатаемого символа */
-void print_nonprinting_character(unsigned char c) {
-  printf("^%c", c + CTRL_OFFSET);
-}
-
-/* Вывод расширенного символа */
-void print_extended_character(unsigned char c) {
-  printf("M-^%c", c - HIGH_BIT_MASK + CTRL_OFFSET);
-}
@@ -8,9 +8,31 @@
 #define NEWLINE_CHAR '\n'
 #define CTRL_OFFSET 64
 #define HIGH_BIT_MASK 128
-#define CTRL_RANGE_END 159
 #define PRINTABLE_START 32
-#define EXTENDED_START 160
+#define DEL_CHAR 127
+/* Буфер для вывода строки через таблицу замен */
+#define ESCAPE_BUFFER_SIZE 4096
+
+/* Запись байта при выводе: сам байт или его замена (^I, $, M-^X) */
+typedef struct {
+  char text[4];
+  unsigned char length;
+} cat_escape_t;
+
+/* Номер строки готовым текстом: цифры прибавляются на месте. Выводится
+   text + print: число с пробелами слева до LINE_NUMBER_WIDTH знаков и '\t' */
+#define LINE_NUMBER_DIGITS 20
+typedef struct {
+  char text[LINE_NUMBER_DIGITS + 1];
+  int start; /* Первая цифра */
+  int print; /* Начало вывода */
+} line_number_t;
+
+/* Записи всех 256 байтов, строятся один раз по опциям */
+typedef struct {
+  cat_escape_t bytes[256];
+  int identity; /* Замен нет: строка выводится как есть */
+} escape_table_t;
 
 /* Функции для парсинга аргументов */
 int parse_cat_arguments(int argc, char *argv[], cat_options_t *opts,
@@ -21,22 +43,22 @@ void resolve_cat_option_conflicts(cat_options_t *opts);
 
 /* Функции для обработки файлов */
 int process_cat_files(const file_list_t *files, const cat_options_t *opts);
-int process_single_cat_file(const char *filename, const cat_options_t *opts);
+int process_single_cat_file(const char *filename, const cat_options_t *opts,
+                            const escape_table_t *escapes);
 
 /* Функции для обработки содержимого */
 int process_file_line(const char *line, size_t length,
-                      const cat_options_t *opts, int *line_counter,
-                      int *empty_line_counter);
-void print_line_number(int line_number);
+                      const cat_options_t *opts, const escape_table_t *escapes,
+                      line_number_t *line_counter, int *empty_line_counter);
+void init_line_number(line_number_t *number);
+void print_line_number(line_number_t *number);
 int should_skip_empty_line(int empty_counter, int squeeze_blank);
 int is_empty_line(const char *line, size_t length);
 
 /* Функции для вывода символов */
-void print_character_with_options(unsigned char c, const cat_options_t *opts);
-void print_tab_character(void);
-void print_end_character(void);
-void print_nonprinting_character(unsigned char c);
-void print_extended_character(unsigned char c);
+void build_escape_table(const cat_options_t *opts, escape_table_t *table);
+void print_escaped(const escape_table_t *table, const char *data,
+                   size_t length);
 
 /* Функция для поддержки GNU опций */
 void preprocess_gnu_options(int argc, char *argv[]);
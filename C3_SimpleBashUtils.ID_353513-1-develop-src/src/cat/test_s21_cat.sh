@@ -81,6 +81,18 @@ run_test "Empty file" "" "$TEST_DIR/empty.txt" 0
 run_test "Mixed content with -b" "-b" "$TEST_DIR/mixed.txt" 0
 run_test "Mixed content with -s" "-s" "$TEST_DIR/mixed.txt" 0
 
+# Таблица замен: все 256 значений байта
+for i in $(seq 0 255); do printf "\\$(printf '%03o' $i)"; done \
+  > $TEST_DIR/all_bytes.bin
+run_test "All bytes with -e" "-e" "$TEST_DIR/all_bytes.bin" 0
+run_test "All bytes with -t" "-t" "$TEST_DIR/all_bytes.bin" 0
+run_test "All bytes with -e -t -n" "-e -t -n" "$TEST_DIR/all_bytes.bin" 0
+
+# Номера строк шире шести знаков
+seq 1 1000005 > $TEST_DIR/million.txt
+run_test "-n past six digits" "-n" "$TEST_DIR/million.txt" 0
+run_test "-b past six digits" "-b" "$TEST_DIR/million.txt" 0
+
 # Итоги
 echo "--------------------------------"
 echo "Total tests: $TEST_COUNT"
@@ -6,6 +6,7 @@
 int init_parse_structures(int argc, pattern_list_t *patterns,
                           char ***file_list) {
   patterns->pattern_count = 0;
+  patterns->capacity = argc;
   patterns->patterns = malloc(sizeof(char *) * argc);
   *file_list = malloc(sizeof(char *) * argc);
 
@@ -44,6 +45,9 @@ int parse_single_option(char option, grep_options_t *opts) {
     case 'o':
       opts->only_matching = 1;
       break;
+    case 'F':
+      opts->fixed_strings = 1;
+      break;
     default:
       fprintf(stderr, "grep: invalid option -- '%c'\n", option);
       return ERROR_GENERAL;
@@ -64,6 +68,19 @@ int parse_option_string(const char *option_str, grep_options_t *opts) {
 
 /* Добавление шаблона в список */
 int add_pattern_to_list(pattern_list_t *patterns, const char *pattern) {
+  /* Файл -f может содержать больше шаблонов, чем argc */
+  if (patterns->pattern_count >= patterns->capacity) {
+    int new_capacity = patterns->capacity * 2;
+    char **grown =
+        realloc(patterns->patterns, sizeof(char *) * (size_t)new_capacity);
+    if (!grown) {
+      fprintf(stderr, "grep: memory allocation failed\n");
+      return ERROR_MEMORY_ALLOCATION;
+    }
+    patterns->patterns = grown;
+    patterns->capacity = new_capacity;
+  }
+
   patterns->patterns[patterns->pattern_count] = strdup(pattern);
   if (!patterns->patterns[patterns->pattern_count]) {
     fprintf(stderr, "grep: memory allocation failed\n");
@@ -199,59 +216,289 @@ void safe_fclose_grep(FILE *fp, const char *filename) {
   }
 }
 
+/* Компиляция одного шаблона: литерал без метасимволов ищется без regex */
+int compile_single_pattern(const char *pattern, grep_options_t opts,
+                           compiled_patterns_t *compiled, int i) {
+  compiled->literals[i] = NULL;
+  compiled->literal_lengths[i] = 0;
+  compiled->in_multi[i] = 0;
+  compiled->empty_patterns[i] = (strlen(pattern) == 0);
+  if (compiled->empty_patterns[i]) {
+    return SUCCESS;
+  }
+
+  if (opts.fixed_strings) {
+    compiled->literals[i] = strdup(pattern);
+    if (!compiled->literals[i]) {
+      return ERROR_MEMORY_ALLOCATION;
+    }
+    compiled->literal_lengths[i] = strlen(pattern);
+  } else {
+    compiled->literals[i] =
+        extract_literal(pattern, &compiled->literal_lengths[i]);
+  }
+  /* Литерал с переводом строки остаётся за regex */
+  if (compiled->literals[i] &&
+      !memchr(compiled->literals[i], '\n', compiled->literal_lengths[i])) {
+    /* s21_memmem_icase() ждёт образец в нижнем регистре */
+    if (opts.ignore_case) {
+      ascii_fold(compiled->literals[i], compiled->literal_lengths[i]);
+    }
+    return SUCCESS;
+  }
+  free(compiled->literals[i]);
+  compiled->literals[i] = NULL;
+
+  char *regex_source = NULL;
+  if (opts.fixed_strings) {
+    regex_source = escape_literal(pattern);
+    if (!regex_source) {
+      return ERROR_MEMORY_ALLOCATION;
+    }
+  }
+
+  int flags = REG_EXTENDED;
+  if (opts.ignore_case) flags |= REG_ICASE;
+
+  int status = regcomp(&compiled->regexes[i],
+                       regex_source ? regex_source : pattern, flags);
+  free(regex_source);
+  if (status != 0) {
+    fprintf(stderr, "grep: invalid pattern\n");
+    return ERROR_GENERAL;
+  }
+  return SUCCESS;
+}
+
 /* Инициализация скомпилированных regex паттернов */
 int init_regex_patterns(pattern_list_t patterns, grep_options_t opts,
                         compiled_patterns_t *compiled) {
   compiled->regexes = malloc(sizeof(regex_t) * patterns.pattern_count);
   compiled->empty_patterns = malloc(sizeof(int) * patterns.pattern_count);
-  compiled->pattern_count = patterns.pattern_count;
-
-  if (!compiled->regexes || !compiled->empty_patterns) {
+  compiled->literals = malloc(sizeof(char *) * patterns.pattern_count);
+  compiled->literal_lengths = malloc(sizeof(size_t) * patterns.pattern_count);
+  compiled->in_multi = malloc(sizeof(int) * patterns.pattern_count);
+  compiled->separate = malloc(sizeof(int) * patterns.pattern_count);
+  compiled->only_start = malloc(sizeof(size_t) * patterns.pattern_count);
+  compiled->only_end = malloc(sizeof(size_t) * patterns.pattern_count);
+  compiled->pattern_count = 0;
+  compiled->separate_count = 0;
+  compiled->has_multi = 0;
+  compiled->has_empty = 0;
+  compiled->ignore_case = opts.ignore_case;
+
+  if (!compiled->regexes || !compiled->empty_patterns ||
+      !compiled->literals || !compiled->literal_lengths ||
+      !compiled->in_multi || !compiled->separate || !compiled->only_start ||
+      !compiled->only_end) {
     fprintf(stderr, "grep: memory allocation failed\n");
+    cleanup_regex_resources(compiled);
     return ERROR_MEMORY_ALLOCATION;
   }
 
   for (int i = 0; i < patterns.pattern_count; i++) {
-    compiled->empty_patterns[i] = (strlen(patterns.patterns[i]) == 0);
-
-    if (!compiled->empty_patterns[i]) {
-      int flags = REG_EXTENDED;
-      if (opts.ignore_case) flags |= REG_ICASE;
-
-      if (regcomp(&compiled->regexes[i], patterns.patterns[i], flags) != 0) {
-        fprintf(stderr, "grep: invalid pattern\n");
-        for (int j = 0; j < i; j++) {
-          if (!compiled->empty_patterns[j]) {
-            regfree(&compiled->regexes[j]);
-          }
-        }
-        free(compiled->regexes);
-        free(compiled->empty_patterns);
-        return ERROR_GENERAL;
+    int result =
+        compile_single_pattern(patterns.patterns[i], opts, compiled, i);
+    if (result != SUCCESS) {
+      if (result == ERROR_MEMORY_ALLOCATION) {
+        fprintf(stderr, "grep: memory allocation failed\n");
       }
+      cleanup_regex_resources(compiled);
+      return result;
+    }
+    compiled->pattern_count = i + 1;
+  }
+
+  build_multi_literal(compiled);
+
+  /* Шаблоны, которые проверяются по одному, а не общим автоматом */
+  for (int i = 0; i < compiled->pattern_count; i++) {
+    if (compiled->empty_patterns[i]) {
+      compiled->has_empty = 1;
+    } else if (!compiled->in_multi[i]) {
+      compiled->separate[compiled->separate_count++] = i;
     }
   }
   return SUCCESS;
 }
 
+/* Общий автомат по всем литералам, если их больше одного */
+void build_multi_literal(compiled_patterns_t *compiled) {
+  int count = 0;
+  for (int i = 0; i < compiled->pattern_count; i++) {
+    if (compiled->literals[i]) count++;
+  }
+  if (count < 2) {
+    return;
+  }
+
+  char **literals = malloc(sizeof(char *) * count);
+  size_t *lengths = malloc(sizeof(size_t) * count);
+  if (literals && lengths) {
+    int k = 0;
+    for (int i = 0; i < compiled->pattern_count; i++) {
+      if (compiled->literals[i]) {
+        literals[k] = compiled->literals[i];
+        lengths[k++] = compiled->literal_lengths[i];
+      }
+    }
+    /* Без памяти под автомат литералы ищутся по одному */
+    if (multi_literal_build(&compiled->multi, literals, lengths, count,
+                            compiled->ignore_case) == SUCCESS) {
+      compiled->has_multi = 1;
+      for (int i = 0; i < compiled->pattern_count; i++) {
+        compiled->in_multi[i] = compiled->literals[i] != NULL;
+      }
+    }
+  }
+  free(literals);
+  free(lengths);
+}
+
 /* Очистка ресурсов regex */
 void cleanup_regex_resources(compiled_patterns_t *compiled) {
+  if (compiled->has_multi) {
+    multi_literal_free(&compiled->multi);
+    compiled->has_multi = 0;
+  }
   for (int i = 0; i < compiled->pattern_count; i++) {
-    if (!compiled->empty_patterns[i]) {
+    if (compiled->literals[i]) {
+      free(compiled->literals[i]);
+    } else if (!compiled->empty_patterns[i]) {
       regfree(&compiled->regexes[i]);
     }
   }
   free(compiled->regexes);
   free(compiled->empty_patterns);
+  free(compiled->literals);
+  free(compiled->literal_lengths);
+  free(compiled->in_multi);
+  free(compiled->separate);
+  free(compiled->only_start);
+  free(compiled->only_end);
+  compiled->pattern_count = 0;
+  compiled->separate_count = 0;
 }
 
-/* Проверка совпадения строки с паттернами */
-int check_line_match(const char *line, compiled_patterns_t *compiled) {
+/* Поиск первого совпадения шаблона i в line[offset..length) */
+int find_pattern_match(const compiled_patterns_t *compiled, int i,
+                       const char *line, size_t length, size_t offset,
+                       regmatch_t *match) {
+  if (compiled->literals[i]) {
+    const char *found =
+        compiled->ignore_case
+            ? s21_memmem_icase(line + offset, length - offset,
+                               compiled->literals[i],
+                               compiled->literal_lengths[i])
+            : s21_memmem(line + offset, length - offset,
+                         compiled->literals[i], compiled->literal_lengths[i]);
+    if (!found) {
+      return 0;
+    }
+    match->rm_so = (regoff_t)(found - (line + offset));
+    match->rm_eo = match->rm_so + (regoff_t)compiled->literal_lengths[i];
+    return 1;
+  }
+  /* REG_STARTEND: символ перед offset виден regexec() как контекст для ^,
+   * границы возвращаются относительно offset, как у literals */
+  match->rm_so = (regoff_t)offset;
+  match->rm_eo = (regoff_t)length;
+  if (regexec(&compiled->regexes[i], line, 1, match, REG_STARTEND) != 0) {
+    return 0;
+  }
+  match->rm_so -= (regoff_t)offset;
+  match->rm_eo -= (regoff_t)offset;
+  return 1;
+}
+
+#define ONLY_NONE ((size_t)-1)    /* у шаблона больше нет совпадений */
+#define ONLY_UNKNOWN ((size_t)-2) /* совпадение ещё не искали */
+
+/* Ближайшее непустое совпадение шаблона i в line[from..length). После
+ * пустого совпадения (самого левого и самого длинного) непустое может
+ * начаться только за ним */
+static void next_nonempty_match(const compiled_patterns_t *compiled, int i,
+                                const char *line, size_t length, size_t from,
+                                size_t *start, size_t *end) {
+  regmatch_t match;
+  *start = ONLY_NONE;
+  while (from < length &&
+         find_pattern_match(compiled, i, line, length, from, &match)) {
+    if (match.rm_eo > match.rm_so) {
+      *start = from + (size_t)match.rm_so;
+      *end = from + (size_t)match.rm_eo;
+      return;
+    }
+    from += (size_t)match.rm_so + 1;
+  }
+}
+
+/* Следующее совпадение для -o по всем шаблонам сразу: самое левое, из них
+ * самое длинное. offset 0 начинает строку, дальше это конец предыдущего
+ * совпадения; ближайшие совпадения шаблонов запоминаются, поэтому каждый
+ * шаблон проходит строку один раз */
+int next_only_match(compiled_patterns_t *compiled, const char *line,
+                    size_t length, size_t offset, size_t *match_start,
+                    size_t *match_end) {
+  size_t *starts = compiled->only_start;
+  size_t *ends = compiled->only_end;
+  if (offset == 0) {
+    /* Без единого литерала общего автомата в строке они не ищутся */
+    size_t match_len;
+    int multi_found =
+        !compiled->has_multi ||
+        multi_literal_find(&compiled->multi, line, length, &match_len);
+    for (int i = 0; i < compiled->pattern_count; i++) {
+      int none = compiled->empty_patterns[i] ||
+                 (compiled->in_multi[i] && !multi_found);
+      starts[i] = none ? ONLY_NONE : ONLY_UNKNOWN;
+    }
+  }
+
+  int best = -1;
   for (int i = 0; i < compiled->pattern_count; i++) {
-    if (compiled->empty_patterns[i]) {
-      return 1;
+    if (starts[i] == ONLY_NONE) continue;
+    /* Совпадение до offset перекрыто уже выведенным */
+    if (starts[i] == ONLY_UNKNOWN || starts[i] < offset) {
+      next_nonempty_match(compiled, i, line, length, offset, &starts[i],
+                          &ends[i]);
+      if (starts[i] == ONLY_NONE) continue;
     }
-    if (regexec(&compiled->regexes[i], line, 0, NULL, 0) == 0) {
+    if (best < 0 || starts[i] < starts[best] ||
+        (starts[i] == starts[best] && ends[i] > ends[best])) {
+      best = i;
+    }
+  }
+  if (best < 0) {
+    return 0;
+  }
+  *match_start = starts[best];
+  *match_end = ends[best];
+  return 1;
+}
+
+/* Проверка совпадения строки с паттернами */
+int check_line_match(const char *line, size_t length,
+                     compiled_patterns_t *compiled) {
+  if (compiled->has_empty) {
+    return 1;
+  }
+
+  /* Все литералы проверяются одним проходом */
+  size_t match_len;
+  if (compiled->has_multi &&
+      multi_literal_find(&compiled->multi, line, length, &match_len)) {
+    return 1;
+  }
+
+  regmatch_t match;
+  for (int k = 0; k < compiled->separate_count; k++) {
+    int i = compiled->separate[k];
+    if (compiled->literals[i]) {
+      if (find_pattern_match(compiled, i, line, length, 0, &match)) {
+        return 1;
+      }
+    } else if (regexec(&compiled->regexes[i], line, 0, NULL, 0) == 0) {
       return 1;
     }
   }
@@ -293,43 +540,21 @@ int handle_only_matching(const char *line, size_t line_length,
                          compiled_patterns_t *compiled, grep_options_t opts,
                          const char *filename, int line_num,
                          int multiple_files) {
-  int matches = 0;
+  int matches = check_line_match(line, line_length, compiled);
 
   if (opts.invert_match) {
-    int line_matches = check_line_match(line, compiled);
-    return !line_matches;
+    return !matches;
   }
 
-  for (int i = 0; i < compiled->pattern_count; i++) {
-    if (compiled->empty_patterns[i]) {
-      matches = 1;
-      break;
-    }
-
-    regmatch_t match;
+  /* Строка засчитывается, даже если все её совпадения пустые */
+  if (matches && !opts.count_matches && !opts.list_files) {
+    size_t start, end;
     size_t offset = 0;
-    int line_has_matches = 0;
-
-    while (offset < line_length &&
-           regexec(&compiled->regexes[i], line + offset, 1, &match, 0) == 0) {
-      if (match.rm_so == match.rm_eo) {
-        offset++;
-        continue;
-      }
-
-      line_has_matches = 1;
-      matches = 1;
-
-      if (!opts.count_matches && !opts.list_files) {
-        print_match_prefix(filename, line_num, multiple_files, opts);
-        printf("%.*s\n", (int)(match.rm_eo - match.rm_so),
-               line + offset + match.rm_so);
-      }
-      offset += match.rm_eo;
-    }
-
-    if (line_has_matches) {
-      break;
+    while (next_only_match(compiled, line, line_length, offset, &start,
+                           &end)) {
+      print_match_prefix(filename, line_num, multiple_files, opts);
+      printf("%.*s\n", (int)(end - start), line + start);
+      offset = end;
     }
   }
 
@@ -338,7 +563,7 @@ int handle_only_matching(const char *line, size_t line_length,
 
 /* Основная функция обработки файла */
 int process_file(const char *filename, grep_options_t opts,
-                 pattern_list_t patterns, int multiple_files,
+                 compiled_patterns_t *compiled, int multiple_files,
                  int *error_occurred) {
   FILE *fp = safe_fopen_grep(filename, "r");
   if (!fp) {
@@ -349,12 +574,6 @@ int process_file(const char *filename, grep_options_t opts,
     return 0;
   }
 
-  compiled_patterns_t compiled;
-  if (init_regex_patterns(patterns, opts, &compiled) != SUCCESS) {
-    safe_fclose_grep(fp, filename);
-    exit(1);
-  }
-
   char *line = NULL;
   size_t len = 0;
   ssize_t read;
@@ -373,11 +592,11 @@ int process_file(const char *filename, grep_options_t opts,
     int matches = 0;
 
     if (opts.only_matching) {
-      matches = handle_only_matching(line, read, &compiled, opts, filename,
+      matches = handle_only_matching(line, read, compiled, opts, filename,
                                      line_num, multiple_files);
       if (matches) match_count++;
     } else {
-      matches = check_line_match(line, &compiled);
+      matches = check_line_match(line, read, compiled);
       if (opts.invert_match) matches = !matches;
 
       if (matches) {
@@ -396,7 +615,6 @@ int process_file(const char *filename, grep_options_t opts,
   }
 
   free(line);
-  cleanup_regex_resources(&compiled);
   safe_fclose_grep(fp, filename);
 
   return match_count;
@@ -412,6 +630,23 @@ void free_patterns(pattern_list_t *patterns) {
   free(patterns->patterns);
   patterns->patterns = NULL;
   patterns->pattern_count = 0;
+  patterns->capacity = 0;
+}
+
+/* Монотонное время в миллисекундах */
+double monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/* S21_GREP_STATS=1: время компиляции шаблонов */
+void print_compile_stats(int pattern_count, double compile_ms) {
+  const char *stats = getenv("S21_GREP_STATS");
+  if (stats && strcmp(stats, "0") != 0) {
+    fprintf(stderr, "grep: stats: %d patterns compiled in %.3f ms\n",
+            pattern_count, compile_ms);
+  }
 }
 
 /* Основная функция */
@@ -424,12 +659,22 @@ int main(int argc, char *argv[]) {
   grep_options_t opts = {0};
   char **files = NULL;
   int file_count = 0;
-  pattern_list_t patterns = {NULL, 0};
+  pattern_list_t patterns = {NULL, 0, 0};
   int error_occurred = 0;
   int total_matches_found = 0;
 
   parse_args(argc, argv, &opts, &files, &file_count, &patterns);
 
+  /* Шаблоны компилируются один раз и используются для всех файлов */
+  compiled_patterns_t compiled;
+  double compile_start = monotonic_ms();
+  if (init_regex_patterns(patterns, opts, &compiled) != SUCCESS) {
+    free_patterns(&patterns);
+    free(files);
+    return 2;
+  }
+  double compile_ms = monotonic_ms() - compile_start;
+
   // Подсчитываем количество существующих файлов
   int existing_files = 0;
   for (int i = 0; i < file_count; i++) {
@@ -453,15 +698,18 @@ int main(int argc, char *argv[]) {
 
   if (file_count == 0) {
     total_matches_found =
-        process_file("-", opts, patterns, multiple_files, &error_occurred);
+        process_file("-", opts, &compiled, multiple_files, &error_occurred);
   } else {
     for (int i = 0; i < file_count; i++) {
-      int file_matches = process_file(files[i], opts, patterns, multiple_files,
-                                      &error_occurred);
+      int file_matches = process_file(files[i], opts, &compiled,
+                                      multiple_files, &error_occurred);
       total_matches_found += file_matches;
     }
   }
 
+  print_compile_stats(compiled.pattern_count, compile_ms);
+
+  cleanup_regex_resources(&compiled);
   free_patterns(&patterns);
   free(files);
 
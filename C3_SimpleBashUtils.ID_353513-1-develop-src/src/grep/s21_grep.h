@@ -5,6 +5,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#include "s21_grep_ac.h"
+#include "s21_grep_literal.h"
 
 typedef struct {
   int ignore_case;    // -i: игнорировать регистр
@@ -15,24 +19,37 @@ typedef struct {
   int suppress_errors;  // -s: подавлять сообщения об ошибках
   int no_filename;  // -h: подавлять имена файлов
   int only_matching;  // -o: выводить только совпадающие части
+  int fixed_strings;  // -F: шаблоны - строки, а не регулярные выражения
 } grep_options_t;
 
 typedef struct {
   char **patterns;    // Массив шаблонов
   int pattern_count;  // Количество шаблонов
+  int capacity;       // Размер выделенного массива
 } pattern_list_t;
 
 typedef struct {
   regex_t *regexes;
   int *empty_patterns;
+  char **literals; /* литерал для поиска без regex или NULL */
+  size_t *literal_lengths;
+  int *in_multi;         /* литерал ищется общим автоматом */
+  multi_literal_t multi; /* все литералы набора, если их больше одного */
+  int has_multi;
+  int *separate; /* непустые шаблоны вне multi */
+  int separate_count;
+  int has_empty;   /* есть пустой шаблон: совпадает любая строка */
+  int ignore_case; /* -i для литералов */
   int pattern_count;
+  size_t *only_start; /* -o: ближайшее непустое совпадение шаблона */
+  size_t *only_end;
 } compiled_patterns_t;
 
 /* Основные функции */
 void parse_args(int argc, char *argv[], grep_options_t *opts, char ***files,
                 int *file_count, pattern_list_t *patterns);
 int process_file(const char *filename, grep_options_t opts,
-                 pattern_list_t patterns, int multiple_files,
+                 compiled_patterns_t *compiled, int multiple_files,
                  int *error_occurred);
 void free_patterns(pattern_list_t *patterns);
 
@@ -49,10 +66,20 @@ void cleanup_and_exit(pattern_list_t *patterns, char **file_list,
 int add_pattern_to_list(pattern_list_t *patterns, const char *pattern);
 
 /* Функции для обработки файлов */
+int compile_single_pattern(const char *pattern, grep_options_t opts,
+                           compiled_patterns_t *compiled, int i);
+void build_multi_literal(compiled_patterns_t *compiled);
 int init_regex_patterns(pattern_list_t patterns, grep_options_t opts,
                         compiled_patterns_t *compiled);
 void cleanup_regex_resources(compiled_patterns_t *compiled);
-int check_line_match(const char *line, compiled_patterns_t *compiled);
+int find_pattern_match(const compiled_patterns_t *compiled, int i,
+                       const char *line, size_t length, size_t offset,
+                       regmatch_t *match);
+int check_line_match(const char *line, size_t length,
+                     compiled_patterns_t *compiled);
+int next_only_match(compiled_patterns_t *compiled, const char *line,
+                    size_t length, size_t offset, size_t *match_start,
+                    size_t *match_end);
 int handle_only_matching(const char *line, size_t line_length,
                          compiled_patterns_t *compiled, grep_options_t opts,
                          const char *filename, int line_num,
@@ -65,6 +92,8 @@ void print_count_results(const char *filename, int match_count,
                          int multiple_files, grep_options_t opts);
 FILE *safe_fopen_grep(const char *filename, const char *mode);
 void safe_fclose_grep(FILE *fp, const char *filename);
+double monotonic_ms(void);
+void print_compile_stats(int pattern_count, double compile_ms);
 
 /* Константы */
 #define SUCCESS 0
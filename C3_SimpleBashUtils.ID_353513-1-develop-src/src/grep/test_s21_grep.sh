@@ -205,6 +205,23 @@ run_test_with_file "Flag -f with empty lines" "" "$TEST_DIR/patterns3.txt" "$TES
 run_test_with_file "Flag -f with -n" "-n" "$TEST_DIR/patterns1.txt" "$TEST_DIR/test1.txt" 0
 run_test_with_file "Flag -f with -c" "-c" "$TEST_DIR/patterns1.txt" "$TEST_DIR/test1.txt" 0
 
+# Шаблонов в файле больше, чем аргументов командной строки
+for i in $(seq 1 2000); do echo "id${i}x"; done > "$TEST_DIR/patterns_many.txt"
+echo "world" >> "$TEST_DIR/patterns_many.txt"
+run_test_with_file "Flag -f with many patterns" "-c" "$TEST_DIR/patterns_many.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+
+# Набор литералов: малый (упакованный префильтр) и большой (Ахо-Корасик)
+echo -e "foo\nqux\nWORLD" > "$TEST_DIR/patterns_small.txt"
+for i in $(seq 1 50); do echo "word$i"; done > "$TEST_DIR/patterns_large.txt"
+echo -e "hello\nbaz\nline" >> "$TEST_DIR/patterns_large.txt"
+run_test_with_file "Literal set (small)" "" "$TEST_DIR/patterns_small.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+run_test_with_file "Literal set (small) with -i" "-i" "$TEST_DIR/patterns_small.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+run_test_with_file "Literal set (large)" "-n" "$TEST_DIR/patterns_large.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+run_test_with_file "Literal set (large) with -i -c" "-i -c" "$TEST_DIR/patterns_large.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+run_test_with_file "Literal set (large) with -v" "-v" "$TEST_DIR/patterns_large.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+run_test_with_file "Literal set (large) with -l" "-l" "$TEST_DIR/patterns_large.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt $TEST_DIR/test3.txt" 0
+run_test_with_file "Literal set (large) with -o" "-o" "$TEST_DIR/patterns_large.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+
 # Тест -f с несуществующим файлом паттернов
 echo "Testing -f with non-existent pattern file..."
 $S21_GREP -f "nonexistent_patterns.txt" "$TEST_DIR/test1.txt" > s21_output.txt 2> s21_error.txt
@@ -229,6 +246,13 @@ run_test "Flag -o with multiple files" "-o" "hello" "$TEST_DIR/test1.txt $TEST_D
 run_test "Flag -o with -h" "-o -h" "hello" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
 run_test "Flag -o with regex" "-o" "H.*o" "$TEST_DIR/test1.txt" 0
 
+# -o по всем шаблонам сразу и пустые совпадения
+echo -e "abcd ab bcd\nxyz\n\nfoo.bar=12;baz=345" > "$TEST_DIR/only.txt"
+run_test "Flag -o overlapping patterns" "-o -e ab -e" "bcd" "$TEST_DIR/only.txt" 0
+run_test "Flag -o longest of patterns" "-o -e b -e" "abc" "$TEST_DIR/only.txt" 0
+run_test "Flag -o empty match only" "-o -c" "^$" "$TEST_DIR/only.txt" 0
+run_test "Flag -o anchored after match" "-o" "^ab" "$TEST_DIR/only.txt" 0
+
 # ИСПРАВЛЕНИЕ: Специальный тест для -o -v (должен не выводить ничего)
 ((TEST_COUNT++))
 echo "Running Test $TEST_COUNT: Flag -o with -v (should output nothing)"
@@ -251,6 +275,17 @@ else
   ((FAIL_COUNT++))
 fi
 
+# Тесты для флага -F и литеральных шаблонов
+echo -e "a.b\na+b\naxb\n(x)\nprice: 5\$\nhello.world" > "$TEST_DIR/literal.txt"
+run_test "Flag -F basic" "-F" "hello" "$TEST_DIR/test1.txt" 0
+run_test "Flag -F with metacharacters" "-F" "a.b" "$TEST_DIR/literal.txt" 0
+run_test "Flag -F with dollar" "-F" "5\$" "$TEST_DIR/literal.txt" 0
+run_test "Flag -F with -i" "-F -i" "HELLO" "$TEST_DIR/test1.txt" 0
+run_test "Flag -F with -o" "-F -o" "l" "$TEST_DIR/test1.txt" 0
+run_test "Flag -F with -v -c" "-F -v -c" "(x)" "$TEST_DIR/literal.txt" 0
+run_test "Escaped metacharacter literal" "" "hello\.world" "$TEST_DIR/literal.txt" 0
+run_test "Long literal pattern" "" "hello world test line" "$TEST_DIR/test1.txt" 1
+
 echo ""
 echo "=== COMPLEX COMBINATION TESTS ==="
 
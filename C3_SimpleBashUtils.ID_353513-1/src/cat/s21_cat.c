@@ -1,5 +1,9 @@
 #include "s21_cat.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 void parse_args(int argc, char *argv[], options_t *opts, char ***files,
                 int *file_count) {
   *file_count = 0;
@@ -8,7 +12,8 @@ void parse_args(int argc, char *argv[], options_t *opts, char ***files,
   // Подсчитываем файлы
   int potential_files = 0;
   for (int i = 1; i < argc; i++) {
-    if (argv[i][0] != '-') {
+    // "-" - тоже файл (stdin)
+    if (argv[i][0] != '-' || argv[i][1] == '\0') {
       potential_files++;
     }
   }
@@ -56,68 +61,422 @@ void parse_args(int argc, char *argv[], options_t *opts, char ***files,
   }
 }
 
-void print_char_with_options(unsigned char c, options_t opts) {
-  if (opts.show_ends && c == '\n') {
-    printf("$");
-    putchar(c);
-  } else if (opts.show_tabs && c == '\t') {
-    printf("^I");
-  } else if (opts.show_nonprinting && c < 32 && c != '\n' && c != '\t') {
-    printf("^%c", c + 64);
-  } else if (opts.show_nonprinting && c >= 128 && c <= 159) {
-    printf("M-^%c", c - 128 + 64);
-  } else if (opts.show_nonprinting && c >= 160) {
-    printf("M-%c", c - 128);
-  } else {
-    putchar(c);
+void build_escape_table(options_t opts, escape_table_t *table) {
+  memset(table, 0, sizeof(*table));
+  table->identity =
+      !opts.show_ends && !opts.show_tabs && !opts.show_nonprinting;
+  table->nonprinting = opts.show_nonprinting;
+  table->tab = opts.show_tabs ? ' ' : '\t';
+  table->newline = opts.show_ends ? ' ' : '\n';
+  for (int c = 0; c < 256; c++) {
+    cat_escape_t *escape = &table->bytes[c];
+    char *text = escape->text;
+    int n = 0;
+    if (c == '\n') {
+      if (opts.show_ends) text[n++] = '$';
+      text[n++] = '\n';
+    } else if (c == '\t' && opts.show_tabs) {
+      text[n++] = '^';
+      text[n++] = 'I';
+    } else if (c != '\t' && opts.show_nonprinting) {
+      // Как у GNU cat -v: M- для старшего бита, ^ для управляющих и DEL
+      int low = c;
+      if (low >= 128) {
+        text[n++] = 'M';
+        text[n++] = '-';
+        low -= 128;
+      }
+      if (low < 32 || low == 127) {
+        text[n++] = '^';
+        text[n++] = (char)(low == 127 ? '?' : low + 64);
+      } else {
+        text[n++] = (char)low;
+      }
+    } else {
+      text[n++] = (char)c;
+    }
+    escape->length = (unsigned char)n;
+    table->plain[c] = n == 1 && (unsigned char)text[0] == c;
   }
 }
 
-void process_file(const char *filename, options_t opts, int *error_occurred) {
-  FILE *fp = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
-  if (!fp) {
-    fprintf(stderr, "cat: %s: No such file or directory\n", filename);
-    *error_occurred = 1;
-    return;
+// Длина начального отрезка data из байтов, которые выводятся как есть.
+// Короткие отрезки (обычные для двоичных данных) проверяются по таблице,
+// длинные - по 16 байт.
+static size_t plain_run(const escape_table_t *table,
+                        const unsigned char *data, size_t length) {
+  size_t i = 0;
+  while (i < length && i < 16 && table->plain[data[i]]) i++;
+  if (i < 16) return i;
+#if defined(__SSE2__)
+  if (table->nonprinting) {
+    // Как есть выводятся 32..126 (в знаковом сравнении байты от 128
+    // отрицательны), а также '\t' и '\n', если их не заменяют -T и -E
+    const __m128i below = _mm_set1_epi8(31);
+    const __m128i above = _mm_set1_epi8(127);
+    const __m128i tab = _mm_set1_epi8(table->tab);
+    const __m128i newline = _mm_set1_epi8(table->newline);
+    for (; i + 16 <= length; i += 16) {
+      __m128i bytes = _mm_loadu_si128((const __m128i *)(data + i));
+      __m128i plain = _mm_and_si128(_mm_cmpgt_epi8(bytes, below),
+                                    _mm_cmplt_epi8(bytes, above));
+      plain = _mm_or_si128(plain, _mm_cmpeq_epi8(bytes, tab));
+      plain = _mm_or_si128(plain, _mm_cmpeq_epi8(bytes, newline));
+      unsigned special = (unsigned)_mm_movemask_epi8(plain) ^ 0xFFFFu;
+      if (special) return i + (size_t)__builtin_ctz(special);
+    }
   }
+#endif
+  while (i < length && table->plain[data[i]]) i++;
+  return i;
+}
 
-  char *line = NULL;
-  size_t len = 0;
-  ssize_t read;
-  int line_num = 1;
-  int consecutive_empty = 0;
+// Выводит data: отрезки обычных байтов копируются целиком, вместо
+// остальных байтов - их запись из таблицы. Вывод собирается в буфер и
+// уходит в stdout одним fwrite() на буфер.
+static void print_escaped(const escape_table_t *table, const char *data,
+                          size_t length) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  char out[CAT_ESCAPE_BUFFER];
+  size_t used = 0;
+  size_t pos = 0;
+  while (pos < length) {
+    if (used > CAT_ESCAPE_BUFFER - sizeof(cat_escape_t)) {
+      fwrite_unlocked(out, 1, used, stdout);
+      used = 0;
+    }
+    const cat_escape_t *escape = &table->bytes[bytes[pos]];
+    if (!table->plain[bytes[pos]]) {
+      // Все записи копируются по 4 байта, буфер сдвигается на длину записи
+      memcpy(out + used, escape->text, sizeof(escape->text));
+      used += escape->length;
+      pos++;
+      continue;
+    }
+    size_t run = plain_run(table, bytes + pos, length - pos);
+    if (run > CAT_ESCAPE_BUFFER - used) {
+      fwrite_unlocked(out, 1, used, stdout);
+      fwrite_unlocked(bytes + pos, 1, run, stdout);
+      used = 0;
+    } else {
+      memcpy(out + used, bytes + pos, run);
+      used += run;
+    }
+    pos += run;
+  }
+  fwrite_unlocked(out, 1, used, stdout);
+}
 
-  while ((read = getline(&line, &len, fp)) != -1) {
-    // Определяем, пустая ли строка
-    int is_empty = (read == 1 && line[0] == '\n');
+void line_number_init(line_number_t *number) {
+  memset(number->text, ' ', CAT_NUMBER_DIGITS);
+  number->text[CAT_NUMBER_DIGITS - 1] = '1';
+  number->text[CAT_NUMBER_DIGITS] = '\t';
+  number->start = CAT_NUMBER_DIGITS - 1;
+  number->print = CAT_NUMBER_DIGITS - CAT_NUMBER_WIDTH;
+}
 
-    // Обработка флага -s (сжатие пустых строк)
-    if (opts.squeeze_blank && is_empty) {
-      consecutive_empty++;
-      if (consecutive_empty > 1) {
-        continue;  // Пропускаем лишние пустые строки
-      }
-    } else {
-      consecutive_empty = is_empty ? 1 : 0;
+// Прибавляет 1 к десятичной записи: девятки справа становятся нулями, а
+// перенос в новый разряд сдвигает начало числа влево
+void line_number_next(line_number_t *number) {
+  int i = CAT_NUMBER_DIGITS - 1;
+  while (i >= number->start && number->text[i] == '9') {
+    number->text[i--] = '0';
+  }
+  if (i >= number->start) {
+    number->text[i]++;
+  } else if (i >= 0) {
+    number->text[i] = '1';
+    number->start = i;
+    if (number->print > i) number->print = i;
+  }
+}
+
+static void print_line_number(line_number_t *number) {
+  fwrite_unlocked(number->text + number->print, 1,
+                  (size_t)(CAT_NUMBER_DIGITS + 1 - number->print), stdout);
+  line_number_next(number);
+}
+
+// Отрезок для вывода без -s и нумерации: до CAT_BUFFER_SIZE байт, по
+// возможности до конца строки. Конец отрезка читается первым (memrchr()
+// или чтение последнего байта): если файл укоротили, SIGBUS придёт до
+// вывода.
+static size_t plain_piece(const char *data, size_t size) {
+  if (size <= CAT_BUFFER_SIZE) {
+    (void)*(const volatile char *)(data + size - 1);
+    return size;
+  }
+  const char *newline = memrchr(data, '\n', CAT_BUFFER_SIZE);
+  return newline ? (size_t)(newline - data) + 1 : CAT_BUFFER_SIZE;
+}
+
+// Длина строки с '\n' или всего остатка, если строка не кончается в нём
+static size_t line_length(const char *data, size_t size) {
+  const char *newline = memchr(data, '\n', size);
+  return newline ? (size_t)(newline - data) + 1 : size;
+}
+
+// Длина отрезка до следующей пустой строки (-s без нумерации)
+static size_t until_blank(const char *data, size_t size) {
+  const char *blank = memmem(data, size, "\n\n", 2);
+  return blank ? (size_t)(blank - data) + 1 : size;
+}
+
+// Вывод отрезка в ядрах: как есть или через таблицу замен
+static void write_plain(const cat_state_t *state, const char *data,
+                        size_t length) {
+  (void)state;
+  fwrite_unlocked(data, 1, length, stdout);
+}
+
+static void write_escaped(const cat_state_t *state, const char *data,
+                          size_t length) {
+  print_escaped(state->escapes, data, length);
+}
+
+// Ядро вывода блока data[0..size) для одного набора опций. NUMBER_ALL
+// (-n), NUMBER_NONEMPTY (-b) и SQUEEZE (-s) - константы 0 или 1, WRITE -
+// write_plain или write_escaped (-e, -t), поэтому в каждом ядре остаются
+// только нужные проверки. Блок может начинаться и кончаться посреди строки
+// или серии пустых строк: что выведено до него, хранит state. Серия '\n' в
+// начале строки - пустые строки - выводится за раз, остальное - отрезками:
+// строкой, если строки нумеруются, иначе всем до следующей пустой строки
+// или до CAT_BUFFER_SIZE байт. После каждого отрезка в *done - его конец.
+#define CAT_KERNEL(name, NUMBER_ALL, NUMBER_NONEMPTY, SQUEEZE, WRITE) \
+  static void name(cat_state_t *state, const char *data, size_t size,  \
+                   volatile size_t *done) {                            \
+    size_t pos = 0;                                                    \
+    while (pos < size) {                                               \
+      const char *rest = data + pos;                                   \
+      size_t left = size - pos;                                        \
+      size_t len;                                                      \
+      if (!(NUMBER_ALL) && !(NUMBER_NONEMPTY) && !(SQUEEZE)) {         \
+        len = plain_piece(rest, left);                                 \
+      } else if (state->mid_line) {                                    \
+        len = line_length(rest, left);                                 \
+      } else if (rest[0] == '\n') {                                    \
+        size_t run = 1;                                                \
+        while (run < left && rest[run] == '\n') run++;                 \
+        size_t count = (SQUEEZE) ? !state->after_blank : run;          \
+        state->after_blank = 1;                                        \
+        for (size_t i = 0; (NUMBER_ALL) && i < count; i++) {           \
+          print_line_number(&state->line_num);                         \
+          WRITE(state, rest, 1);                                       \
+        }                                                              \
+        if (!(NUMBER_ALL)) WRITE(state, rest, count);                  \
+        pos += run;                                                    \
+        *done = pos;                                                   \
+        continue;                                                      \
+      } else if ((NUMBER_ALL) || (NUMBER_NONEMPTY)) {                  \
+        state->after_blank = 0;                                        \
+        len = line_length(rest, left);                                 \
+        print_line_number(&state->line_num);                           \
+      } else {                                                         \
+        state->after_blank = 0;                                        \
+        len = until_blank(rest, left);                                 \
+      }                                                                \
+      WRITE(state, rest, len);                                         \
+      state->mid_line = rest[len - 1] != '\n';                         \
+      pos += len;                                                      \
+      *done = pos;                                                     \
+    }                                                                  \
+  }
+
+// Имя ядра: n - -n, b - -b, s - -s, e - замены -e/-t
+CAT_KERNEL(cat_kernel_plain, 0, 0, 0, write_plain)
+CAT_KERNEL(cat_kernel_e, 0, 0, 0, write_escaped)
+CAT_KERNEL(cat_kernel_s, 0, 0, 1, write_plain)
+CAT_KERNEL(cat_kernel_se, 0, 0, 1, write_escaped)
+CAT_KERNEL(cat_kernel_n, 1, 0, 0, write_plain)
+CAT_KERNEL(cat_kernel_ne, 1, 0, 0, write_escaped)
+CAT_KERNEL(cat_kernel_ns, 1, 0, 1, write_plain)
+CAT_KERNEL(cat_kernel_nse, 1, 0, 1, write_escaped)
+CAT_KERNEL(cat_kernel_b, 0, 1, 0, write_plain)
+CAT_KERNEL(cat_kernel_be, 0, 1, 0, write_escaped)
+CAT_KERNEL(cat_kernel_bs, 0, 1, 1, write_plain)
+CAT_KERNEL(cat_kernel_bse, 0, 1, 1, write_escaped)
+
+// Ядра по [нумерация: нет, -n, -b][-s][-e/-t]. Из шести полей options_t
+// вывод по-разному ведут только эти: -e и -t различаются лишь таблицей
+// замен, а -b отменяет -n.
+static const cat_kernel_t cat_kernels[3][2][2] = {
+    {{cat_kernel_plain, cat_kernel_e}, {cat_kernel_s, cat_kernel_se}},
+    {{cat_kernel_n, cat_kernel_ne}, {cat_kernel_ns, cat_kernel_nse}},
+    {{cat_kernel_b, cat_kernel_be}, {cat_kernel_bs, cat_kernel_bse}},
+};
+
+cat_kernel_t select_kernel(options_t opts, const escape_table_t *escapes) {
+  int number = opts.number_nonempty ? 2 : opts.number_all ? 1 : 0;
+  return cat_kernels[number][opts.squeeze_blank != 0][!escapes->identity];
+}
+
+// Читает fd блоками до конца. Возвращает 0 или errno.
+static int cat_stream(int fd, cat_state_t *state) {
+  char *buffer = malloc(CAT_BUFFER_SIZE);
+  if (!buffer) return ENOMEM;
+  int error = 0;
+  volatile size_t done = 0;
+  for (;;) {
+    ssize_t got = read(fd, buffer, CAT_BUFFER_SIZE);
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) {
+      if (got < 0) error = errno;
+      break;
     }
+    state->kernel(state, buffer, (size_t)got, &done);
+  }
+  free(buffer);
+  return error;
+}
+
+// Выводит отображённый файл. Возвращает 0 или 1, если файл укоротили во
+// время вывода: тогда в resume - смещение первого невыведенного байта, с
+// которого его нужно дочитать потоком.
+static int cat_mapped(const input_map_t *map, cat_state_t *state,
+                      size_t *resume) {
+  sigjmp_buf env;
+  volatile size_t done = 0;
+  INPUT_ARM_FAULT(env);
+  if (sigsetjmp(env, 1) != 0) {
+    *resume = done;
+    return 1;
+  }
+  // Каждый отрезок прочитан до вывода (memchr, memmem, memrchr), поэтому
+  // SIGBUS не оставляет его выведенным наполовину
+  state->kernel(state, map->data, map->size, &done);
+  INPUT_RELEASE_FAULT();
+  return 0;
+}
 
-    // Нумерация строк
-    if ((opts.number_nonempty && !is_empty) || opts.number_all) {
-      printf("%6d\t", line_num++);
-    } else if (opts.number_all) {
-      line_num++;
+// Ни одна опция не меняет вывод: файл копируется как есть
+static int passthrough(options_t opts) {
+  return !opts.number_all && !opts.number_nonempty && !opts.squeeze_blank &&
+         !opts.show_ends && !opts.show_tabs && !opts.show_nonprinting;
+}
+
+// Способы копирования внутри ядра, от самого быстрого
+typedef enum { COPY_FILE_RANGE, COPY_SENDFILE, COPY_SPLICE } copy_method_t;
+
+static ssize_t copy_chunk(copy_method_t method, int in_fd) {
+  switch (method) {
+    case COPY_FILE_RANGE:
+      return copy_file_range(in_fd, NULL, STDOUT_FILENO, NULL,
+                             CAT_COPY_CHUNK, 0);
+    case COPY_SENDFILE:
+      return sendfile(STDOUT_FILENO, in_fd, NULL, CAT_COPY_CHUNK);
+    default:
+      return splice(in_fd, NULL, STDOUT_FILENO, NULL, CAT_COPY_CHUNK,
+                    SPLICE_F_MOVE | SPLICE_F_MORE);
+  }
+}
+
+// Копирует in_fd до конца способом method. Возвращает 0, errno или -1,
+// если способ не подходит для этих файлов. Все способы двигают позиции
+// файлов, поэтому следующий способ продолжает с того же места.
+static int copy_with(copy_method_t method, int in_fd) {
+  for (;;) {
+    ssize_t copied = copy_chunk(method, in_fd);
+    if (copied > 0) continue;
+    if (copied == 0) return 0;
+    if (errno == EINTR) continue;
+    if (errno == EINVAL || errno == ENOSYS || errno == EXDEV ||
+        errno == EOPNOTSUPP || errno == EBADF) {
+      return -1;
     }
+    return errno;
+  }
+}
 
-    // Обработка содержимого строки
-    for (ssize_t i = 0; i < read; i++) {
-      print_char_with_options((unsigned char)line[i], opts);
+static int copy_buffered(int in_fd) {
+  char *buffer = malloc(CAT_BUFFER_SIZE);
+  if (!buffer) return ENOMEM;
+  int error = 0;
+  for (;;) {
+    ssize_t got = read(in_fd, buffer, CAT_BUFFER_SIZE);
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) {
+      if (got < 0) error = errno;
+      break;
+    }
+    for (ssize_t written = 0; written < got && !error;) {
+      ssize_t put = write(STDOUT_FILENO, buffer + written,
+                          (size_t)(got - written));
+      if (put >= 0) {
+        written += put;
+      } else if (errno != EINTR) {
+        error = errno;
+      }
     }
+    if (error) break;
   }
+  free(buffer);
+  return error;
+}
 
-  if (line) {
-    free(line);
+// Копирует in_fd в stdout без преобразований: copy_file_range() между
+// обычными файлами, sendfile() из обычного файла, splice() через канал,
+// иначе read()/write() большими блоками. Файлы нулевого размера (как в
+// /proc) читаются только через read(). Возвращает 0 или errno.
+static int cat_passthrough(int in_fd) {
+  struct stat in_st, out_st;
+  if (fstat(in_fd, &in_st) != 0 || fstat(STDOUT_FILENO, &out_st) != 0) {
+    return errno;
+  }
+  int from_file = S_ISREG(in_st.st_mode) && in_st.st_size > 0;
+  int error = -1;
+  if (from_file && S_ISREG(out_st.st_mode)) {
+    error = copy_with(COPY_FILE_RANGE, in_fd);
+  }
+  if (error < 0 && from_file) error = copy_with(COPY_SENDFILE, in_fd);
+  if (error < 0 && (S_ISFIFO(in_st.st_mode) || S_ISFIFO(out_st.st_mode))) {
+    error = copy_with(COPY_SPLICE, in_fd);
   }
-  if (fp != stdin) fclose(fp);
+  return error < 0 ? copy_buffered(in_fd) : error;
+}
+
+static void report_error(const char *filename, int error,
+                         int *error_occurred) {
+  if (!error) return;
+  fprintf(stderr, "cat: %s: %s\n", filename, strerror(error));
+  *error_occurred = 1;
+}
+
+void process_file(const char *filename, cat_state_t *state,
+                  input_mode_t input_mode, int *error_occurred) {
+  int is_stdin = strcmp(filename, "-") == 0;
+  if (passthrough(state->opts)) {
+    int fd = is_stdin ? STDIN_FILENO : open(filename, O_RDONLY);
+    if (fd >= 0) {
+      fflush(stdout);
+      int error = cat_passthrough(fd);
+      if (!is_stdin) close(fd);
+      report_error(filename, error, error_occurred);
+      return;
+    }
+  }
+  if (is_stdin) {
+    report_error(filename, cat_stream(STDIN_FILENO, state), error_occurred);
+    return;
+  }
+
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "cat: %s: No such file or directory\n", filename);
+    *error_occurred = 1;
+    return;
+  }
+  input_map_t map;
+  if (input_map(fd, input_mode, &map) == 0) {
+    size_t resume = 0;
+    int faulted = cat_mapped(&map, state, &resume);
+    input_unmap(&map);
+    if (!faulted || lseek(fd, (off_t)resume, SEEK_SET) < 0) {
+      close(fd);
+      return;
+    }
+  }
+  report_error(filename, cat_stream(fd, state), error_occurred);
+  close(fd);
 }
 
 int main(int argc, char *argv[]) {
@@ -128,11 +487,20 @@ int main(int argc, char *argv[]) {
 
   parse_args(argc, argv, &opts, &files, &file_count);
 
+  escape_table_t escapes;
+  build_escape_table(opts, &escapes);
+  cat_state_t state = {.opts = opts,
+                       .escapes = &escapes,
+                       .kernel = select_kernel(opts, &escapes)};
+  line_number_init(&state.line_num);
+  input_mode_t input_mode = input_mode_from_env();
+  if (input_mode != INPUT_STREAM) input_install_fault_handler();
+
   if (file_count == 0) {
-    process_file("-", opts, &error_occurred);
+    process_file("-", &state, input_mode, &error_occurred);
   } else {
     for (int i = 0; i < file_count; i++) {
-      process_file(files[i], opts, &error_occurred);
+      process_file(files[i], &state, input_mode, &error_occurred);
     }
     free(files);
   }
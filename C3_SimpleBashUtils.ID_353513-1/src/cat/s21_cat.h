@@ -1,9 +1,26 @@
 #ifndef S21_CAT_H
 #define S21_CAT_H
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../common/s21_input.h"
+
+// Без опций: сколько байт просить у ядра за один вызов копирования и
+// размер буфера для копирования через read()/write()
+#define CAT_COPY_CHUNK (1 << 30)
+#define CAT_BUFFER_SIZE (128 * 1024)
+// Буфер строки с заменёнными байтами (-v, -e, -t)
+#define CAT_ESCAPE_BUFFER (64 * 1024)
+// Номер строки: до 20 цифр (весь uint64_t), не меньше 6 знаков, как у GNU
+#define CAT_NUMBER_DIGITS 20
+#define CAT_NUMBER_WIDTH 6
 
 typedef struct {
   int number_all;       // -n: нумеровать все строки
@@ -14,9 +31,58 @@ typedef struct {
   int show_nonprinting;  // -e, -t: показывать непечатаемые символы
 } options_t;
 
+// Как выводится байт: сам байт или его запись (^X, M-X, M-^X, ^I, $\n)
+typedef struct {
+  char text[4];
+  unsigned char length;
+} cat_escape_t;
+
+// Запись каждого байта для заданных -v, -E и -T; строится один раз за
+// запуск. plain[c] - байт выводится как есть, такие байты копируются
+// отрезками.
+typedef struct {
+  cat_escape_t bytes[256];
+  unsigned char plain[256];
+  int identity;     // Ни один байт не меняется
+  int nonprinting;  // -v: меняются байты вне 32..126, кроме '\t' и '\n'
+  char tab;         // '\t' или ' ', если '\t' заменяется (для SIMD)
+  char newline;     // '\n' или ' ', если '\n' заменяется
+} escape_table_t;
+
+// Номер строки готовым текстом: цифры прибавляются на месте, без printf().
+// Выводится text[print..] - цифры с пробелами слева до CAT_NUMBER_WIDTH
+// знаков и '\t'.
+typedef struct {
+  char text[CAT_NUMBER_DIGITS + 1];
+  int start;  // Первая цифра
+  int print;  // Начало вывода: start, но не правее ширины GNU
+} line_number_t;
+
+typedef struct cat_state cat_state_t;
+
+// Ядро вывода блока, собранное для одного набора опций (см. CAT_KERNEL)
+typedef void (*cat_kernel_t)(cat_state_t *state, const char *data,
+                             size_t size, volatile size_t *done);
+
+// Состояние вывода, переходящее от строки к строке и от файла к файлу:
+// файлы выводятся одним потоком, как у GNU cat
+struct cat_state {
+  options_t opts;
+  const escape_table_t *escapes;
+  cat_kernel_t kernel;     // Выбирается один раз по опциям
+  line_number_t line_num;  // Номер следующей строки (-n, -b)
+  int after_blank;         // Последняя строка была пустой (-s)
+  int mid_line;  // Вывод остановился посреди строки: блок или файл кончился
+                 // без '\n'
+};
+
 void parse_args(int argc, char *argv[], options_t *opts, char ***files,
                 int *file_count);
-void process_file(const char *filename, options_t opts, int *error_occurred);
-void print_char_with_options(unsigned char c, options_t opts);
+void build_escape_table(options_t opts, escape_table_t *table);
+cat_kernel_t select_kernel(options_t opts, const escape_table_t *escapes);
+void line_number_init(line_number_t *number);
+void line_number_next(line_number_t *number);
+void process_file(const char *filename, cat_state_t *state,
+                  input_mode_t input_mode, int *error_occurred);
 
 #endif
\ No newline at end of file
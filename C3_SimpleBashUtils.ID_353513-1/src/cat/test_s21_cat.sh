@@ -81,6 +81,91 @@ run_test "Empty file" "" "$TEST_DIR/empty.txt" 0
 run_test "Mixed content with -b" "-b" "$TEST_DIR/mixed.txt" 0
 run_test "Mixed content with -s" "-s" "$TEST_DIR/mixed.txt" 0
 
+# Обычные файлы читаются через mmap; S21_MMAP переключает способ чтения
+seq 1 200000 > $TEST_DIR/large.txt
+printf "no newline\tat end" > $TEST_DIR/no_newline.txt
+run_test "Large file with -n (mmap)" "-n" "$TEST_DIR/large.txt" 0
+run_test "No trailing newline with -e (mmap)" "-e -t" "$TEST_DIR/no_newline.txt" 0
+S21_CAT="env S21_MMAP=0 ./s21_cat"
+run_test "Large file with -n (read)" "-n" "$TEST_DIR/large.txt" 0
+run_test "No trailing newline with -e (read)" "-e -t" "$TEST_DIR/no_newline.txt" 0
+S21_CAT="env S21_MMAP=huge ./s21_cat"
+run_test "Large file with -b (huge pages)" "-b" "$TEST_DIR/large.txt" 0
+S21_CAT="./s21_cat"
+
+# Без опций файл копируется ядром: copy_file_range() в файл, sendfile() и
+# splice() в канал, read()/write() для остального. Вывод сравнивается
+# побайтно с GNU cat.
+run_copy_test() {
+  local test_name="$1"
+  local s21_command="$2"
+  local gnu_command="$3"
+
+  ((TEST_COUNT++))
+  echo "Running Test $TEST_COUNT: $test_name"
+  eval "$s21_command" > s21_output.txt 2> s21_error.txt
+  eval "$gnu_command" > gnu_output.txt 2> gnu_error.txt
+  if cmp -s s21_output.txt gnu_output.txt; then
+    echo "PASS"
+    ((SUCCESS_COUNT++))
+  else
+    echo "FAIL: Copied output differs"
+    ((FAIL_COUNT++))
+  fi
+}
+
+head -c 3000000 /dev/urandom > $TEST_DIR/random.bin
+run_test "No flags, binary file" "" "$TEST_DIR/random.bin" 0
+run_copy_test "No flags, into a pipe" "$S21_CAT $TEST_DIR/random.bin | cat" \
+  "$GNU_CAT $TEST_DIR/random.bin"
+run_copy_test "No flags, pipe to pipe" \
+  "$GNU_CAT $TEST_DIR/random.bin | $S21_CAT - | cat" \
+  "$GNU_CAT $TEST_DIR/random.bin"
+run_copy_test "No flags, several files and stdin" \
+  "$S21_CAT $TEST_DIR/large.txt - $TEST_DIR/random.bin < $TEST_DIR/test1.txt" \
+  "$GNU_CAT $TEST_DIR/large.txt - $TEST_DIR/random.bin < $TEST_DIR/test1.txt"
+run_copy_test "No flags, appending" \
+  "$GNU_CAT $TEST_DIR/test1.txt; $S21_CAT $TEST_DIR/large.txt >> s21_output.txt" \
+  "$GNU_CAT $TEST_DIR/test1.txt $TEST_DIR/large.txt"
+run_copy_test "No flags, /proc file" "$S21_CAT /proc/version" \
+  "$GNU_CAT /proc/version"
+
+# Таблица замен: все 256 значений байта и длинная строка из двоичных данных
+for i in $(seq 0 255); do printf "\\$(printf '%03o' $i)"; done \
+  > $TEST_DIR/all_bytes.bin
+tr -d '\n' < $TEST_DIR/random.bin | head -c 300000 > $TEST_DIR/long_line.bin
+run_test "All bytes with -e" "-e" "$TEST_DIR/all_bytes.bin" 0
+run_test "All bytes with -t" "-t" "$TEST_DIR/all_bytes.bin" 0
+run_test "All bytes with -e -t -n" "-e -t -n" "$TEST_DIR/all_bytes.bin" 0
+run_test "Binary file with -e -t" "-e -t" "$TEST_DIR/random.bin" 0
+run_test "Long binary line with -t" "-t" "$TEST_DIR/long_line.bin" 0
+
+# Номера строк: ширина растёт после 999999, файлы нумеруются одним потоком
+seq 1 1000005 > $TEST_DIR/million.txt
+printf '\n\nlast' > $TEST_DIR/blank_tail.txt
+run_test "-n past six digits" "-n" "$TEST_DIR/million.txt" 0
+run_test "-b past six digits" "-b" "$TEST_DIR/million.txt" 0
+run_copy_test "-n across files" \
+  "$S21_CAT -n $TEST_DIR/test1.txt $TEST_DIR/blank_tail.txt $TEST_DIR/mixed.txt" \
+  "$GNU_CAT -n $TEST_DIR/test1.txt $TEST_DIR/blank_tail.txt $TEST_DIR/mixed.txt"
+run_copy_test "-b -s across files" \
+  "$S21_CAT -b -s $TEST_DIR/empty_lines.txt $TEST_DIR/blank_tail.txt - < $TEST_DIR/empty_lines.txt" \
+  "$GNU_CAT -b -s $TEST_DIR/empty_lines.txt $TEST_DIR/blank_tail.txt - < $TEST_DIR/empty_lines.txt"
+
+# Серии пустых строк длиннее блока чтения (-s, -b, -n обрабатывают блоками)
+{ echo first; head -c 300000 /dev/zero | tr '\0' '\n'; echo -e "mid\n\n\nlast"; } \
+  > $TEST_DIR/blank_runs.txt
+run_copy_test "-s long blank run (read)" \
+  "S21_MMAP=0 $S21_CAT -s $TEST_DIR/blank_runs.txt" \
+  "$GNU_CAT -s $TEST_DIR/blank_runs.txt"
+run_copy_test "-b long blank run (read)" \
+  "S21_MMAP=0 $S21_CAT -b $TEST_DIR/blank_runs.txt" \
+  "$GNU_CAT -b $TEST_DIR/blank_runs.txt"
+run_copy_test "-s -n -e blank runs from a pipe" \
+  "$GNU_CAT $TEST_DIR/blank_runs.txt | $S21_CAT -s -n -e - $TEST_DIR/blank_runs.txt" \
+  "$GNU_CAT -s -n -e $TEST_DIR/blank_runs.txt $TEST_DIR/blank_runs.txt"
+run_test "Directory with -s" "-s" "$TEST_DIR" 1
+
 # Итоги
 echo "--------------------------------"
 echo "Total tests: $TEST_COUNT"
@@ -0,0 +1,66 @@
+#include "s21_input.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+_Thread_local sigjmp_buf *input_fault_jump = NULL;
+
+input_mode_t input_mode_from_env(void) {
+  const char *mode = getenv("S21_MMAP");
+  if (!mode) return INPUT_MMAP;
+  if (strcmp(mode, "0") == 0) return INPUT_STREAM;
+  if (strcmp(mode, "huge") == 0) return INPUT_MMAP_HUGE;
+  return INPUT_MMAP;
+}
+
+int input_map(int fd, input_mode_t mode, input_map_t *map) {
+  map->data = NULL;
+  map->size = 0;
+  if (mode == INPUT_STREAM) return 1;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+    return 1;
+  }
+  size_t size = (size_t)st.st_size;
+  void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) return 1;
+
+  // Подсказки ядру необязательны: ошибки madvise() не мешают чтению
+  madvise(data, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+  if (mode == INPUT_MMAP_HUGE) madvise(data, size, MADV_HUGEPAGE);
+#endif
+
+  map->data = data;
+  map->size = size;
+  return 0;
+}
+
+void input_unmap(input_map_t *map) {
+  if (map->data) munmap((void *)map->data, map->size);
+  map->data = NULL;
+  map->size = 0;
+}
+
+static void fault_handler(int sig) {
+  if (input_fault_jump) {
+    sigjmp_buf *jump = input_fault_jump;
+    input_fault_jump = NULL;
+    siglongjmp(*jump, 1);
+  }
+  // Ошибка не при чтении отображённого файла: повторная попытка доступа
+  // завершит процесс как обычно
+  signal(sig, SIG_DFL);
+}
+
+void input_install_fault_handler(void) {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = fault_handler;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGBUS, &action, NULL);
+}
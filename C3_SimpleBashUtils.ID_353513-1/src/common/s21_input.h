@@ -0,0 +1,39 @@
+#ifndef S21_INPUT_H
+#define S21_INPUT_H
+
+#include <setjmp.h>
+#include <stddef.h>
+
+// Способ чтения обычных файлов; задаётся переменной окружения S21_MMAP:
+// "0" - только read(), "1" (по умолчанию) - mmap, "huge" - mmap с
+// MADV_HUGEPAGE. stdin, каналы и устройства всегда читаются потоком.
+typedef enum { INPUT_STREAM, INPUT_MMAP, INPUT_MMAP_HUGE } input_mode_t;
+
+// Файл, отображённый в память целиком
+typedef struct {
+  const char *data;
+  size_t size;
+} input_map_t;
+
+input_mode_t input_mode_from_env(void);
+
+// Отображает обычный непустой файл в память с MADV_SEQUENTIAL. Возвращает
+// 0 или 1, если файл нужно читать потоком (не обычный файл, пустой, режим
+// INPUT_STREAM или mmap не удался).
+int input_map(int fd, input_mode_t mode, input_map_t *map);
+void input_unmap(input_map_t *map);
+
+// Если файл укоротили, пока он отображён, чтение за новым концом даёт
+// SIGBUS. Обработчик возвращает управление в sigsetjmp() точки, которую
+// текущий поток задал INPUT_ARM_FAULT (sigsetjmp вернёт 1), после чего
+// файл дочитывается потоком. Без активной точки SIGBUS обрабатывается по
+// умолчанию. sigsetjmp() вызывается отдельным условием if сразу после
+// INPUT_ARM_FAULT: C11 не разрешает его внутри других выражений.
+extern _Thread_local sigjmp_buf *input_fault_jump;
+
+void input_install_fault_handler(void);
+
+#define INPUT_ARM_FAULT(env) (input_fault_jump = &(env))
+#define INPUT_RELEASE_FAULT() (input_fault_jump = NULL)
+
+#endif
@@ -1,32 +1,115 @@
 #ifndef S21_GREP_H
 #define S21_GREP_H
 
+#include <errno.h>
+#include <fcntl.h>
 #include <regex.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/s21_input.h"
+#include "s21_grep_lib.h"
+#include "s21_grep_match.h"
+#include "s21_grep_output.h"
+#include "s21_grep_state.h"
+#include "s21_grep_walk.h"
+
+// --binary-files: те же значения, что у S21GREP_BINARY_*
+#define BINARY_MATCHES S21GREP_BINARY_MATCHES
+#define BINARY_SKIP S21GREP_BINARY_SKIP
+#define BINARY_TEXT S21GREP_BINARY_TEXT
 
 typedef struct {
-  int ignore_case;      // -i: игнорировать регистр
-  int invert_match;     // -v: инвертировать совпадения
-  int count_matches;    // -c: подсчитывать совпадения
-  int list_files;       // -l: выводить только имена файлов
-  int line_number;      // -n: выводить номера строк
-  int suppress_errors;  // -s: подавлять сообщения об ошибках
-  int no_filename;      // -h: подавлять имена файлов
-  int only_matching;    // -o: выводить только совпадающие части
+  int invert_match;         // -v: инвертировать совпадения
+  int count_matches;        // -c: подсчитывать совпадения
+  int list_files;           // -l: выводить только имена файлов
+  int line_number;          // -n: выводить номера строк
+  int suppress_errors;      // -s: подавлять сообщения об ошибках
+  int no_filename;          // -h: подавлять имена файлов
+  int only_matching;        // -o: выводить только совпадающие части
+  int quiet;                // -q: только код возврата
+  long max_count;           // -m: предел выбранных строк (-1 - без него)
+  int jobs;                 // -j: число потоков поиска
+  int recursive;            // -r: 1, -R: 2 (по символическим ссылкам)
+  int binary_files;         // --binary-files: BINARY_*
+  int use_index;            // --index: отбор файлов каталога по индексу
+  const char *state_file;   // --state-file FILE
+  state_table_t *state;     // Загруженное состояние или NULL
+  match_thread_t *thread;   // Состояние шаблонов текущего потока
+  int follow;               // --follow: искать в дописываемых строках
+  walk_filter_t filter;     // --include, --exclude, --exclude-dir
+  input_mode_t input_mode;  // S21_MMAP: чтение через mmap или read()
 } grep_options_t;
 
+// Размер блока чтения; строка длиннее блока расширяет буфер
+#define SCAN_BLOCK_SIZE (256 * 1024)
+// Окно поиска в отображённом файле: ограничивает память, которую regexec()
+// выделяет под одну строку поиска
+#define MAP_WINDOW_SIZE (4 * 1024 * 1024)
+
+// Состояние поиска по одному файлу
 typedef struct {
-  char **patterns;      // Массив шаблонов
-  int pattern_count;    // Количество шаблонов
-} pattern_list_t;
+  const char *filename;
+  size_t filename_length;
+  grep_options_t opts;
+  const compiled_patterns_t *compiled;
+  int multiple_files;
+  output_t *out;        // Куда выводятся строки
+  match_cache_t cache;  // Кандидаты поиска в текущем блоке
+  size_t line_num;      // Номер строки, закончившейся перед counted (-n)
+  const char *counted;  // До этой позиции блока строки уже посчитаны
+  int match_count;      // Совпавшие (с -v - несовпавшие) строки
+  const char *resume;   // Первая необработанная строка (для SIGBUS)
+  size_t resume_line_num;
+  int resume_match_count;
+  size_t resume_out_length;
+  size_t resume_out_flushes;
+  int binary_checked;  // Первый блок файла уже проверен на NUL
+  int binary;          // Файл двоичный: строки не выводятся
+  // libs21grep: совпадения отдаются в on_match, а не в out (out - NULL)
+  s21grep_callback_t on_match;
+  void *on_match_context;
+  const char *base;      // Начало данных текущего блока
+  uint64_t base_offset;  // Смещение base от начала поиска
+  int stopped;           // on_match остановил поиск
+} grep_scan_t;
 
-void parse_args(int argc, char *argv[], grep_options_t *opts, char ***files,
-                int *file_count, pattern_list_t *patterns);
+// Вывод строк не нужен: -c, -l или -q
+int output_suppressed(const grep_options_t *opts);
+// Дальше искать в файле не нужно: для -l/-q уже есть совпадение или
+// выбрано -m NUM строк
+int scan_done(const grep_scan_t *scan);
+// Ищет в [begin, end) отображённого файла окнами по MAP_WINDOW_SIZE,
+// выровненными по строкам; begin - начало строки. Возвращает 0 или 1, если
+// файл укоротили во время поиска: тогда в resume - смещение, с которого его
+// нужно дочитать потоком.
+int scan_mapped_range(grep_scan_t *scan, const input_map_t *map,
+                      size_t begin, size_t end, size_t *resume);
+// Ищет в data[0..length) вызывающего, окнами как в отображённом файле
+void scan_buffer(grep_scan_t *scan, const char *data, size_t length);
+// Читает fd блоками по SCAN_BLOCK_SIZE. Возвращает 0 или errno.
+int scan_fd(grep_scan_t *scan, int fd);
 int process_file(const char *filename, grep_options_t opts,
-                 pattern_list_t patterns, int multiple_files,
-                 int *error_occurred);
-void free_patterns(pattern_list_t *patterns);
+                 const compiled_patterns_t *compiled, int multiple_files,
+                 output_t *out, output_t *err, int *error_occurred);
+// Как process_file(), но в уже открытом fd (--follow держит файлы
+// открытыми); fd не закрывается. Возвращает число совпадений.
+int process_fd(const char *filename, int fd, grep_options_t opts,
+               const compiled_patterns_t *compiled, int multiple_files,
+               output_t *out, output_t *err, int *error_occurred);
+double monotonic_ms(void);
+// S21_GREP_STATS: выводить ли статистику в stderr
+int stats_enabled(void);
+void print_compile_stats(int pattern_count, double compile_ms);
+int is_directory(const char *path);
+// -r/-R: каталоги из командной строки обходятся, остальные операнды ищутся
+// как обычно, если их имя проходит --include/--exclude
+int grep_recursive(char **files, int file_count, int multiple_files,
+                   grep_options_t opts, const compiled_patterns_t *compiled,
+                   output_t *out, output_t *err, int *error_occurred);
 
 #endif
\ No newline at end of file
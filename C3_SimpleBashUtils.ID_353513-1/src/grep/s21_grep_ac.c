@@ -0,0 +1,225 @@
+#include "s21_grep_ac.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "s21_grep_literal.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static unsigned char fold_byte(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+static unsigned char other_case(unsigned char c) {
+  if (c >= 'A' && c <= 'Z') return (unsigned char)(c + 32);
+  if (c >= 'a' && c <= 'z') return (unsigned char)(c - 32);
+  return c;
+}
+
+static int literal_at(const multi_literal_t *ml, int p, const char *text,
+                      size_t len, size_t pos) {
+  size_t n = ml->packed_lengths[p];
+  if (pos + n > len) return 0;
+  return ml->fold_case ? s21_memeq_icase(text + pos, ml->packed[p], n)
+                       : memcmp(text + pos, ml->packed[p], n) == 0;
+}
+
+// Упакованный префильтр для небольших наборов: для каждой позиции сразу
+// сравниваются первые два байта всех литералов (в обоих регистрах для -i),
+// полная проверка выполняется только для позиций-кандидатов
+static const char *packed_find(const multi_literal_t *ml, const char *text,
+                               size_t len, size_t *match_len) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  __m128i first_lo[MULTI_PACKED_MAX], first_up[MULTI_PACKED_MAX];
+  __m128i second_lo[MULTI_PACKED_MAX], second_up[MULTI_PACKED_MAX];
+  for (int p = 0; p < ml->packed_count; p++) {
+    unsigned char f = (unsigned char)ml->packed[p][0];
+    first_lo[p] = _mm_set1_epi8((char)f);
+    first_up[p] = _mm_set1_epi8((char)(ml->fold_case ? other_case(f) : f));
+    if (ml->packed_lengths[p] > 1) {
+      unsigned char s = (unsigned char)ml->packed[p][1];
+      second_lo[p] = _mm_set1_epi8((char)s);
+      second_up[p] = _mm_set1_epi8((char)(ml->fold_case ? other_case(s) : s));
+    }
+  }
+
+  for (; i + 17 <= len; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(text + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(text + i + 1));
+    __m128i candidates = _mm_setzero_si128();
+    for (int p = 0; p < ml->packed_count; p++) {
+      __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(a, first_lo[p]),
+                                 _mm_cmpeq_epi8(a, first_up[p]));
+      if (ml->packed_lengths[p] > 1) {
+        hit = _mm_and_si128(hit, _mm_or_si128(_mm_cmpeq_epi8(b, second_lo[p]),
+                                              _mm_cmpeq_epi8(b, second_up[p])));
+      }
+      candidates = _mm_or_si128(candidates, hit);
+    }
+    unsigned mask = (unsigned)_mm_movemask_epi8(candidates);
+    while (mask) {
+      size_t pos = i + (size_t)__builtin_ctz(mask);
+      for (int p = 0; p < ml->packed_count; p++) {
+        if (literal_at(ml, p, text, len, pos)) {
+          *match_len = ml->packed_lengths[p];
+          return text + pos;
+        }
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  for (; i < len; i++) {
+    for (int p = 0; p < ml->packed_count; p++) {
+      if (literal_at(ml, p, text, len, i)) {
+        *match_len = ml->packed_lengths[p];
+        return text + i;
+      }
+    }
+  }
+  return NULL;
+}
+
+// Ахо-Корасик: бор по классам байтов, затем достраивание переходов по
+// суффиксным ссылкам в обходе в ширину
+static int build_automaton(multi_literal_t *ml, char *const *literals,
+                           const size_t *lengths, int count) {
+  int folded_class[256] = {0};
+  int class_count = 1;  // Класс 0 - байты, не встречающиеся в литералах
+  size_t max_states = 1;
+  for (int p = 0; p < count; p++) {
+    max_states += lengths[p];
+    for (size_t k = 0; k < lengths[p]; k++) {
+      unsigned char c = (unsigned char)literals[p][k];
+      if (ml->fold_case) c = fold_byte(c);
+      if (!folded_class[c]) folded_class[c] = class_count++;
+    }
+  }
+  for (int c = 0; c < 256; c++) {
+    unsigned char key = ml->fold_case ? fold_byte((unsigned char)c)
+                                      : (unsigned char)c;
+    ml->byte_class[c] = (unsigned char)folded_class[key];
+  }
+  ml->class_count = class_count;
+  if (class_count > 256 || max_states > (size_t)INT32_MAX / class_count) {
+    return 1;
+  }
+
+  size_t cells = max_states * (size_t)class_count;
+  int32_t *next = malloc(sizeof(int32_t) * cells);
+  int32_t *fail = malloc(sizeof(int32_t) * max_states);
+  int32_t *queue = malloc(sizeof(int32_t) * max_states);
+  ml->match_lengths = calloc(max_states, sizeof(size_t));
+  ml->delta = next;
+  if (!next || !fail || !queue || !ml->match_lengths) {
+    free(fail);
+    free(queue);
+    return 1;
+  }
+  for (size_t k = 0; k < cells; k++) next[k] = -1;
+
+  int32_t states = 1;
+  for (int p = 0; p < count; p++) {
+    int32_t s = 0;
+    for (size_t k = 0; k < lengths[p]; k++) {
+      int c = ml->byte_class[(unsigned char)literals[p][k]];
+      if (next[(size_t)s * class_count + c] < 0) {
+        next[(size_t)s * class_count + c] = states++;
+      }
+      s = next[(size_t)s * class_count + c];
+    }
+    if (!ml->match_lengths[s]) ml->match_lengths[s] = lengths[p];
+  }
+
+  size_t head = 0, tail = 0;
+  for (int c = 0; c < class_count; c++) {
+    int32_t t = next[c];
+    if (t < 0) {
+      next[c] = 0;
+    } else {
+      fail[t] = 0;
+      queue[tail++] = t;
+    }
+  }
+  while (head < tail) {
+    int32_t s = queue[head++];
+    if (!ml->match_lengths[s]) {
+      ml->match_lengths[s] = ml->match_lengths[fail[s]];
+    }
+    for (int c = 0; c < class_count; c++) {
+      size_t cell = (size_t)s * class_count + c;
+      int32_t via_fail = next[(size_t)fail[s] * class_count + c];
+      if (next[cell] < 0) {
+        next[cell] = via_fail;
+      } else {
+        fail[next[cell]] = via_fail;
+        queue[tail++] = next[cell];
+      }
+    }
+  }
+
+  // Номера состояний -> смещения строк таблицы, завершающие - со знаком
+  for (size_t k = 0; k < (size_t)states * class_count; k++) {
+    int32_t row = next[k] * class_count;
+    next[k] = ml->match_lengths[next[k]] ? -(row + 1) : row;
+  }
+
+  free(fail);
+  free(queue);
+  return 0;
+}
+
+int multi_literal_build(multi_literal_t *ml, char *const *literals,
+                        const size_t *lengths, int count, int fold_case) {
+  memset(ml, 0, sizeof(*ml));
+  ml->fold_case = fold_case;
+
+  if (count <= MULTI_PACKED_MAX) {
+    ml->packed_count = count;
+    for (int p = 0; p < count; p++) {
+      ml->packed[p] = literals[p];
+      ml->packed_lengths[p] = lengths[p];
+    }
+    return 0;
+  }
+
+  if (build_automaton(ml, literals, lengths, count) != 0) {
+    multi_literal_free(ml);
+    return 1;
+  }
+  return 0;
+}
+
+const char *multi_literal_find(const multi_literal_t *ml, const char *text,
+                               size_t len, size_t *match_len) {
+  if (!ml->delta) return packed_find(ml, text, len, match_len);
+
+  const int32_t *delta = ml->delta;
+  const unsigned char *byte_class = ml->byte_class;
+  const unsigned char *p = (const unsigned char *)text;
+  const unsigned char *end = p + len;
+  int32_t row = 0;
+  for (; p < end; p++) {
+    int32_t v = delta[row + byte_class[*p]];
+    if (v < 0) {
+      size_t state = (size_t)(-v - 1) / (size_t)ml->class_count;
+      *match_len = ml->match_lengths[state];
+      return (const char *)p + 1 - *match_len;
+    }
+    row = v;
+  }
+  return NULL;
+}
+
+void multi_literal_free(multi_literal_t *ml) {
+  free(ml->delta);
+  free(ml->match_lengths);
+  ml->delta = NULL;
+  ml->match_lengths = NULL;
+  ml->packed_count = 0;
+}
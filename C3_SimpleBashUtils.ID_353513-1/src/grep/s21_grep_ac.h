@@ -0,0 +1,42 @@
+#ifndef S21_GREP_AC_H
+#define S21_GREP_AC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Наборы до этого размера ищутся упакованным SIMD-префильтром,
+// большие - автоматом Ахо-Корасик
+#define MULTI_PACKED_MAX 8
+
+// Поиск сразу нескольких литералов за один проход по тексту
+typedef struct {
+  int fold_case;  // ASCII-регистр не учитывается (-i)
+
+  // Упакованный префильтр: литералы хранятся как есть
+  int packed_count;
+  const char *packed[MULTI_PACKED_MAX];
+  size_t packed_lengths[MULTI_PACKED_MAX];
+
+  // Ахо-Корасик: плотная таблица переходов по классам байтов.
+  // delta[row + class] - смещение строки следующего состояния; если
+  // следующее состояние завершает литерал, смещение хранится как -(row + 1)
+  int class_count;
+  unsigned char byte_class[256];
+  int32_t *delta;
+  size_t *match_lengths;  // Длина литерала, заканчивающегося в состоянии
+} multi_literal_t;
+
+// Строит поиск по count литералам (все длиной > 0). Возвращает 0 или 1 при
+// нехватке памяти. Литералы для упакованного префильтра не копируются и
+// должны жить не меньше ml.
+int multi_literal_build(multi_literal_t *ml, char *const *literals,
+                        const size_t *lengths, int count, int fold_case);
+
+// Находит первое вхождение любого литерала в text[0..len). Возвращает
+// указатель на его начало и длину в match_len или NULL.
+const char *multi_literal_find(const multi_literal_t *ml, const char *text,
+                               size_t len, size_t *match_len);
+
+void multi_literal_free(multi_literal_t *ml);
+
+#endif
@@ -0,0 +1,283 @@
+#include "s21_grep_args.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void parse_args(int argc, char *argv[], grep_args_t *args) {
+  memset(args, 0, sizeof(*args));
+  s21grep_options_t *opts = &args->options;
+  pattern_list_t *patterns = &args->patterns;
+  patterns->capacity = argc;
+  opts->max_count = -1;
+
+  int max_patterns = argc;
+  int max_files = argc;
+
+  patterns->patterns = malloc(sizeof(char *) * max_patterns);
+  char **file_list = malloc(sizeof(char *) * max_files);
+  // Три массива фильтров в одном блоке, который освобождается через include
+  char **globs = malloc(sizeof(char *) * (size_t)argc * 3);
+  opts->include = globs;
+  opts->exclude = globs + argc;
+  opts->exclude_dir = globs + 2 * argc;
+
+  if (!patterns->patterns || !file_list || !globs) {
+    fprintf(stderr, "grep: memory allocation failed\n");
+    exit(1);
+  }
+
+  int i = 1;
+  int pattern_found = 0;
+  int file_idx = 0;
+
+  while (i < argc) {
+    if (strcmp(argv[i], "-e") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "grep: option requires an argument -- e\n");
+        free(patterns->patterns);
+        free(file_list);
+        free(opts->include);
+        exit(2);
+      }
+      i++;
+      if (reserve_pattern_slot(patterns) != 0 ||
+          !(patterns->patterns[patterns->pattern_count] = strdup(argv[i]))) {
+        fprintf(stderr, "grep: memory allocation failed\n");
+        free_patterns(patterns);
+        free(file_list);
+        free(opts->include);
+        exit(1);
+      }
+      patterns->pattern_count++;
+      pattern_found = 1;
+    } else if (strcmp(argv[i], "-f") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "grep: option requires an argument -- f\n");
+        free_patterns(patterns);
+        free(file_list);
+        free(opts->include);
+        exit(2);
+      }
+      FILE *pat_file = fopen(argv[++i], "r");
+      if (!pat_file) {
+        if (!opts->suppress_errors) {
+          fprintf(stderr, "grep: %s: No such file or directory\n", argv[i]);
+        }
+        free_patterns(patterns);
+        free(file_list);
+        free(opts->include);
+        exit(2);
+      }
+      char *line = NULL;
+      size_t len = 0;
+      ssize_t read;
+      while ((read = getline(&line, &len, pat_file)) != -1) {
+        if (read > 0 && line[read - 1] == '\n') {
+          line[read - 1] = '\0';
+          read--;
+        }
+        // ИСПРАВЛЕНИЕ: НЕ игнорируем пустые строки - они должны совпадать со
+        // всеми строками
+        if (reserve_pattern_slot(patterns) != 0 ||
+            !(patterns->patterns[patterns->pattern_count] = strdup(line))) {
+          fprintf(stderr, "grep: memory allocation failed\n");
+          free(line);
+          fclose(pat_file);
+          free_patterns(patterns);
+          free(file_list);
+          free(opts->include);
+          exit(1);
+        }
+        patterns->pattern_count++;
+        pattern_found = 1;
+      }
+      free(line);
+      fclose(pat_file);
+    } else if (strcmp(argv[i], "-m") == 0) {
+      char *end = NULL;
+      long max_count = i + 1 < argc ? strtol(argv[i + 1], &end, 10) : 0;
+      if (i + 1 >= argc || end == argv[i + 1] || *end != '\0') {
+        fprintf(stderr, "grep: invalid max count\n");
+        free_patterns(patterns);
+        free(file_list);
+        free(opts->include);
+        exit(2);
+      }
+      // Отрицательное значение - без ограничения, как в GNU grep
+      opts->max_count = max_count < 0 ? -1 : max_count;
+      i++;
+    } else if (strcmp(argv[i], "-j") == 0) {
+      char *end = NULL;
+      long jobs = i + 1 < argc ? strtol(argv[i + 1], &end, 10) : -1;
+      if (jobs < 0 || jobs > JOBS_MAX || end == argv[i + 1] || *end != '\0') {
+        fprintf(stderr, "grep: invalid number of jobs: '%s'\n",
+                i + 1 < argc ? argv[i + 1] : "");
+        free_patterns(patterns);
+        free(file_list);
+        free(opts->include);
+        exit(2);
+      }
+      // -j 0: по числу процессоров
+      opts->jobs = jobs > 0 ? (int)jobs : (int)sysconf(_SC_NPROCESSORS_ONLN);
+      i++;
+    } else if (strncmp(argv[i], "--include=", 10) == 0) {
+      opts->include[opts->include_count++] = argv[i] + 10;
+    } else if (strncmp(argv[i], "--exclude=", 10) == 0) {
+      opts->exclude[opts->exclude_count++] = argv[i] + 10;
+    } else if (strncmp(argv[i], "--exclude-dir=", 14) == 0) {
+      opts->exclude_dir[opts->exclude_dir_count++] =
+          argv[i] + 14;
+    } else if (strcmp(argv[i], "--build-index") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "grep: option '--build-index' requires an argument\n");
+        free_patterns(patterns);
+        free(file_list);
+        free(opts->include);
+        exit(2);
+      }
+      args->build_index = argv[++i];
+    } else if (strcmp(argv[i], "--state-file") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "grep: option '--state-file' requires an argument\n");
+        free_patterns(patterns);
+        free(file_list);
+        free(opts->include);
+        exit(2);
+      }
+      opts->state_file = argv[++i];
+    } else if (strcmp(argv[i], "--follow") == 0) {
+      opts->follow = 1;
+    } else if (strcmp(argv[i], "--index") == 0) {
+      // Индекс строится для каталога: --index подразумевает -r
+      opts->use_index = 1;
+      if (!opts->recursive) opts->recursive = 1;
+    } else if (strncmp(argv[i], "--binary-files=", 15) == 0) {
+      const char *type = argv[i] + 15;
+      if (strcmp(type, "binary") == 0) {
+        opts->binary_files = S21GREP_BINARY_MATCHES;
+      } else if (strcmp(type, "without-match") == 0) {
+        opts->binary_files = S21GREP_BINARY_SKIP;
+      } else if (strcmp(type, "text") == 0) {
+        opts->binary_files = S21GREP_BINARY_TEXT;
+      } else {
+        fprintf(stderr, "grep: unknown binary-files type\n");
+        free_patterns(patterns);
+        free(file_list);
+        free(opts->include);
+        exit(2);
+      }
+    } else if (argv[i][0] == '-') {
+      for (int j = 1; argv[i][j] != '\0'; j++) {
+        switch (argv[i][j]) {
+          case 'i':
+            args->compile_flags |= S21GREP_IGNORE_CASE;
+            break;
+          case 'v':
+            opts->invert_match = 1;
+            break;
+          case 'c':
+            opts->count_matches = 1;
+            break;
+          case 'l':
+            opts->list_files = 1;
+            break;
+          case 'n':
+            opts->line_number = 1;
+            break;
+          case 'h':
+            opts->no_filename = 1;
+            break;
+          case 's':
+            opts->suppress_errors = 1;
+            break;
+          case 'o':
+            opts->only_matching = 1;
+            break;
+          case 'F':
+            args->compile_flags |= S21GREP_FIXED_STRINGS;
+            break;
+          case 'q':
+            opts->quiet = 1;
+            break;
+          case 'r':
+            if (!opts->recursive) opts->recursive = 1;
+            break;
+          case 'R':
+            opts->recursive = 2;
+            break;
+          case 'a':
+            opts->binary_files = S21GREP_BINARY_TEXT;
+            break;
+          case 'I':
+            opts->binary_files = S21GREP_BINARY_SKIP;
+            break;
+          default:
+            fprintf(stderr, "grep: invalid option -- '%c'\n", argv[i][j]);
+            free_patterns(patterns);
+            free(file_list);
+            free(opts->include);
+            exit(2);
+        }
+      }
+    } else {
+      if (!pattern_found && patterns->pattern_count == 0) {
+        if (reserve_pattern_slot(patterns) != 0 ||
+            !(patterns->patterns[patterns->pattern_count] = strdup(argv[i]))) {
+          fprintf(stderr, "grep: memory allocation failed\n");
+          free_patterns(patterns);
+          free(file_list);
+          free(opts->include);
+          exit(1);
+        }
+        patterns->pattern_count++;
+        pattern_found = 1;
+      } else {
+        file_list[file_idx++] = argv[i];
+      }
+    }
+    i++;
+  }
+
+  // --build-index ищет не шаблоны, а все триграммы файлов
+  if (patterns->pattern_count == 0 && !args->build_index) {
+    fprintf(stderr, "grep: no pattern\n");
+    free_patterns(patterns);
+    free(file_list);
+    free(opts->include);
+    exit(2);
+  }
+
+  args->files = file_list;
+  args->file_count = file_idx;
+}
+
+void free_args(grep_args_t *args) {
+  free_patterns(&args->patterns);
+  free(args->files);
+  // Три массива фильтров - один блок
+  free(args->options.include);
+}
+
+// Файл -f может содержать больше шаблонов, чем argc: расширяем массив
+int reserve_pattern_slot(pattern_list_t *patterns) {
+  if (patterns->pattern_count < patterns->capacity) return 0;
+  int new_capacity = patterns->capacity * 2;
+  char **grown =
+      realloc(patterns->patterns, sizeof(char *) * (size_t)new_capacity);
+  if (!grown) return 1;
+  patterns->patterns = grown;
+  patterns->capacity = new_capacity;
+  return 0;
+}
+
+void free_patterns(pattern_list_t *patterns) {
+  for (int i = 0; i < patterns->pattern_count; i++) {
+    free(patterns->patterns[i]);
+  }
+  free(patterns->patterns);
+  patterns->patterns = NULL;
+  patterns->pattern_count = 0;
+  patterns->capacity = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef S21_GREP_ARGS_H
+#define S21_GREP_ARGS_H
+
+#include "s21_grep_lib.h"
+
+// Верхняя граница -j
+#define JOBS_MAX 1024
+
+typedef struct {
+  char **patterns;      // Массив шаблонов
+  int pattern_count;    // Количество шаблонов
+  int capacity;         // Размер выделенного массива
+} pattern_list_t;
+
+// Командная строка s21_grep: флаги для s21grep_compile() и s21grep_run()
+typedef struct {
+  s21grep_options_t options;
+  int compile_flags;        // -i, -F: S21GREP_IGNORE_CASE и т.п.
+  const char *build_index;  // --build-index DIR
+  char **files;
+  int file_count;
+  pattern_list_t patterns;
+} grep_args_t;
+
+// Разбирает argv; при ошибке выводит сообщение и завершает процесс
+void parse_args(int argc, char *argv[], grep_args_t *args);
+void free_args(grep_args_t *args);
+int reserve_pattern_slot(pattern_list_t *patterns);
+void free_patterns(pattern_list_t *patterns);
+
+#endif
@@ -0,0 +1,971 @@
+#include "s21_grep_dfa.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Виды узлов НКА
+#define NFA_SET 0    // Байт из множества sets[set]
+#define NFA_SPLIT 1  // Пустые переходы в out и out1
+#define NFA_EMPTY 2  // Пустой переход в out
+#define NFA_BOL 3    // ^: только в начале строки
+#define NFA_EOL 4    // $: только перед '\n' или концом текста
+#define NFA_MATCH 5  // Совпадение найдено
+
+// Переход в состояние с DFA_ACCEPT или DFA_DEAD хранится в next как
+// -(s + 2): быстрый цикл поиска останавливается на любом отрицательном
+// значении, -1 остаётся за непостроенными переходами и '\n'
+#define DFA_SPECIAL(s) (-(s)-2)
+
+// Конец группы в множестве узлов состояния DFA_LEFTMOST
+#define GROUP_END (-1)
+// Флаги, которые вместе с множеством узлов различают состояния
+#define DFA_KEY_FLAGS (DFA_BOL | DFA_ANCHORED | DFA_LEFTMOST)
+// initial[DFA_LEFTMOST_INITIAL + bol] - начальные состояния DFA_LEFTMOST
+#define DFA_LEFTMOST_INITIAL 4
+
+// Размер хеш-таблицы состояний (степень двойки)
+#define DFA_HASH_SIZE (DFA_MAX_STATES * 2)
+// Предел вложенности скобок и значений в {n,m}
+#define PARSE_MAX_DEPTH 256
+#define PARSE_MAX_REPEAT 255
+
+// Фрагмент НКА: вход start и единственный незамкнутый выход exit (узел,
+// у которого ещё не задан out)
+typedef struct {
+  int start;
+  int exit;
+} fragment_t;
+
+typedef struct {
+  const char *pattern;
+  size_t pos;
+  int ignore_case;
+  dfa_t *dfa;
+  int status;  // 0, 1 - нет памяти, 2 - шаблон не поддерживается
+  int depth;
+  int reverse;  // Строится НКА для текста, прочитанного справа налево
+  int anchor_count;  // Сколько ^ и $ уже разобрано
+} parser_t;
+
+static const fragment_t NO_FRAGMENT = {-1, -1};
+
+static void set_add(byte_set_t *set, unsigned char c) {
+  set->bits[c >> 5] |= 1u << (c & 31);
+}
+
+static int set_has(const byte_set_t *set, unsigned char c) {
+  return (set->bits[c >> 5] >> (c & 31)) & 1;
+}
+
+// С -i множество дополняется символами другого регистра (ASCII)
+static void set_fold_case(byte_set_t *set) {
+  for (int c = 'A'; c <= 'Z'; c++) {
+    unsigned char lower = (unsigned char)(c + 32);
+    if (set_has(set, (unsigned char)c) || set_has(set, lower)) {
+      set_add(set, (unsigned char)c);
+      set_add(set, lower);
+    }
+  }
+}
+
+static int new_node(parser_t *p, int kind, int out, int out1, int set) {
+  dfa_t *dfa = p->dfa;
+  if (p->status != 0) return -1;
+  if (dfa->node_count == NFA_MAX_NODES) {
+    p->status = 2;
+    return -1;
+  }
+  if (dfa->node_count == dfa->node_capacity) {
+    int capacity = dfa->node_capacity ? dfa->node_capacity * 2 : 64;
+    nfa_node_t *nodes =
+        realloc(dfa->nodes, sizeof(nfa_node_t) * (size_t)capacity);
+    if (!nodes) {
+      p->status = 1;
+      return -1;
+    }
+    dfa->nodes = nodes;
+    dfa->node_capacity = capacity;
+  }
+  nfa_node_t *node = &dfa->nodes[dfa->node_count];
+  node->kind = (unsigned char)kind;
+  node->out = out;
+  node->out1 = out1;
+  node->set = set;
+  return dfa->node_count++;
+}
+
+static int new_set(parser_t *p, const byte_set_t *set) {
+  dfa_t *dfa = p->dfa;
+  if (p->status != 0) return -1;
+  if (dfa->set_count == dfa->set_capacity) {
+    int capacity = dfa->set_capacity ? dfa->set_capacity * 2 : 16;
+    byte_set_t *sets =
+        realloc(dfa->sets, sizeof(byte_set_t) * (size_t)capacity);
+    if (!sets) {
+      p->status = 1;
+      return -1;
+    }
+    dfa->sets = sets;
+    dfa->set_capacity = capacity;
+  }
+  dfa->sets[dfa->set_count] = *set;
+  return dfa->set_count++;
+}
+
+static fragment_t single(parser_t *p, int kind, int set) {
+  int node = new_node(p, kind, -1, -1, set);
+  if (node < 0) return NO_FRAGMENT;
+  fragment_t f = {node, node};
+  return f;
+}
+
+static fragment_t set_fragment(parser_t *p, byte_set_t *set) {
+  if (p->ignore_case) set_fold_case(set);
+  int index = new_set(p, set);
+  if (index < 0) return NO_FRAGMENT;
+  return single(p, NFA_SET, index);
+}
+
+static void patch(parser_t *p, fragment_t f, int target) {
+  p->dfa->nodes[f.exit].out = target;
+}
+
+static fragment_t concat(parser_t *p, fragment_t a, fragment_t b) {
+  if (p->status != 0) return NO_FRAGMENT;
+  if (a.start < 0) return b;
+  if (p->reverse) {
+    fragment_t swap = a;
+    a = b;
+    b = swap;
+  }
+  patch(p, a, b.start);
+  fragment_t f = {a.start, b.exit};
+  return f;
+}
+
+static fragment_t alternate(parser_t *p, fragment_t a, fragment_t b) {
+  int split = new_node(p, NFA_SPLIT, a.start, b.start, -1);
+  int exit = new_node(p, NFA_EMPTY, -1, -1, -1);
+  if (exit < 0) return NO_FRAGMENT;
+  patch(p, a, exit);
+  patch(p, b, exit);
+  fragment_t f = {split, exit};
+  return f;
+}
+
+// '*', '+' и '?': ветвление между повтором a и выходом
+static fragment_t repeat(parser_t *p, fragment_t a, char op) {
+  int exit = new_node(p, NFA_EMPTY, -1, -1, -1);
+  int split = new_node(p, NFA_SPLIT, a.start, exit, -1);
+  if (split < 0) return NO_FRAGMENT;
+  patch(p, a, op == '?' ? exit : split);
+  fragment_t f = {op == '+' ? a.start : split, exit};
+  return f;
+}
+
+static fragment_t parse_alternation(parser_t *p);
+
+static int is_word_escape(char c) {
+  return isalnum((unsigned char)c) || strchr("<>`'", c) != NULL;
+}
+
+// [:имя:] внутри скобок; pos указывает на имя
+static int add_class(parser_t *p, byte_set_t *set) {
+  static const struct {
+    const char *name;
+    int (*test)(int);
+  } classes[] = {{"alpha", isalpha}, {"digit", isdigit}, {"alnum", isalnum},
+                 {"upper", isupper}, {"lower", islower}, {"space", isspace},
+                 {"blank", isblank}, {"punct", ispunct}, {"print", isprint},
+                 {"graph", isgraph}, {"cntrl", iscntrl}, {"xdigit", isxdigit}};
+  const char *name = p->pattern + p->pos;
+  const char *close = strstr(name, ":]");
+  if (!close) return 2;
+  size_t len = (size_t)(close - name);
+  for (size_t k = 0; k < sizeof(classes) / sizeof(classes[0]); k++) {
+    if (strlen(classes[k].name) == len &&
+        strncmp(classes[k].name, name, len) == 0) {
+      for (int c = 0; c < 256; c++) {
+        if (classes[k].test(c)) set_add(set, (unsigned char)c);
+      }
+      p->pos += len + 2;
+      return 0;
+    }
+  }
+  return 2;
+}
+
+// Скобочное выражение; pos - сразу после '['. '-' допускается только
+// первым или последним, классы эквивалентности [= =] и [. .] не
+// поддерживаются.
+static fragment_t parse_bracket(parser_t *p) {
+  const char *s = p->pattern;
+  byte_set_t set = {{0}};
+  int negate = s[p->pos] == '^';
+  if (negate) p->pos++;
+  int first = 1;
+  for (;;) {
+    unsigned char c = (unsigned char)s[p->pos];
+    if (c == '\0') {
+      p->status = 2;
+      return NO_FRAGMENT;
+    }
+    if (c == ']' && !first) {
+      p->pos++;
+      break;
+    }
+    if (c == '[' && s[p->pos + 1] == ':') {
+      p->pos += 2;
+      if (add_class(p, &set) != 0) {
+        p->status = 2;
+        return NO_FRAGMENT;
+      }
+    } else if (c == '[' && (s[p->pos + 1] == '.' || s[p->pos + 1] == '=')) {
+      p->status = 2;
+      return NO_FRAGMENT;
+    } else if (c == '-' && !first && s[p->pos + 1] != ']') {
+      p->status = 2;
+      return NO_FRAGMENT;
+    } else if (s[p->pos + 1] == '-' && s[p->pos + 2] != ']' &&
+               s[p->pos + 2] != '\0') {
+      unsigned char hi = (unsigned char)s[p->pos + 2];
+      // Диапазоны за пределами ASCII зависят от порядка сортировки
+      if (hi == '[' || hi < c || hi >= 0x80) {
+        p->status = 2;
+        return NO_FRAGMENT;
+      }
+      for (int b = c; b <= hi; b++) set_add(&set, (unsigned char)b);
+      p->pos += 3;
+    } else {
+      set_add(&set, c);
+      p->pos++;
+    }
+    first = 0;
+  }
+
+  if (p->ignore_case) set_fold_case(&set);
+  if (negate) {
+    for (int k = 0; k < 8; k++) set.bits[k] = ~set.bits[k];
+    // REG_NEWLINE: [^...] не совпадает с '\n'
+    set.bits['\n' >> 5] &= ~(1u << ('\n' & 31));
+  }
+  int index = new_set(p, &set);
+  if (index < 0) return NO_FRAGMENT;
+  return single(p, NFA_SET, index);
+}
+
+static fragment_t parse_atom(parser_t *p, int *is_anchor) {
+  const char *s = p->pattern;
+  char c = s[p->pos];
+  byte_set_t set = {{0}};
+  *is_anchor = 0;
+  switch (c) {
+    case '(': {
+      p->pos++;
+      if (s[p->pos] == ')' || ++p->depth > PARSE_MAX_DEPTH) {
+        p->status = 2;
+        return NO_FRAGMENT;
+      }
+      int anchors = p->anchor_count;
+      fragment_t f = parse_alternation(p);
+      p->depth--;
+      // Повтор группы с ^ или $ regexec() понимает иначе, чем НКА:
+      // такая группа повторяется, как и сам якорь, только через regexec()
+      *is_anchor = p->anchor_count != anchors;
+      if (p->status != 0 || s[p->pos] != ')') {
+        p->status = p->status ? p->status : 2;
+        return NO_FRAGMENT;
+      }
+      p->pos++;
+      return f;
+    }
+    case '*':
+    case '+':
+    case '?':
+    case '{':
+      p->status = 2;
+      return NO_FRAGMENT;
+    case '.':
+      for (int k = 0; k < 8; k++) set.bits[k] = ~0u;
+      set.bits['\n' >> 5] &= ~(1u << ('\n' & 31));
+      p->pos++;
+      return set_fragment(p, &set);
+    case '[':
+      p->pos++;
+      return parse_bracket(p);
+    case '^':
+    case '$':
+      *is_anchor = 1;
+      p->anchor_count++;
+      p->dfa->has_anchors = 1;
+      p->pos++;
+      // Справа налево ^ проверяется в конце прочитанного, а $ - в начале
+      return single(p, (c == '^') != p->reverse ? NFA_BOL : NFA_EOL, -1);
+    case '\\':
+      // \1, \w, \b, \< и т.п. остаются за regexec()
+      if (s[p->pos + 1] == '\0' || is_word_escape(s[p->pos + 1])) {
+        p->status = 2;
+        return NO_FRAGMENT;
+      }
+      p->pos++;
+      c = s[p->pos];
+      break;
+    default:
+      break;
+  }
+  set_add(&set, (unsigned char)c);
+  p->pos++;
+  return set_fragment(p, &set);
+}
+
+// Разбирает {n}, {n,} или {n,m}; pos - сразу после '{'. max = -1 - без
+// верхней границы.
+static int parse_interval(parser_t *p, int *min, int *max) {
+  const char *s = p->pattern;
+  if (!isdigit((unsigned char)s[p->pos])) return 2;
+  char *end = NULL;
+  long low = strtol(s + p->pos, &end, 10);
+  long high = low;
+  if (*end == ',') {
+    end++;
+    high = isdigit((unsigned char)*end) ? strtol(end, &end, 10) : -1;
+  }
+  if (*end != '}' || low > PARSE_MAX_REPEAT || high > PARSE_MAX_REPEAT ||
+      (high >= 0 && high < low)) {
+    return 2;
+  }
+  p->pos = (size_t)(end + 1 - s);
+  *min = (int)low;
+  *max = (int)high;
+  return 0;
+}
+
+// Повтор атома {min,max}: копии атома строятся повторным разбором его
+// текста с atom_pos, первая копия - уже построенный фрагмент f
+static fragment_t parse_counted(parser_t *p, fragment_t f, size_t atom_pos,
+                                int min, int max) {
+  fragment_t result = NO_FRAGMENT;
+  int used = 0;
+  int count = max < 0 ? min + 1 : max;
+  for (int k = 0; k < count && p->status == 0; k++) {
+    fragment_t copy = f;
+    if (used) {
+      size_t pos = p->pos;
+      int is_anchor;
+      p->pos = atom_pos;
+      copy = parse_atom(p, &is_anchor);
+      p->pos = pos;
+      if (p->status != 0) return NO_FRAGMENT;
+    }
+    used = 1;
+    if (max < 0 && k == min) {
+      copy = repeat(p, copy, '*');
+    } else if (k >= min) {
+      copy = repeat(p, copy, '?');
+    }
+    result = concat(p, result, copy);
+  }
+  if (result.start < 0 && p->status == 0) {
+    return single(p, NFA_EMPTY, -1);  // {0} и {0,0}
+  }
+  return result;
+}
+
+static fragment_t parse_piece(parser_t *p) {
+  const char *s = p->pattern;
+  size_t atom_pos = p->pos;
+  int is_anchor;
+  fragment_t f = parse_atom(p, &is_anchor);
+  int counted = 0;
+  while (p->status == 0) {
+    char c = s[p->pos];
+    if (c != '*' && c != '+' && c != '?' && c != '{') break;
+    if (is_anchor) {
+      p->status = 2;
+      break;
+    }
+    p->pos++;
+    if (c != '{') {
+      f = repeat(p, f, c);
+      counted = 1;
+      continue;
+    }
+    int min, max;
+    // Повтор уже повторённого атома пришлось бы копировать целиком
+    if (counted || parse_interval(p, &min, &max) != 0) {
+      p->status = 2;
+      break;
+    }
+    f = parse_counted(p, f, atom_pos, min, max);
+    counted = 1;
+  }
+  return p->status == 0 ? f : NO_FRAGMENT;
+}
+
+static fragment_t parse_branch(parser_t *p) {
+  const char *s = p->pattern;
+  fragment_t f = NO_FRAGMENT;
+  if (s[p->pos] == '\0' || s[p->pos] == '|' || s[p->pos] == ')') {
+    p->status = 2;  // Пустая ветка
+    return f;
+  }
+  while (p->status == 0 && s[p->pos] != '\0' && s[p->pos] != '|' &&
+         s[p->pos] != ')') {
+    f = concat(p, f, parse_piece(p));
+  }
+  return p->status == 0 ? f : NO_FRAGMENT;
+}
+
+static fragment_t parse_alternation(parser_t *p) {
+  fragment_t f = parse_branch(p);
+  while (p->status == 0 && p->pattern[p->pos] == '|') {
+    p->pos++;
+    fragment_t g = parse_branch(p);
+    if (p->status == 0) f = alternate(p, f, g);
+  }
+  return p->status == 0 ? f : NO_FRAGMENT;
+}
+
+// Делит байты на классы, которые ни одно множество НКА не различает:
+// строка переходов состояния хранит по значению на класс, а не на байт.
+// '\n' всегда в отдельном классе - его разбирает медленный путь поиска.
+static void build_byte_classes(dfa_t *dfa) {
+  for (int c = 0; c < 256; c++) dfa->byte_class[c] = c == '\n';
+  int count = 2;
+  for (int k = 0; k < dfa->set_count; k++) {
+    int split[256][2];
+    for (int i = 0; i < count; i++) split[i][0] = split[i][1] = -1;
+    int split_count = 0;
+    for (int c = 0; c < 256; c++) {
+      int *id = &split[dfa->byte_class[c]][set_has(&dfa->sets[k], c)];
+      if (*id < 0) *id = split_count++;
+      dfa->byte_class[c] = (unsigned char)*id;
+    }
+    count = split_count;
+  }
+  dfa->class_count = count;
+}
+
+static void flush_states(dfa_cache_t *cache) {
+  cache->state_count = 0;
+  cache->item_length = 0;
+  for (int k = 0; k < DFA_HASH_SIZE; k++) cache->hash[k] = -1;
+  for (int k = 0; k < DFA_INITIAL_STATES; k++) cache->initial[k] = -1;
+  cache->skip_state = -1;
+  cache->flushes++;
+}
+
+static int compile(const char *pattern, int ignore_case, int reverse,
+                   dfa_t *dfa) {
+  memset(dfa, 0, sizeof(*dfa));
+  parser_t p = {pattern, 0, ignore_case, dfa, 0, 0, reverse, 0};
+  fragment_t f = parse_alternation(&p);
+  // Непарная ')'
+  if (p.status == 0 && pattern[p.pos] != '\0') p.status = 2;
+  int match = new_node(&p, NFA_MATCH, -1, -1, -1);
+  if (p.status != 0) {
+    dfa_free(dfa);
+    return p.status;
+  }
+  patch(&p, f, match);
+  dfa->start = f.start;
+  build_byte_classes(dfa);
+
+  return 0;
+}
+
+int dfa_compile(const char *pattern, int ignore_case, dfa_t *dfa) {
+  return compile(pattern, ignore_case, 0, dfa);
+}
+
+int dfa_compile_reverse(const char *pattern, int ignore_case, dfa_t *dfa) {
+  return compile(pattern, ignore_case, 1, dfa);
+}
+
+void dfa_free(dfa_t *dfa) {
+  free(dfa->nodes);
+  free(dfa->sets);
+  memset(dfa, 0, sizeof(*dfa));
+}
+
+int dfa_cache_init(dfa_cache_t *cache, const dfa_t *dfa) {
+  memset(cache, 0, sizeof(*cache));
+  size_t nodes = (size_t)dfa->node_count;
+  cache->hash = malloc(sizeof(int) * DFA_HASH_SIZE);
+  cache->stack = malloc(sizeof(int) * nodes);
+  cache->scratch = malloc(sizeof(int) * (nodes * 3 + 1));
+  cache->visited = calloc(nodes, sizeof(unsigned));
+  cache->item_capacity = 256;
+  cache->items = malloc(sizeof(int) * cache->item_capacity);
+  cache->groups = malloc(sizeof(int) * (nodes * 2 + 2));
+  if (!cache->hash || !cache->stack || !cache->scratch || !cache->visited ||
+      !cache->items || !cache->groups) {
+    dfa_cache_free(cache);
+    return 1;
+  }
+  flush_states(cache);
+  cache->flushes = 0;
+  return 0;
+}
+
+void dfa_cache_free(dfa_cache_t *cache) {
+  free(cache->next);
+  free(cache->flags);
+  free(cache->item_start);
+  free(cache->item_count);
+  free(cache->items);
+  free(cache->hash);
+  free(cache->stack);
+  free(cache->scratch);
+  free(cache->visited);
+  free(cache->groups);
+  memset(cache, 0, sizeof(*cache));
+}
+
+// Начинает новый обход: узлы, пройденные прежними замыканиями, снова
+// не пройдены
+static void new_visit(const dfa_t *dfa, dfa_cache_t *cache) {
+  if (++cache->visit_mark == 0) {
+    memset(cache->visited, 0, sizeof(unsigned) * (size_t)dfa->node_count);
+    cache->visit_mark = 1;
+  }
+}
+
+// Замыкание seeds по пустым переходам. ^ проходится только при bol, $ -
+// только при eol; непройденный $ остаётся в множестве, чтобы проверить его
+// в конце строки. В out попадают узлы NFA_SET, NFA_EOL и NFA_MATCH. Узлы,
+// пройденные с последнего new_visit(), пропускаются.
+static int closure(const dfa_t *dfa, dfa_cache_t *cache, const int *seeds,
+                   int seed_count, int bol, int eol, int *out) {
+  int top = 0;
+  int count = 0;
+  for (int k = 0; k < seed_count; k++) {
+    if (cache->visited[seeds[k]] != cache->visit_mark) {
+      cache->visited[seeds[k]] = cache->visit_mark;
+      cache->stack[top++] = seeds[k];
+    }
+  }
+  while (top > 0) {
+    int n = cache->stack[--top];
+    const nfa_node_t *node = &dfa->nodes[n];
+    int follow[2] = {-1, -1};
+    switch (node->kind) {
+      case NFA_SET:
+      case NFA_MATCH:
+        out[count++] = n;
+        break;
+      case NFA_EOL:
+        if (eol) {
+          follow[0] = node->out;
+        } else {
+          out[count++] = n;
+        }
+        break;
+      case NFA_BOL:
+        if (bol) follow[0] = node->out;
+        break;
+      case NFA_SPLIT:
+        follow[1] = node->out1;
+        follow[0] = node->out;
+        break;
+      default:
+        follow[0] = node->out;
+        break;
+    }
+    for (int k = 0; k < 2; k++) {
+      if (follow[k] >= 0 && cache->visited[follow[k]] != cache->visit_mark) {
+        cache->visited[follow[k]] = cache->visit_mark;
+        cache->stack[top++] = follow[k];
+      }
+    }
+  }
+  return count;
+}
+
+static int compare_ints(const void *a, const void *b) {
+  int x = *(const int *)a;
+  int y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+// Флаги совпадения для множества items: есть ли NFA_MATCH сразу и после
+// прохода отложенных $ в конце строки
+static unsigned char state_flags(const dfa_t *dfa, dfa_cache_t *cache,
+                                 const int *items, int count,
+                                 unsigned char flags) {
+  int *seeds = cache->scratch + dfa->node_count;
+  int *eol_items = seeds + dfa->node_count;
+  int seed_count = 0;
+  if (count == 0) flags |= DFA_DEAD;
+  for (int k = 0; k < count; k++) {
+    if (items[k] == GROUP_END) continue;
+    const nfa_node_t *node = &dfa->nodes[items[k]];
+    if (node->kind == NFA_MATCH) flags |= DFA_ACCEPT | DFA_ACCEPT_EOL;
+    if (node->kind == NFA_EOL) seeds[seed_count++] = node->out;
+  }
+  if (!(flags & DFA_ACCEPT) && seed_count > 0) {
+    new_visit(dfa, cache);
+    int eol_count = closure(dfa, cache, seeds, seed_count,
+                            (flags & DFA_BOL) != 0, 1, eol_items);
+    for (int k = 0; k < eol_count; k++) {
+      if (dfa->nodes[eol_items[k]].kind == NFA_MATCH) flags |= DFA_ACCEPT_EOL;
+    }
+  }
+  return flags;
+}
+
+static int grow_states(const dfa_t *dfa, dfa_cache_t *cache) {
+  int capacity = cache->state_capacity ? cache->state_capacity * 2 : 16;
+  if (capacity > DFA_MAX_STATES) capacity = DFA_MAX_STATES;
+  size_t row = (size_t)dfa->class_count;
+  int32_t *next =
+      realloc(cache->next, sizeof(int32_t) * row * (size_t)capacity);
+  if (next) cache->next = next;
+  unsigned char *flags = realloc(cache->flags, (size_t)capacity);
+  if (flags) cache->flags = flags;
+  int *item_start = realloc(cache->item_start, sizeof(int) * (size_t)capacity);
+  if (item_start) cache->item_start = item_start;
+  int *item_count = realloc(cache->item_count, sizeof(int) * (size_t)capacity);
+  if (item_count) cache->item_count = item_count;
+  if (!next || !flags || !item_start || !item_count) return 1;
+  cache->state_capacity = capacity;
+  return 0;
+}
+
+// Находит или добавляет состояние с множеством items (отсортированным на
+// месте; у DFA_LEFTMOST группы уже отсортированы и порядок групп важен).
+// Возвращает номер состояния или -1 при нехватке памяти.
+static int intern_state(const dfa_t *dfa, dfa_cache_t *cache, int *items,
+                        int count, unsigned char key_flags) {
+  if (!(key_flags & DFA_LEFTMOST)) {
+    qsort(items, (size_t)count, sizeof(int), compare_ints);
+  }
+  uint32_t h = 2166136261u ^ key_flags;
+  for (int k = 0; k < count; k++) h = (h ^ (uint32_t)items[k]) * 16777619u;
+
+  for (;;) {
+    uint32_t slot = h & (DFA_HASH_SIZE - 1);
+    for (; cache->hash[slot] >= 0; slot = (slot + 1) & (DFA_HASH_SIZE - 1)) {
+      int s = cache->hash[slot];
+      if ((cache->flags[s] & DFA_KEY_FLAGS) == key_flags &&
+          cache->item_count[s] == count &&
+          memcmp(cache->items + cache->item_start[s], items,
+                 sizeof(int) * (size_t)count) == 0) {
+        return s;
+      }
+    }
+    if (cache->state_count < DFA_MAX_STATES) {
+      if (cache->state_count == cache->state_capacity &&
+          grow_states(dfa, cache) != 0) {
+        return -1;
+      }
+      if (cache->item_length + (size_t)count > cache->item_capacity) {
+        size_t capacity = cache->item_capacity * 2;
+        while (capacity < cache->item_length + (size_t)count) capacity *= 2;
+        int *grown = realloc(cache->items, sizeof(int) * capacity);
+        if (!grown) return -1;
+        cache->items = grown;
+        cache->item_capacity = capacity;
+      }
+      int s = cache->state_count++;
+      memcpy(cache->items + cache->item_length, items,
+             sizeof(int) * (size_t)count);
+      cache->item_start[s] = (int)cache->item_length;
+      cache->item_count[s] = count;
+      cache->item_length += (size_t)count;
+      cache->flags[s] = state_flags(dfa, cache, items, count, key_flags);
+      int32_t *row = cache->next + (size_t)s * (size_t)dfa->class_count;
+      for (int k = 0; k < dfa->class_count; k++) row[k] = -1;
+      cache->hash[slot] = s;
+      return s;
+    }
+    // Кэш заполнен: начинаем строить ДКА заново
+    flush_states(cache);
+  }
+}
+
+static int initial_state(const dfa_t *dfa, dfa_cache_t *cache, int anchored,
+                         int bol) {
+  int *slot = &cache->initial[anchored * 2 + bol];
+  if (*slot < 0) {
+    new_visit(dfa, cache);
+    int count = closure(dfa, cache, &dfa->start, 1, bol, 0, cache->scratch);
+    int s = intern_state(dfa, cache, cache->scratch, count,
+                         (unsigned char)((anchored ? DFA_ANCHORED : 0) |
+                                         (bol ? DFA_BOL : 0)));
+    // intern_state() мог сбросить кэш вместе с initial
+    cache->initial[anchored * 2 + bol] = s;
+  }
+  return *slot;
+}
+
+// Узлы, в которые ведут из items[0..count) переходы по байту c
+static int byte_targets(const dfa_t *dfa, const int *items, int count,
+                        unsigned char c, int *seeds) {
+  int seed_count = 0;
+  for (int k = 0; k < count; k++) {
+    const nfa_node_t *node = &dfa->nodes[items[k]];
+    if (node->kind == NFA_SET && set_has(&dfa->sets[node->set], c)) {
+      seeds[seed_count++] = node->out;
+    }
+  }
+  return seed_count;
+}
+
+// Добавляет в groups[*length] группу узлов из замыкания seeds (без уже
+// пройденных в этом переходе) и её конец GROUP_END. Возвращает 1, если в
+// группе есть совпадение.
+static int add_group(const dfa_t *dfa, dfa_cache_t *cache, const int *seeds,
+                     int seed_count, int bol, int *length) {
+  int *group = cache->groups + *length;
+  int count = closure(dfa, cache, seeds, seed_count, bol, 0, group);
+  if (count == 0) return 0;
+  qsort(group, (size_t)count, sizeof(int), compare_ints);
+  int matched = 0;
+  for (int k = 0; k < count; k++) {
+    if (dfa->nodes[group[k]].kind == NFA_MATCH) matched = 1;
+  }
+  group[count] = GROUP_END;
+  *length += count + 1;
+  return matched;
+}
+
+// Переход состояния DFA_LEFTMOST. Группы идут в порядке начала
+// совпадения, новое начало - последней группой. Группа, дошедшая до
+// совпадения, отбрасывает все более поздние, и новых начал больше нет:
+// состояние становится DFA_ANCHORED.
+static int leftmost_successor(const dfa_t *dfa, dfa_cache_t *cache, int state,
+                              unsigned char c) {
+  int *seeds = cache->scratch + dfa->node_count * 2;
+  const int *items = cache->items + cache->item_start[state];
+  int count = cache->item_count[state];
+  unsigned char anchored = cache->flags[state] & DFA_ANCHORED;
+  int length = 0;
+  int matched = 0;
+  new_visit(dfa, cache);
+  for (int k = 0; k < count && !matched; k++) {
+    int group_start = k;
+    while (items[k] != GROUP_END) k++;
+    int seed_count = byte_targets(dfa, items + group_start, k - group_start,
+                                  c, seeds);
+    matched = add_group(dfa, cache, seeds, seed_count, 0, &length);
+  }
+  if (!matched && !anchored) {
+    matched = add_group(dfa, cache, &dfa->start, 1, 0, &length);
+  }
+  if (matched) anchored = DFA_ANCHORED;
+  return intern_state(dfa, cache, cache->groups, length,
+                      DFA_LEFTMOST | anchored);
+}
+
+// Переход из state по байту c (не '\n'), с построением нового состояния
+static int step(const dfa_t *dfa, dfa_cache_t *cache, int state,
+                unsigned char c) {
+  unsigned flushes = cache->flushes;
+  int next;
+  if (cache->flags[state] & DFA_LEFTMOST) {
+    next = leftmost_successor(dfa, cache, state, c);
+  } else {
+    int *seeds = cache->scratch + dfa->node_count * 2;
+    int seed_count =
+        byte_targets(dfa, cache->items + cache->item_start[state],
+                     cache->item_count[state], c, seeds);
+    unsigned char anchored = cache->flags[state] & DFA_ANCHORED;
+    // Без привязки совпадение может начаться с любой позиции
+    if (!anchored) seeds[seed_count++] = dfa->start;
+    new_visit(dfa, cache);
+    int count = closure(dfa, cache, seeds, seed_count, 0, 0, cache->scratch);
+    next = intern_state(dfa, cache, cache->scratch, count, anchored);
+  }
+  if (next >= 0 && cache->flushes == flushes) {
+    int special = cache->flags[next] & (DFA_ACCEPT | DFA_DEAD);
+    size_t row = (size_t)dfa->class_count;
+    cache->next[(size_t)state * row + dfa->byte_class[c]] =
+        special ? DFA_SPECIAL(next) : next;
+  }
+  return next;
+}
+
+// Следующее состояние после байта c (не '\n') из медленного пути
+static int slow_step(const dfa_t *dfa, dfa_cache_t *cache, int state,
+                     unsigned char c) {
+  size_t row = (size_t)dfa->class_count;
+  int32_t next = cache->next[(size_t)state * row + dfa->byte_class[c]];
+  if (next == -1) return step(dfa, cache, state, c);
+  return next < 0 ? DFA_SPECIAL(next) : next;
+}
+
+// Строит все переходы начального состояния без привязки и отмечает байты,
+// которые из него выводят. Без ^ и $ '\n' возвращает в то же множество
+// узлов, поэтому тоже пропускается.
+static int prepare_skip(const dfa_t *dfa, dfa_cache_t *cache) {
+  unsigned flushes = cache->flushes;
+  int start = initial_state(dfa, cache, 0, 0);
+  if (start < 0) return -1;
+  for (int c = 0; c < 256; c++) {
+    int next =
+        c == '\n' ? start : slow_step(dfa, cache, start, (unsigned char)c);
+    if (next < 0) return -1;
+    cache->skip_stop[c] = next != start || (c == '\n' && dfa->has_anchors);
+  }
+  // Если кэш сбросился, номер start уже не действителен
+  if (cache->flushes == flushes) cache->skip_state = start;
+  return 0;
+}
+
+int dfa_search(const dfa_t *dfa, dfa_cache_t *cache, const char *text,
+               const char *from, const char *end, const char **found) {
+  if (cache->skip_state < 0 && prepare_skip(dfa, cache) != 0) return -1;
+  int state = initial_state(dfa, cache, 0, from == text || from[-1] == '\n');
+  const char *p = from;
+  for (;;) {
+    if (state < 0) return -1;
+    unsigned char flags = cache->flags[state];
+    if (flags & DFA_ACCEPT) {
+      *found = p;
+      return 1;
+    }
+    if (flags & DFA_DEAD) {
+      // Без привязки пустое множество не изменится до конца строки
+      p = memchr(p, '\n', (size_t)(end - p));
+      if (!p) return 0;
+    } else {
+      // Быстрый цикл: обычные переходы, которые уже построены
+      const int32_t *next = cache->next;
+      const unsigned char *byte_class = dfa->byte_class;
+      size_t row = (size_t)dfa->class_count;
+      const unsigned char *stop = cache->skip_stop;
+      while (p < end) {
+        if (state == cache->skip_state) {
+          // Байты, не выводящие из начального состояния, пропускаются
+          // без переходов: проверки четырёх байтов не зависят друг от друга
+          const unsigned char *u = (const unsigned char *)p;
+          const unsigned char *u_end = (const unsigned char *)end;
+          while (u_end - u >= 4 &&
+                 !(stop[u[0]] | stop[u[1]] | stop[u[2]] | stop[u[3]])) {
+            u += 4;
+          }
+          while (u < u_end && !stop[*u]) u++;
+          p = (const char *)u;
+          if (p == end) break;
+        }
+        size_t index = (size_t)state * row + byte_class[(unsigned char)*p];
+        int32_t n = next[index];
+        if (n < 0) break;
+        state = n;
+        p++;
+      }
+      flags = cache->flags[state];
+    }
+    if (p == end || *p == '\n') {
+      if (flags & DFA_ACCEPT_EOL) {
+        *found = p;
+        return 1;
+      }
+      if (p == end) return 0;
+      state = initial_state(dfa, cache, 0, 1);
+      p++;
+      continue;
+    }
+    unsigned char c = (unsigned char)*p++;
+    state = slow_step(dfa, cache, state, c);
+  }
+}
+
+// Начальное состояние DFA_LEFTMOST: одна группа, начало совпадения здесь
+static int leftmost_initial(const dfa_t *dfa, dfa_cache_t *cache, int bol) {
+  int *slot = &cache->initial[DFA_LEFTMOST_INITIAL + bol];
+  if (*slot < 0) {
+    int length = 0;
+    new_visit(dfa, cache);
+    int matched = add_group(dfa, cache, &dfa->start, 1, bol, &length);
+    int s = intern_state(
+        dfa, cache, cache->groups, length,
+        (unsigned char)(DFA_LEFTMOST | (matched ? DFA_ANCHORED : 0) |
+                        (bol ? DFA_BOL : 0)));
+    // intern_state() мог сбросить кэш вместе с initial
+    cache->initial[DFA_LEFTMOST_INITIAL + bol] = s;
+  }
+  return *slot;
+}
+
+// Конец самого левого, а из них самого длинного совпадения в строке,
+// которая начинается в start: последнее допускающее состояние до того,
+// как у самой ранней совпавшей группы не останется продолжений
+static int leftmost_end(const dfa_t *dfa, dfa_cache_t *cache,
+                        const char *text, const char *start, const char *end,
+                        const char **match_end) {
+  int state = leftmost_initial(dfa, cache, start == text || start[-1] == '\n');
+  const char *last = NULL;
+  const char *p = start;
+  for (;;) {
+    if (state < 0) return -1;
+    unsigned char flags = cache->flags[state];
+    if (flags & DFA_ACCEPT) last = p;
+    if (flags & DFA_DEAD) break;
+    if (p == end || *p == '\n') {
+      if (flags & DFA_ACCEPT_EOL) last = p;
+      break;
+    }
+    unsigned char c = (unsigned char)*p++;
+    state = slow_step(dfa, cache, state, c);
+  }
+  if (!last) return 0;
+  *match_end = last;
+  return 1;
+}
+
+// Начало самого длинного совпадения, которое заканчивается в match_end и
+// начинается не раньше limit: обращённый шаблон читается от match_end
+// справа налево
+static int reverse_start(const dfa_t *reverse, dfa_cache_t *cache,
+                         const char *text, const char *limit,
+                         const char *match_end, const char *end,
+                         const char **match_start) {
+  int state = initial_state(reverse, cache, 1,
+                            match_end == end || *match_end == '\n');
+  const char *last = NULL;
+  const char *p = match_end;
+  for (;;) {
+    if (state < 0) return -1;
+    unsigned char flags = cache->flags[state];
+    if (flags & DFA_ACCEPT) last = p;
+    if (flags & DFA_DEAD) break;
+    if (p == text || p[-1] == '\n') {
+      if (flags & DFA_ACCEPT_EOL) last = p;
+      break;
+    }
+    if (p == limit) break;
+    unsigned char c = (unsigned char)*--p;
+    state = slow_step(reverse, cache, state, c);
+  }
+  if (!last) return 0;
+  *match_start = last;
+  return 1;
+}
+
+// Ближайший конец совпадения даёт строку с самым левым совпадением. Конец
+// самого левого совпадения находит один проход DFA_LEFTMOST по этой
+// строке, его начало - один проход обращённого шаблона назад от конца.
+int dfa_match(const dfa_t *dfa, dfa_cache_t *cache, const dfa_t *reverse,
+              dfa_cache_t *reverse_cache, const char *text, const char *from,
+              const char *end, size_t *match_start, size_t *match_end) {
+  const char *first_end;
+  int status = dfa_search(dfa, cache, text, from, end, &first_end);
+  if (status <= 0) return status;
+
+  const char *line = memrchr(from, '\n', (size_t)(first_end - from));
+  line = line ? line + 1 : from;
+  const char *last_end;
+  const char *first_start;
+  status = leftmost_end(dfa, cache, text, line, end, &last_end);
+  if (status > 0) {
+    status = reverse_start(reverse, reverse_cache, text, line, last_end, end,
+                           &first_start);
+  }
+  if (status <= 0) return status;
+  *match_start = (size_t)(first_start - from);
+  *match_end = (size_t)(last_end - from);
+  return 1;
+}
@@ -0,0 +1,115 @@
+#ifndef S21_GREP_DFA_H
+#define S21_GREP_DFA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Предел узлов НКА: шаблоны с большими повторами {n,m} остаются за regexec()
+#define NFA_MAX_NODES 4096
+// Предел состояний ДКА: при переполнении построенные состояния сбрасываются
+// и строятся заново по ходу поиска
+#define DFA_MAX_STATES 1024
+
+// Флаги состояния ДКА
+#define DFA_ACCEPT 1      // Здесь заканчивается совпадение
+#define DFA_ACCEPT_EOL 2  // То же, если дальше '\n' или конец текста
+#define DFA_BOL 4         // Состояние начала строки
+#define DFA_ANCHORED 8    // Совпадение начинается только с первой позиции
+#define DFA_DEAD 16       // Совпадений дальше быть не может
+// Узлы разбиты на группы по началу совпадения: ищется конец самого левого
+// совпадения, а не ближайший
+#define DFA_LEFTMOST 32
+
+// Начальных состояний: 4 обычных и 2 DFA_LEFTMOST
+#define DFA_INITIAL_STATES 6
+
+typedef struct {
+  uint32_t bits[8];
+} byte_set_t;
+
+// Узел НКА Томпсона
+typedef struct {
+  unsigned char kind;  // NFA_*
+  int out;             // Следующий узел
+  int out1;            // Вторая ветка NFA_SPLIT
+  int set;             // Множество байтов NFA_SET
+} nfa_node_t;
+
+// ERE из поддерживаемого подмножества (без обратных ссылок и GNU-расширений
+// \w, \b, \< ...), скомпилированный в НКА. После компиляции только
+// читается и может быть общим для потоков поиска.
+typedef struct {
+  nfa_node_t *nodes;
+  int node_count;
+  int node_capacity;
+  byte_set_t *sets;
+  int set_count;
+  int set_capacity;
+  int start;
+  int has_anchors;  // В шаблоне есть ^ или $
+
+  // Байты, неразличимые для всех множеств, объединены в классы
+  unsigned char byte_class[256];
+  int class_count;
+} dfa_t;
+
+// ДКА одного dfa_t, построенный лениво во время поиска. Кэш меняется при
+// каждом поиске, поэтому у каждого потока поиска он свой.
+typedef struct {
+  // Состояния ДКА: множество узлов НКА items[item_start[s]...] и переходы
+  // next[s * class_count + класс байта] (-1 - переход ещё не построен)
+  int32_t *next;
+  unsigned char *flags;
+  int *item_start;
+  int *item_count;
+  int state_count;
+  int state_capacity;
+  int *items;
+  size_t item_length;
+  size_t item_capacity;
+  int *hash;           // Открытая адресация: номер состояния или -1
+  // Начальные состояния [anchored * 2 + bol], DFA_LEFTMOST - [4 + bol]
+  int initial[DFA_INITIAL_STATES];
+  unsigned flushes;    // Сколько раз кэш сбрасывался
+
+  // Начальное состояние поиска без привязки (или -1, пока не построено) и
+  // байты, по которым из него есть переход в другое состояние
+  int skip_state;
+  unsigned char skip_stop[256];
+
+  // Рабочие массивы для замыканий
+  int *stack;
+  int *scratch;
+  unsigned *visited;
+  unsigned visit_mark;
+  int *groups;  // Узлы нового состояния DFA_LEFTMOST
+} dfa_cache_t;
+
+// Компилирует ERE (в локали C, байт - символ). Возвращает 0, 1 при нехватке
+// памяти или 2, если шаблон вне поддерживаемого подмножества и должен
+// искаться через regexec().
+int dfa_compile(const char *pattern, int ignore_case, dfa_t *dfa);
+// То же для текста, прочитанного справа налево: по нему dfa_match() ищет
+// начало совпадения
+int dfa_compile_reverse(const char *pattern, int ignore_case, dfa_t *dfa);
+void dfa_free(dfa_t *dfa);
+
+// Пустой кэш для dfa. Возвращает 0 или 1 при нехватке памяти.
+int dfa_cache_init(dfa_cache_t *cache, const dfa_t *dfa);
+void dfa_cache_free(dfa_cache_t *cache);
+
+// Ищет в [from, end) ближайший к from конец совпадения. Символы до from из
+// text видны как контекст для ^. Возвращает 1 и позицию в found, 0 или -1
+// при нехватке памяти (тогда поиск нужно повторить через regexec()).
+int dfa_search(const dfa_t *dfa, dfa_cache_t *cache, const char *text,
+               const char *from, const char *end, const char **found);
+
+// Самое левое, а из них самое длинное совпадение в [from, end), как у
+// regexec(), за время, линейное по длине строки. reverse - тот же шаблон из
+// dfa_compile_reverse() со своим кэшем. Границы возвращаются относительно
+// from. Возвращает 1, 0 или -1 при нехватке памяти.
+int dfa_match(const dfa_t *dfa, dfa_cache_t *cache, const dfa_t *reverse,
+              dfa_cache_t *reverse_cache, const char *text, const char *from,
+              const char *end, size_t *match_start, size_t *match_end);
+
+#endif
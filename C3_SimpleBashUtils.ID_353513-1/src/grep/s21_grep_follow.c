@@ -0,0 +1,283 @@
+#include "s21_grep_follow.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+
+// Изменения самого файла и его замена при ротации
+#define FOLLOW_FILE_EVENTS (IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF)
+// Новый файл под отслеживаемым именем
+#define FOLLOW_DIR_EVENTS (IN_CREATE | IN_MOVED_TO)
+
+typedef struct {
+  const char *path;
+  const char *name;  // Имя в каталоге для событий каталога
+  int fd;            // Открытый файл или -1, пока файла нет
+  int wd;            // Наблюдение за открытым файлом (по inode)
+  int dir_wd;
+  int dirty;  // Файл или каталог изменился: нужен поиск
+  int done;   // -l или -m: в файле больше не ищется
+  long matches;
+} followed_t;
+
+typedef struct {
+  int inotify_fd;
+  followed_t *files;
+  int file_count;
+  grep_options_t opts;
+  const compiled_patterns_t *compiled;
+  output_t *out;
+  output_t *err;
+  int *error_occurred;
+} follow_t;
+
+static void follow_error(follow_t *follow, const char *path, int error) {
+  if (!follow->opts.suppress_errors) {
+    output_printf(follow->err, "grep: %s: %s\n", path, strerror(error));
+  }
+  *follow->error_occurred = 1;
+}
+
+// Открывает файл под именем path и следит за ним. Наблюдение ставится до
+// открытия: запись между ними тоже придёт событием.
+static void open_file(follow_t *follow, followed_t *file) {
+  file->wd = inotify_add_watch(follow->inotify_fd, file->path,
+                               FOLLOW_FILE_EVENTS);
+  file->fd = file->wd >= 0 ? open(file->path, O_RDONLY | O_CLOEXEC) : -1;
+  // Отсутствующий файл уже назван в main(); он ищется, когда появится
+  if (file->fd < 0 && errno != ENOENT) follow_error(follow, file->path, errno);
+  if (file->fd < 0 && file->wd >= 0) {
+    inotify_rm_watch(follow->inotify_fd, file->wd);
+    file->wd = -1;
+  }
+}
+
+static void close_file(follow_t *follow, followed_t *file) {
+  if (file->wd >= 0) inotify_rm_watch(follow->inotify_fd, file->wd);
+  if (file->fd >= 0) close(file->fd);
+  file->wd = -1;
+  file->fd = -1;
+}
+
+// Под именем файла теперь другой файл (ротация) или его нет
+static int replaced(const followed_t *file) {
+  struct stat opened, named;
+  if (stat(file->path, &named) != 0) return 0;
+  return file->fd < 0 || fstat(file->fd, &opened) != 0 ||
+         opened.st_dev != named.st_dev || opened.st_ino != named.st_ino;
+}
+
+// Каталог файла; строка выделяется
+static char *parent_dir(const char *path) {
+  const char *slash = strrchr(path, '/');
+  if (!slash) return strdup(".");
+  size_t length = slash == path ? 1 : (size_t)(slash - path);
+  return strndup(path, length);
+}
+
+// Конец последней целой строки и число строк до него (только для -n).
+// Возвращает 1, если файл укоротили.
+static int locate_end(const input_map_t *map, int count_lines, size_t *stop,
+                      size_t *lines) {
+  sigjmp_buf env;
+  INPUT_ARM_FAULT(env);
+  if (sigsetjmp(env, 1) != 0) return 1;
+  const char *last = memrchr(map->data, '\n', map->size);
+  *stop = last ? (size_t)(last - map->data) + 1 : 0;
+  *lines = count_lines ? count_newlines(map->data, map->data + *stop) : 0;
+  INPUT_RELEASE_FAULT();
+  return 0;
+}
+
+// Без сохранённого места поиск начинается после последней целой строки,
+// которая уже есть в файле
+static void start_at_end(follow_t *follow, const followed_t *file) {
+  int fd = file->fd;
+  struct stat st;
+  uint64_t offset, lines;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+      !state_lookup(follow->opts.state, file->path, fd, &st, &offset, &lines)) {
+    input_map_t map;
+    size_t stop = 0;
+    size_t newlines = 0;
+    if (st.st_size > 0 && input_map(fd, INPUT_MMAP, &map) == 0) {
+      if (locate_end(&map, follow->opts.line_number, &stop, &newlines)) {
+        stop = 0;
+        newlines = 0;
+      }
+      input_unmap(&map);
+    }
+    if (state_update(follow->opts.state, file->path, fd, &st, stop, newlines)) {
+      follow_error(follow, file->path, ENOMEM);
+    }
+  }
+}
+
+static void handle_event(follow_t *follow, const struct inotify_event *event) {
+  for (int i = 0; i < follow->file_count; i++) {
+    followed_t *file = &follow->files[i];
+    // Переименованный или удалённый файл остаётся открытым: он дочитывается
+    // при поиске, до перехода на новый файл под тем же именем
+    if ((event->mask & IN_Q_OVERFLOW) ||
+        (file->wd >= 0 && event->wd == file->wd) ||
+        (event->wd == file->dir_wd && event->len > 0 &&
+         (event->mask & FOLLOW_DIR_EVENTS) &&
+         strcmp(event->name, file->name) == 0)) {
+      file->dirty = 1;
+    }
+  }
+}
+
+static int search_fd(follow_t *follow, followed_t *file) {
+  grep_options_t opts = follow->opts;
+  // -m ограничивает выбранные строки файла за всё время слежения
+  if (follow->opts.max_count > 0) {
+    opts.max_count = follow->opts.max_count - file->matches;
+  }
+  int matches = process_fd(file->path, file->fd, opts, follow->compiled,
+                           follow->file_count > 1, follow->out, follow->err,
+                           follow->error_occurred);
+  file->matches += matches;
+  if ((opts.list_files && matches > 0) ||
+      (follow->opts.max_count > 0 &&
+       file->matches >= follow->opts.max_count)) {
+    file->done = 1;
+  }
+  return matches;
+}
+
+// Ищет в изменившихся файлах; возвращает число совпадений. Открытый файл
+// сначала дочитывается до конца; если под его именем уже другой файл,
+// поиск переходит на него, и новый файл ищется с начала.
+static int search_dirty(follow_t *follow) {
+  int match_count = 0;
+  for (int i = 0; i < follow->file_count; i++) {
+    followed_t *file = &follow->files[i];
+    if (!file->dirty || file->done) continue;
+    file->dirty = 0;
+    if (file->fd >= 0) match_count += search_fd(follow, file);
+    if (!file->done && replaced(file)) {
+      close_file(follow, file);
+      open_file(follow, file);
+      if (file->fd >= 0) match_count += search_fd(follow, file);
+    }
+  }
+  state_commit(follow->opts.state);
+  if (output_flush(follow->out)) *follow->error_occurred = 1;
+  return match_count;
+}
+
+static int all_done(const follow_t *follow) {
+  for (int i = 0; i < follow->file_count; i++) {
+    if (!follow->files[i].done) return 0;
+  }
+  return 1;
+}
+
+// Ждёт событий, пока не придёт сигнал завершения
+static int follow_loop(follow_t *follow, int signal_fd) {
+  int match_count = 0;
+  char *events = malloc(FOLLOW_EVENT_BUFFER);
+  if (!events) {
+    follow_error(follow, "--follow", ENOMEM);
+    return 0;
+  }
+  for (;;) {
+    match_count += search_dirty(follow);
+    if ((follow->opts.quiet && match_count > 0) || all_done(follow)) break;
+
+    struct pollfd fds[2] = {{follow->inotify_fd, POLLIN, 0},
+                            {signal_fd, POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      follow_error(follow, "--follow", errno);
+      break;
+    }
+    if (fds[1].revents) {
+      // Сигнал забирается, иначе он сработает после снятия блокировки
+      struct signalfd_siginfo info;
+      ssize_t got = read(signal_fd, &info, sizeof(info));
+      (void)got;
+      break;
+    }
+    ssize_t length = read(follow->inotify_fd, events, FOLLOW_EVENT_BUFFER);
+    if (length < 0) {
+      if (errno == EINTR || errno == EAGAIN) continue;
+      follow_error(follow, "--follow", errno);
+      break;
+    }
+    for (char *pos = events; pos < events + length;) {
+      const struct inotify_event *event = (const struct inotify_event *)pos;
+      handle_event(follow, event);
+      pos += sizeof(struct inotify_event) + event->len;
+    }
+  }
+  free(events);
+  return match_count;
+}
+
+int grep_follow(char **files, int file_count, grep_options_t opts,
+                const compiled_patterns_t *compiled, output_t *out,
+                output_t *err, int *error_occurred) {
+  follow_t follow = {.inotify_fd = -1,
+                     .file_count = file_count,
+                     .opts = opts,
+                     .compiled = compiled,
+                     .out = out,
+                     .err = err,
+                     .error_occurred = error_occurred};
+  followed_t *followed = calloc((size_t)file_count, sizeof(followed_t));
+  char **dirs = calloc((size_t)file_count, sizeof(char *));
+  // SIGINT и SIGTERM читаются из signalfd: сигнал между проверкой и poll()
+  // не теряется
+  sigset_t mask, old_mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigprocmask(SIG_BLOCK, &mask, &old_mask);
+  int signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+  follow.inotify_fd = inotify_init1(IN_CLOEXEC);
+  follow.files = followed;
+  for (int i = 0; followed && i < file_count; i++) {
+    followed[i].fd = -1;
+    followed[i].wd = -1;
+  }
+
+  int match_count = 0;
+  if (!followed || !dirs) {
+    follow_error(&follow, "--follow", ENOMEM);
+  } else if (signal_fd < 0 || follow.inotify_fd < 0) {
+    follow_error(&follow, "--follow", errno);
+  } else {
+    for (int i = 0; i < file_count; i++) {
+      followed_t *file = &followed[i];
+      file->path = files[i];
+      const char *slash = strrchr(files[i], '/');
+      file->name = slash ? slash + 1 : files[i];
+      dirs[i] = parent_dir(files[i]);
+      file->dir_wd = dirs[i] ? inotify_add_watch(follow.inotify_fd, dirs[i],
+                                                 FOLLOW_DIR_EVENTS)
+                             : -1;
+      if (file->dir_wd < 0) follow_error(&follow, files[i], errno);
+      open_file(&follow, file);
+      if (file->fd >= 0) {
+        start_at_end(&follow, file);
+        file->dirty = 1;
+      }
+    }
+    state_commit(opts.state);
+    match_count = follow_loop(&follow, signal_fd);
+  }
+
+  if (follow.inotify_fd >= 0) close(follow.inotify_fd);
+  if (signal_fd >= 0) close(signal_fd);
+  sigprocmask(SIG_SETMASK, &old_mask, NULL);
+  for (int i = 0; followed && i < file_count; i++) {
+    if (followed[i].fd >= 0) close(followed[i].fd);
+  }
+  for (int i = 0; dirs && i < file_count; i++) free(dirs[i]);
+  free(dirs);
+  free(followed);
+  return match_count;
+}
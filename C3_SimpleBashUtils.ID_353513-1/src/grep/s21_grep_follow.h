@@ -0,0 +1,22 @@
+#ifndef S21_GREP_FOLLOW_H
+#define S21_GREP_FOLLOW_H
+
+#include "s21_grep.h"
+
+// Буфер событий inotify за одно чтение
+#define FOLLOW_EVENT_BUFFER (64 * 1024)
+
+// --follow: ищет в строках, которые дописываются в files[] после запуска,
+// пока не придёт SIGINT или SIGTERM. Файлы не опрашиваются: об изменениях
+// сообщает inotify, и каждый изменённый файл ищется process_fd() в
+// открытом fd через состояние в памяти (opts.state), поэтому через
+// шаблоны проходят только новые целые строки. С --state-file поиск
+// начинается с сохранённого места, иначе с конца файла. Ротация: файл,
+// который переименовали или удалили, остаётся открытым и дочитывается до
+// конца, а когда под его именем появится новый, новый ищется с начала;
+// усечённый файл тоже ищется с начала. Возвращает сумму совпадений.
+int grep_follow(char **files, int file_count, grep_options_t opts,
+                const compiled_patterns_t *compiled, output_t *out,
+                output_t *err, int *error_occurred);
+
+#endif
@@ -0,0 +1,531 @@
+#include "s21_grep_index.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Триграмма - 24 бита: множество триграмм файла помещается в битовую
+// карту на 2 МБ
+#define TRIGRAM_SPACE (1u << 24)
+
+static unsigned char lower_ascii(unsigned char c) {
+  return c >= 'A' && c <= 'Z' ? (unsigned char)(c | 0x20) : c;
+}
+
+static size_t align8(size_t offset) { return (offset + 7) & ~(size_t)7; }
+
+// Путь к файлу индекса каталога dir
+static char *index_path(const char *dir, const char *suffix) {
+  size_t length = strlen(dir);
+  int slash = length > 0 && dir[length - 1] != '/';
+  size_t size = length + (size_t)slash + strlen(INDEX_FILE_NAME) +
+                strlen(suffix) + 1;
+  char *path = malloc(size);
+  if (path) {
+    snprintf(path, size, "%s%s%s%s", dir, slash ? "/" : "", INDEX_FILE_NAME,
+             suffix);
+  }
+  return path;
+}
+
+// Сам индекс (и его временный файл) в корне каталога не индексируется и не
+// ищется
+static int is_index_file(const char *relative_path) {
+  return strcmp(relative_path, INDEX_FILE_NAME) == 0 ||
+         strcmp(relative_path, INDEX_FILE_NAME ".tmp") == 0;
+}
+
+// Построение индекса
+
+typedef struct {
+  char *path;            // Путь для open()
+  const char *relative;  // Его часть относительно каталога
+  struct stat st;        // Состояние до чтения
+} build_file_t;
+
+typedef struct {
+  uint64_t *seen;  // Битовая карта триграмм текущего файла
+  uint32_t *list;  // Они же списком, чтобы очистить карту
+  size_t list_count;
+  size_t list_capacity;
+  uint64_t *pairs;  // (триграмма << 32) | номер файла по всем файлам
+  size_t pair_count;
+  size_t pair_capacity;
+} trigram_set_t;
+
+static int compare_files(const void *a, const void *b) {
+  return strcmp(((const build_file_t *)a)->relative,
+                ((const build_file_t *)b)->relative);
+}
+
+static int compare_pairs(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static int grow(void **array, size_t *capacity, size_t item_size) {
+  size_t new_capacity = *capacity ? *capacity * 2 : 4096;
+  void *grown = realloc(*array, new_capacity * item_size);
+  if (!grown) return 1;
+  *array = grown;
+  *capacity = new_capacity;
+  return 0;
+}
+
+// Добавляет триграммы [data, data + length) в множество файла. Триграммы
+// через '\n' не нужны: литерал шаблона не переходит на другую строку.
+static int add_trigrams(trigram_set_t *set, const unsigned char *data,
+                        size_t length, uint32_t *window, int *valid) {
+  for (size_t i = 0; i < length; i++) {
+    if (data[i] == '\n') {
+      *valid = 0;
+      continue;
+    }
+    *window = ((*window << 8) | lower_ascii(data[i])) & (TRIGRAM_SPACE - 1);
+    if (*valid < 3) (*valid)++;
+    if (*valid < 3) continue;
+    uint64_t bit = (uint64_t)1 << (*window & 63);
+    if (set->seen[*window >> 6] & bit) continue;
+    set->seen[*window >> 6] |= bit;
+    if (set->list_count == set->list_capacity &&
+        grow((void **)&set->list, &set->list_capacity, sizeof(uint32_t))) {
+      return 1;
+    }
+    set->list[set->list_count++] = *window;
+  }
+  return 0;
+}
+
+// Переносит триграммы файла id в общий список пар и очищает множество
+static int flush_trigrams(trigram_set_t *set, uint32_t id) {
+  int failed = 0;
+  for (size_t i = 0; i < set->list_count; i++) {
+    uint32_t trigram = set->list[i];
+    set->seen[trigram >> 6] = 0;
+    if (failed) continue;
+    if (set->pair_count == set->pair_capacity &&
+        grow((void **)&set->pairs, &set->pair_capacity, sizeof(uint64_t))) {
+      failed = 1;
+      continue;
+    }
+    set->pairs[set->pair_count++] = (uint64_t)trigram << 32 | id;
+  }
+  set->list_count = 0;
+  return failed;
+}
+
+// Читает файл и собирает его триграммы. Возвращает 0 или errno.
+static int index_one_file(build_file_t *file, trigram_set_t *set,
+                          unsigned char *buffer) {
+  int fd = open(file->path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return errno;
+  int error = 0;
+  if (fstat(fd, &file->st) != 0) error = errno;
+  uint32_t window = 0;
+  int valid = 0;
+  while (!error) {
+    ssize_t got = read(fd, buffer, INDEX_READ_SIZE);
+    if (got < 0 && errno == EINTR) continue;
+    if (got < 0) error = errno;
+    if (got <= 0) break;
+    if (add_trigrams(set, buffer, (size_t)got, &window, &valid)) {
+      error = ENOMEM;
+    }
+  }
+  close(fd);
+  return error;
+}
+
+static void put_varint(unsigned char **p, uint32_t value) {
+  while (value >= 0x80) {
+    *(*p)++ = (unsigned char)(value | 0x80);
+    value >>= 7;
+  }
+  *(*p)++ = (unsigned char)value;
+}
+
+// Записывает индекс в stream. Пары отсортированы, номера файлов - позиции
+// в files. Возвращает 0 или 1.
+static int write_index(FILE *stream, const build_file_t *files,
+                       uint32_t file_count, const uint64_t *pairs,
+                       size_t pair_count) {
+  index_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+  header.file_count = file_count;
+  for (size_t i = 0; i < pair_count; i++) {
+    if (i == 0 || pairs[i] >> 32 != pairs[i - 1] >> 32) {
+      header.trigram_count++;
+    }
+  }
+  size_t names_size = 0;
+  for (uint32_t i = 0; i < file_count; i++) {
+    names_size += strlen(files[i].relative);
+  }
+  header.files_offset = align8(sizeof(header));
+  header.names_offset = header.files_offset + file_count * sizeof(index_file_t);
+  header.trigrams_offset = align8(header.names_offset + names_size);
+  header.postings_offset =
+      header.trigrams_offset + header.trigram_count * sizeof(index_trigram_t);
+
+  // Каждый номер в varint занимает не больше 5 байт
+  unsigned char *postings = malloc(pair_count * 5 + 1);
+  index_trigram_t *trigrams =
+      malloc(sizeof(index_trigram_t) * (header.trigram_count + 1));
+  if (!postings || !trigrams) {
+    free(postings);
+    free(trigrams);
+    return 1;
+  }
+  unsigned char *p = postings;
+  uint32_t t = 0;
+  uint32_t previous = 0;
+  for (size_t i = 0; i < pair_count; i++) {
+    uint32_t trigram = (uint32_t)(pairs[i] >> 32);
+    uint32_t id = (uint32_t)pairs[i];
+    if (i == 0 || trigram != trigrams[t - 1].trigram) {
+      trigrams[t].trigram = trigram;
+      trigrams[t].file_count = 0;
+      trigrams[t].postings = (uint64_t)(p - postings);
+      t++;
+      previous = 0;
+    }
+    put_varint(&p, id - previous);
+    previous = id;
+    trigrams[t - 1].file_count++;
+  }
+  header.total_size = header.postings_offset + (uint64_t)(p - postings);
+
+  static const char padding[8] = {0};
+  int failed = fwrite(&header, sizeof(header), 1, stream) != 1;
+  size_t name_offset = 0;
+  for (uint32_t i = 0; i < file_count && !failed; i++) {
+    index_file_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.size = (uint64_t)files[i].st.st_size;
+    entry.mtime_sec = files[i].st.st_mtim.tv_sec;
+    entry.mtime_nsec = files[i].st.st_mtim.tv_nsec;
+    entry.name_offset = name_offset;
+    entry.name_length = (uint32_t)strlen(files[i].relative);
+    name_offset += entry.name_length;
+    failed = fwrite(&entry, sizeof(entry), 1, stream) != 1;
+  }
+  for (uint32_t i = 0; i < file_count && !failed; i++) {
+    failed = fputs(files[i].relative, stream) == EOF;
+  }
+  size_t pad = header.trigrams_offset - (header.names_offset + names_size);
+  if (!failed && pad) failed = fwrite(padding, 1, pad, stream) != pad;
+  if (!failed && t) {
+    failed = fwrite(trigrams, sizeof(index_trigram_t), t, stream) != t;
+  }
+  size_t postings_size = (size_t)(p - postings);
+  if (!failed && postings_size) {
+    failed = fwrite(postings, 1, postings_size, stream) != postings_size;
+  }
+  free(postings);
+  free(trigrams);
+  return failed;
+}
+
+// Собирает обычные файлы каталога в порядке путей
+static build_file_t *collect_files(walker_t *walker, size_t *count) {
+  build_file_t *files = NULL;
+  size_t capacity = 0;
+  *count = 0;
+  while (walk_next(walker)) {
+    const char *relative = walk_relative_path(walker);
+    if (is_index_file(relative)) continue;
+    if ((*count == capacity &&
+         grow((void **)&files, &capacity, sizeof(build_file_t))) ||
+        !(files[*count].path = strdup(walker->path))) {
+      fprintf(stderr, "grep: memory allocation failed\n");
+      walker->error_occurred = 1;
+      break;
+    }
+    build_file_t *file = &files[*count];
+    file->relative = file->path + (relative - walker->path);
+    (*count)++;
+  }
+  if (files) qsort(files, *count, sizeof(build_file_t), compare_files);
+  return files;
+}
+
+int index_build(const char *dir, int follow_links, int suppress_errors) {
+  walk_filter_t no_filter = {0};
+  walker_t walker;
+  int error = walk_open(&walker, dir, follow_links, &no_filter,
+                        suppress_errors);
+  if (error) {
+    if (!suppress_errors) {
+      fprintf(stderr, "grep: %s: %s\n", dir, strerror(error));
+    }
+    walk_close(&walker);
+    return 2;
+  }
+  size_t count = 0;
+  build_file_t *files = collect_files(&walker, &count);
+  int failed = walker.error_occurred;
+  walk_close(&walker);
+
+  trigram_set_t set = {0};
+  set.seen = calloc(TRIGRAM_SPACE / 64, sizeof(uint64_t));
+  unsigned char *buffer = malloc(INDEX_READ_SIZE);
+  char *path = index_path(dir, "");
+  char *temporary = index_path(dir, ".tmp");
+  int out_of_memory = !set.seen || !buffer || !path || !temporary;
+
+  // Файлы, которые не удалось прочитать, в индекс не попадают: при поиске
+  // они ищутся целиком. Остальные сдвигаются к началу, их номер - позиция.
+  uint32_t indexed = 0;
+  size_t next = 0;
+  while (next < count && !out_of_memory) {
+    build_file_t *file = &files[next++];
+    error = index_one_file(file, &set, buffer);
+    if (!error && flush_trigrams(&set, indexed) != 0) error = ENOMEM;
+    if (!error) {
+      files[indexed++] = *file;
+      continue;
+    }
+    set.list_count = 0;
+    memset(set.seen, 0, TRIGRAM_SPACE / 8);
+    if (!suppress_errors) {
+      fprintf(stderr, "grep: %s: %s\n", file->path, strerror(error));
+    }
+    free(file->path);
+    failed = 1;
+    out_of_memory = error == ENOMEM;
+  }
+  if (out_of_memory) {
+    fprintf(stderr, "grep: memory allocation failed\n");
+  } else {
+    qsort(set.pairs, set.pair_count, sizeof(uint64_t), compare_pairs);
+    // Индекс заменяется атомарно: поиск видит либо старый, либо новый
+    FILE *stream = fopen(temporary, "wb");
+    int write_failed = !stream || write_index(stream, files, indexed,
+                                              set.pairs, set.pair_count);
+    if (stream && fclose(stream) != 0) write_failed = 1;
+    if (!write_failed && rename(temporary, path) != 0) write_failed = 1;
+    if (write_failed) {
+      if (!suppress_errors) {
+        fprintf(stderr, "grep: %s: %s\n", path, strerror(errno));
+      }
+      if (stream) unlink(temporary);
+      failed = 1;
+    }
+  }
+
+  for (size_t i = 0; i < indexed; i++) free(files[i].path);
+  for (size_t i = next; i < count; i++) free(files[i].path);
+  free(files);
+  free(set.seen);
+  free(set.list);
+  free(set.pairs);
+  free(buffer);
+  free(path);
+  free(temporary);
+  return failed || out_of_memory ? 2 : 0;
+}
+
+// Поиск по индексу
+
+static int range_valid(uint64_t offset, uint64_t count, uint64_t item_size,
+                       size_t size) {
+  return offset <= size && count <= (size - offset) / item_size;
+}
+
+int index_open(grep_index_t *index, const char *dir) {
+  memset(index, 0, sizeof(*index));
+  char *path = index_path(dir, "");
+  int fd = path ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+  free(path);
+  if (fd < 0) return 1;
+  struct stat st;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(index_header_t)) {
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) return 1;
+  index->data = data;
+  index->size = (size_t)st.st_size;
+
+  const index_header_t *header = data;
+  size_t size = index->size;
+  if (memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+      header->total_size != size ||
+      header->files_offset % 8 || header->trigrams_offset % 8 ||
+      !range_valid(header->files_offset, header->file_count,
+                   sizeof(index_file_t), size) ||
+      !range_valid(header->trigrams_offset, header->trigram_count,
+                   sizeof(index_trigram_t), size) ||
+      header->names_offset > size || header->postings_offset > size) {
+    index_close(index);
+    return 1;
+  }
+  index->header = header;
+  index->files = (const index_file_t *)(index->data + header->files_offset);
+  index->trigrams =
+      (const index_trigram_t *)(index->data + header->trigrams_offset);
+  for (uint32_t i = 0; i < header->file_count; i++) {
+    const index_file_t *file = &index->files[i];
+    if (!range_valid(header->names_offset + file->name_offset,
+                     file->name_length, 1, size)) {
+      index_close(index);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int compare_trigram(const void *key, const void *item) {
+  uint32_t a = *(const uint32_t *)key;
+  uint32_t b = ((const index_trigram_t *)item)->trigram;
+  return (a > b) - (a < b);
+}
+
+// Отмечает в marks файлы из списка триграммы. Возвращает 1, если список
+// повреждён.
+static int mark_postings(const grep_index_t *index,
+                         const index_trigram_t *trigram,
+                         unsigned char *marks) {
+  const unsigned char *p = (const unsigned char *)index->data +
+                           index->header->postings_offset;
+  const unsigned char *end = (const unsigned char *)index->data + index->size;
+  if (trigram->postings > (uint64_t)(end - p)) return 1;
+  p += trigram->postings;
+  uint32_t id = 0;
+  for (uint32_t i = 0; i < trigram->file_count; i++) {
+    uint32_t delta = 0;
+    int shift = 0;
+    do {
+      if (p == end || shift > 28) return 1;
+      delta |= (uint32_t)(*p & 0x7f) << shift;
+      shift += 7;
+    } while (*p++ & 0x80);
+    id += delta;
+    if (id >= index->header->file_count) return 1;
+    marks[id] = 1;
+  }
+  return 0;
+}
+
+// Файлы, где есть все триграммы литерала, отмечаются в selected
+static int select_literal(const grep_index_t *index, const char *literal,
+                          size_t length, unsigned char *selected,
+                          unsigned char *matches, unsigned char *marks) {
+  size_t file_count = index->header->file_count;
+  memset(matches, 1, file_count);
+  for (size_t i = 0; i + 3 <= length; i++) {
+    uint32_t trigram = (uint32_t)lower_ascii((unsigned char)literal[i]) << 16 |
+                       (uint32_t)lower_ascii((unsigned char)literal[i + 1])
+                           << 8 |
+                       lower_ascii((unsigned char)literal[i + 2]);
+    const index_trigram_t *found =
+        bsearch(&trigram, index->trigrams, index->header->trigram_count,
+                sizeof(index_trigram_t), compare_trigram);
+    if (!found) return 0;
+    memset(marks, 0, file_count);
+    if (mark_postings(index, found, marks) != 0) return 1;
+    for (size_t j = 0; j < file_count; j++) matches[j] &= marks[j];
+  }
+  for (size_t j = 0; j < file_count; j++) selected[j] |= matches[j];
+  return 0;
+}
+
+// Литерал, который обязан входить в совпадение шаблона i, или NULL
+static const char *pattern_literal(const compiled_patterns_t *compiled, int i,
+                                   size_t *length) {
+  if (compiled->empty_patterns[i]) return NULL;
+  if (compiled->literals[i]) {
+    *length = compiled->literal_lengths[i];
+    return compiled->literals[i];
+  }
+  *length = compiled->required_lengths[i];
+  return compiled->required[i];
+}
+
+int index_select(grep_index_t *index, const compiled_patterns_t *compiled) {
+  size_t length = 0;
+  for (int i = 0; i < compiled->pattern_count; i++) {
+    if (!pattern_literal(compiled, i, &length) || length < 3) return 0;
+  }
+  size_t file_count = index->header->file_count;
+  unsigned char *selected = calloc(file_count + 1, 3);
+  if (!selected) return 1;
+  unsigned char *matches = selected + file_count + 1;
+  unsigned char *marks = matches + file_count + 1;
+  for (int i = 0; i < compiled->pattern_count; i++) {
+    const char *literal = pattern_literal(compiled, i, &length);
+    if (select_literal(index, literal, length, selected, matches, marks)) {
+      // Повреждённый индекс: ищутся все файлы
+      free(selected);
+      return 0;
+    }
+  }
+  index->candidates = selected;
+  return 0;
+}
+
+// Номер файла в таблице индекса или -1
+static long find_file(const grep_index_t *index, const char *relative_path) {
+  size_t length = strlen(relative_path);
+  const char *names = index->data + index->header->names_offset;
+  size_t low = 0;
+  size_t high = index->header->file_count;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    const index_file_t *file = &index->files[middle];
+    size_t common = length < file->name_length ? length : file->name_length;
+    int order = memcmp(relative_path, names + file->name_offset, common);
+    if (order == 0) {
+      order = (length > file->name_length) - (length < file->name_length);
+    }
+    if (order == 0) return (long)middle;
+    if (order < 0) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  return -1;
+}
+
+int index_may_match(grep_index_t *index, const char *relative_path,
+                    const struct stat *st) {
+  int may_match = 1;
+  long id = index->candidates ? find_file(index, relative_path) : -1;
+  if (id >= 0) {
+    const index_file_t *file = &index->files[id];
+    may_match = file->size != (uint64_t)st->st_size ||
+                file->mtime_sec != st->st_mtim.tv_sec ||
+                file->mtime_nsec != st->st_mtim.tv_nsec ||
+                index->candidates[id];
+  }
+  if (may_match) {
+    index->searched++;
+  } else {
+    index->skipped++;
+  }
+  return may_match;
+}
+
+int index_accept(void *context, const walker_t *walker) {
+  const char *relative = walk_relative_path(walker);
+  if (is_index_file(relative)) return 0;
+  if (!context) return 1;
+  struct stat st;
+  // Файл, который не удалось stat(), ищется: ошибку выведет process_file()
+  if (stat(walker->path, &st) != 0) return 1;
+  return index_may_match(context, relative, &st);
+}
+
+void index_close(grep_index_t *index) {
+  if (index->data) munmap((void *)index->data, index->size);
+  free(index->candidates);
+  memset(index, 0, sizeof(*index));
+}
@@ -0,0 +1,82 @@
+#ifndef S21_GREP_INDEX_H
+#define S21_GREP_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "s21_grep_match.h"
+#include "s21_grep_walk.h"
+
+// Файл индекса в корне проиндексированного каталога
+#define INDEX_FILE_NAME ".s21_grep_index"
+#define INDEX_MAGIC "S21GIDX1"
+// Блок чтения файла при построении индекса
+#define INDEX_READ_SIZE (256 * 1024)
+
+// Формат файла индекса (порядок байт машины, все смещения от начала
+// файла): заголовок, таблица файлов по возрастанию пути, пути, таблица
+// триграмм по возрастанию и списки файлов для каждой триграммы -
+// возрастающие номера файлов, записанные разностями в varint.
+typedef struct {
+  char magic[8];
+  uint32_t file_count;
+  uint32_t trigram_count;
+  uint64_t files_offset;     // index_file_t[file_count]
+  uint64_t names_offset;     // Пути относительно каталога, без '\0'
+  uint64_t trigrams_offset;  // index_trigram_t[trigram_count]
+  uint64_t postings_offset;
+  uint64_t total_size;
+} index_header_t;
+
+// Файл на момент построения: если размер или mtime изменились, индекс для
+// него недействителен и файл ищется целиком
+typedef struct {
+  uint64_t size;
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+  uint64_t name_offset;  // От names_offset
+  uint32_t name_length;
+  uint32_t reserved;
+} index_file_t;
+
+typedef struct {
+  uint32_t trigram;     // Три байта в нижнем регистре ASCII
+  uint32_t file_count;  // Файлов с этой триграммой
+  uint64_t postings;    // Начало списка файлов от postings_offset
+} index_trigram_t;
+
+// Отображённый индекс каталога и отобранные по нему файлы
+typedef struct {
+  const char *data;
+  size_t size;
+  const index_header_t *header;
+  const index_file_t *files;
+  const index_trigram_t *trigrams;
+  unsigned char *candidates;  // Файл может совпасть; NULL - все файлы
+  size_t searched;            // Файлов пропущено через фильтр
+  size_t skipped;             // Файлов отброшено по индексу
+} grep_index_t;
+
+// --build-index DIR: индексирует все обычные файлы под dir и атомарно
+// заменяет dir/INDEX_FILE_NAME. Возвращает код завершения grep (0 или 2).
+int index_build(const char *dir, int follow_links, int suppress_errors);
+
+// Отображает индекс каталога dir. Возвращает 0 или 1, если индекса нет
+// или он повреждён (тогда ищутся все файлы).
+int index_open(grep_index_t *index, const char *dir);
+// Отбирает файлы, в которых есть все триграммы обязательного литерала
+// хотя бы одного шаблона. Если у какого-то шаблона литерала из трёх и
+// более байт нет, отбора нет. Возвращает 0 или 1 при нехватке памяти.
+int index_select(grep_index_t *index, const compiled_patterns_t *compiled);
+// Нужно ли искать в файле: он не проиндексирован, изменился после
+// построения индекса или отобран index_select()
+int index_may_match(grep_index_t *index, const char *relative_path,
+                    const struct stat *st);
+// Фильтр для walker_t.accept: файл индекса в корне обхода не ищется
+// никогда, остальные файлы отбираются по индексу context (grep_index_t)
+// или, если context NULL, не отбираются
+int index_accept(void *context, const walker_t *walker);
+void index_close(grep_index_t *index);
+
+#endif
@@ -0,0 +1,292 @@
+#include "s21_grep_lib.h"
+
+#include <pthread.h>
+
+#include "s21_grep.h"
+#include "s21_grep_follow.h"
+#include "s21_grep_index.h"
+#include "s21_grep_pool.h"
+
+struct s21grep {
+  compiled_patterns_t compiled;
+  // Состояние шаблонов handle: его берёт поиск, который занял lock
+  match_thread_t thread;
+  pthread_mutex_t lock;
+  char **sources;  // Копии шаблонов: compiled ссылается на них
+  int pattern_count;
+  int invert;
+  double compile_ms;  // Для S21_GREP_STATS
+};
+
+static void free_sources(char **sources, int count) {
+  for (int i = 0; sources && i < count; i++) free(sources[i]);
+  free(sources);
+}
+
+static void set_error(char *error, size_t error_size, const char *text) {
+  if (error && error_size > 0) snprintf(error, error_size, "%s", text);
+}
+
+s21grep_t *s21grep_compile(const char *const *patterns, int pattern_count,
+                           int flags, char *error, size_t error_size) {
+  if (pattern_count < 1) {
+    set_error(error, error_size, "no pattern");
+    errno = EINVAL;
+    return NULL;
+  }
+  double compile_start = monotonic_ms();
+  s21grep_t *grep = calloc(1, sizeof(*grep));
+  char **sources = calloc((size_t)pattern_count, sizeof(char *));
+  int copied = 0;
+  while (sources && copied < pattern_count &&
+         (sources[copied] = strdup(patterns[copied]))) {
+    copied++;
+  }
+  if (!grep || copied < pattern_count) {
+    free_sources(sources, copied);
+    free(grep);
+    set_error(error, error_size, "memory allocation failed");
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  int match_flags = (flags & S21GREP_IGNORE_CASE ? MATCH_IGNORE_CASE : 0) |
+                    (flags & S21GREP_FIXED_STRINGS ? MATCH_FIXED_STRINGS : 0) |
+                    (flags & S21GREP_REGEX_ONLY ? MATCH_REGEX_ONLY : 0);
+  int status = compile_patterns(sources, pattern_count, match_flags,
+                                &grep->compiled, error, error_size);
+  if (status != 0) {
+    free_sources(sources, pattern_count);
+    free(grep);
+    errno = status == 2 ? EINVAL : ENOMEM;
+    return NULL;
+  }
+  if (match_thread_init(&grep->thread, &grep->compiled, 0) != 0) {
+    free_compiled_patterns(&grep->compiled);
+    free_sources(sources, pattern_count);
+    free(grep);
+    set_error(error, error_size, "memory allocation failed");
+    errno = ENOMEM;
+    return NULL;
+  }
+  pthread_mutex_init(&grep->lock, NULL);
+  grep->sources = sources;
+  grep->pattern_count = pattern_count;
+  grep->invert = (flags & S21GREP_INVERT) != 0;
+  grep->compile_ms = monotonic_ms() - compile_start;
+  return grep;
+}
+
+// Поиск берёт состояние шаблонов handle, а если его уже занял поиск в
+// другом потоке (или в callback), строит в own своё, с копиями regex
+static match_thread_t *thread_acquire(s21grep_t *grep, match_thread_t *own) {
+  if (pthread_mutex_trylock(&grep->lock) == 0) return &grep->thread;
+  return match_thread_init(own, &grep->compiled, 1) == 0 ? own : NULL;
+}
+
+static void thread_release(s21grep_t *grep, match_thread_t *thread) {
+  if (thread == &grep->thread) {
+    pthread_mutex_unlock(&grep->lock);
+  } else {
+    match_thread_free(thread);
+  }
+}
+
+// Поиск как у s21_grep -n -a без вывода: строки отдаются в callback
+static int scan_init(s21grep_t *grep, grep_scan_t *scan,
+                     s21grep_callback_t callback, void *context,
+                     match_thread_t *own) {
+  memset(scan, 0, sizeof(*scan));
+  scan->opts.invert_match = grep->invert;
+  scan->opts.line_number = 1;
+  scan->opts.max_count = -1;
+  scan->opts.binary_files = BINARY_TEXT;
+  scan->compiled = &grep->compiled;
+  scan->on_match = callback;
+  scan->on_match_context = context;
+  scan->opts.thread = thread_acquire(grep, own);
+  if (!scan->opts.thread) {
+    errno = ENOMEM;
+    return 1;
+  }
+  if (match_cache_init(&scan->cache, &grep->compiled, scan->opts.thread) !=
+      0) {
+    thread_release(grep, scan->opts.thread);
+    errno = ENOMEM;
+    return 1;
+  }
+  return 0;
+}
+
+static void scan_finish(s21grep_t *grep, grep_scan_t *scan) {
+  match_cache_free(&scan->cache);
+  thread_release(grep, scan->opts.thread);
+}
+
+int s21grep_scan_buffer(s21grep_t *grep, const char *data, size_t length,
+                        s21grep_callback_t callback, void *context) {
+  grep_scan_t scan;
+  match_thread_t own;
+  if (scan_init(grep, &scan, callback, context, &own) != 0) return -1;
+  if (length > 0) scan_buffer(&scan, data, length);
+  scan_finish(grep, &scan);
+  return scan.match_count;
+}
+
+int s21grep_scan_fd(s21grep_t *grep, int fd, s21grep_callback_t callback,
+                    void *context) {
+  grep_scan_t scan;
+  match_thread_t own;
+  if (scan_init(grep, &scan, callback, context, &own) != 0) return -1;
+  int error = scan_fd(&scan, fd);
+  scan_finish(grep, &scan);
+  if (error) {
+    errno = error;
+    return -1;
+  }
+  return scan.match_count;
+}
+
+static grep_options_t run_options(const s21grep_options_t *options) {
+  grep_options_t opts = {0};
+  opts.invert_match = options->invert_match;
+  opts.count_matches = options->count_matches;
+  opts.list_files = options->list_files;
+  opts.line_number = options->line_number;
+  opts.suppress_errors = options->suppress_errors;
+  opts.no_filename = options->no_filename;
+  opts.only_matching = options->only_matching;
+  opts.quiet = options->quiet;
+  opts.max_count = options->max_count;
+  opts.jobs = options->jobs;
+  opts.recursive = options->recursive;
+  opts.binary_files = options->binary_files;
+  opts.use_index = options->use_index;
+  opts.state_file = options->state_file;
+  opts.follow = options->follow;
+  opts.filter.include = options->include;
+  opts.filter.include_count = options->include_count;
+  opts.filter.exclude = options->exclude;
+  opts.filter.exclude_count = options->exclude_count;
+  opts.filter.exclude_dir = options->exclude_dir;
+  opts.filter.exclude_dir_count = options->exclude_dir_count;
+  // Состояние читает дописанное через mmap и при S21_MMAP=0
+  opts.input_mode = input_mode_from_env();
+  return opts;
+}
+
+// Ищет по файлам командной строки; возвращает число совпадений
+static int run_files(char **files, int file_count, const grep_options_t *opts,
+                     const compiled_patterns_t *compiled,
+                     int *error_occurred) {
+  // Отсутствующие файлы называются до начала вывода
+  for (int i = 0; i < file_count; i++) {
+    if (strcmp(files[i], "-") == 0) continue;
+    FILE *fp = fopen(files[i], "r");
+    if (fp) {
+      fclose(fp);
+    } else {
+      // Если -s установлен, просто помечаем ошибку без вывода
+      if (!opts->suppress_errors) {
+        fprintf(stderr, "grep: %s: No such file or directory\n", files[i]);
+      }
+      *error_occurred = 1;
+    }
+  }
+  int multiple_files = file_count > 1;
+  // -r: у файлов из обхода каталога всегда выводится имя
+  if (opts->recursive && (file_count == 0 || is_directory(files[0]))) {
+    multiple_files = 1;
+  }
+
+  int total_matches = 0;
+  output_t out, err;
+  output_init_fd(&out, STDOUT_FILENO);
+  output_init_stream(&err, stderr);
+  if (opts->follow) {
+    total_matches = grep_follow(files, file_count, *opts, compiled, &out,
+                                &err, error_occurred);
+  } else if (opts->recursive) {
+    total_matches = grep_recursive(files, file_count, multiple_files, *opts,
+                                   compiled, &out, &err, error_occurred);
+  } else if (file_count == 0) {
+    total_matches = process_file("-", *opts, compiled, multiple_files, &out,
+                                 &err, error_occurred);
+  } else if (opts->jobs > 1 && file_count > 1) {
+    total_matches =
+        grep_files_parallel(files, file_count, multiple_files, *opts,
+                            compiled, &out, &err, error_occurred);
+  } else {
+    // -q: после первого совпадения остальные файлы не читаются
+    for (int i = 0; i < file_count && !(opts->quiet && total_matches); i++) {
+      total_matches += process_file(files[i], *opts, compiled, multiple_files,
+                                    &out, &err, error_occurred);
+    }
+  }
+  if (output_flush(&out)) *error_occurred = 1;
+  output_free(&out);
+  return total_matches;
+}
+
+int s21grep_run(s21grep_t *grep, const s21grep_options_t *options,
+                char **files, int file_count) {
+  grep_options_t opts = run_options(options);
+  // Этот поток ищет общими regex; потоки -j строят себе свои копии
+  match_thread_t own;
+  opts.thread = thread_acquire(grep, &own);
+  if (!opts.thread) {
+    fprintf(stderr, "grep: memory allocation failed\n");
+    return 2;
+  }
+
+  state_table_t state;
+  if (opts.state_file) {
+    int error = state_load(&state, opts.state_file);
+    if (error) {
+      fprintf(stderr, "grep: %s: %s\n", opts.state_file, strerror(error));
+      state_free(&state);
+      thread_release(grep, opts.thread);
+      return 2;
+    }
+    opts.state = &state;
+  } else if (opts.follow) {
+    state_init(&state);
+    opts.state = &state;
+  }
+  if (opts.input_mode != INPUT_STREAM || opts.state) {
+    input_install_fault_handler();
+  }
+
+  int error_occurred = 0;
+  int total_matches =
+      run_files(files, file_count, &opts, &grep->compiled, &error_occurred);
+  if (opts.state_file) {
+    int error = state_save(opts.state);
+    if (error) {
+      fprintf(stderr, "grep: %s: %s\n", opts.state_file, strerror(error));
+      error_occurred = 1;
+    }
+  }
+  if (opts.state) state_free(opts.state);
+  print_compile_stats(grep->compiled.pattern_count, grep->compile_ms);
+  thread_release(grep, opts.thread);
+
+  // -q: найденное совпадение важнее ошибок в других файлах
+  if (opts.quiet && total_matches > 0) return 0;
+  if (error_occurred) return 2;
+  return total_matches == 0 ? 1 : 0;
+}
+
+int s21grep_build_index(const char *dir, int follow_links,
+                        int suppress_errors) {
+  return index_build(dir, follow_links, suppress_errors);
+}
+
+void s21grep_free(s21grep_t *grep) {
+  if (!grep) return;
+  pthread_mutex_destroy(&grep->lock);
+  match_thread_free(&grep->thread);
+  free_compiled_patterns(&grep->compiled);
+  free_sources(grep->sources, grep->pattern_count);
+  free(grep);
+}
@@ -0,0 +1,102 @@
+#ifndef S21_GREP_LIB_H
+#define S21_GREP_LIB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// libs21grep: поиск s21_grep без запуска процесса. Шаблоны компилируются
+// один раз, а дальше ищутся в буферах и файлах вызывающего; каждое
+// совпадение отдаётся в функцию обратного вызова. s21grep_run() ищет по
+// файлам с выводом, как командная строка s21_grep (она сама - обёртка над
+// ним). Из архива видны только функции s21grep_*.
+
+#define S21GREP_API __attribute__((visibility("default")))
+
+// Флаги s21grep_compile()
+#define S21GREP_IGNORE_CASE 1    // -i
+#define S21GREP_FIXED_STRINGS 2  // -F
+#define S21GREP_INVERT 4         // -v: отдаются несовпавшие строки
+#define S21GREP_REGEX_ONLY 8     // Только regexec(), без ДКА
+
+// --binary-files: что делать с файлом, в первом блоке которого есть NUL
+#define S21GREP_BINARY_MATCHES 0  // binary: "Binary file X matches"
+#define S21GREP_BINARY_SKIP 1     // without-match (-I): файл не совпадает
+#define S21GREP_BINARY_TEXT 2     // text (-a): искать как в тексте
+
+// Скомпилированный набор шаблонов. Один s21grep_t можно использовать из
+// нескольких потоков одновременно: поиск, которому не досталось состояние
+// шаблонов handle, строит себе своё на время вызова.
+typedef struct s21grep s21grep_t;
+
+// Одно совпадение. Строка указывает в данные поиска и действительна только
+// до возврата из обратного вызова.
+typedef struct {
+  const char *line;    // Строка без '\n'
+  size_t line_length;
+  size_t line_number;  // С 1
+  uint64_t offset;     // Начало строки от начала буфера или файла
+  size_t match_start;  // Совпадение внутри строки: [match_start,
+  size_t match_end;    // match_end); с S21GREP_INVERT - вся строка
+} s21grep_match_t;
+
+// Вызывается для каждого непересекающегося совпадения по порядку; строка,
+// которая совпала только пустыми совпадениями, отдаётся один раз с пустым
+// совпадением в её начале. Ненулевой ответ прекращает поиск.
+typedef int (*s21grep_callback_t)(void *context,
+                                  const s21grep_match_t *match);
+
+// Параметры s21grep_run(): флаги командной строки s21_grep. -i и -F
+// задаются при компиляции шаблонов.
+typedef struct {
+  int invert_match;         // -v
+  int count_matches;        // -c
+  int list_files;           // -l
+  int line_number;          // -n
+  int suppress_errors;      // -s
+  int no_filename;          // -h
+  int only_matching;        // -o
+  int quiet;                // -q
+  long max_count;           // -m: предел выбранных строк (-1 - без него)
+  int jobs;                 // -j: число потоков поиска
+  int recursive;            // -r: 1, -R: 2 (по символическим ссылкам)
+  int binary_files;         // --binary-files: S21GREP_BINARY_*
+  int use_index;            // --index: отбор файлов каталога по индексу
+  const char *state_file;   // --state-file FILE или NULL
+  int follow;               // --follow: искать в дописываемых строках
+  // --include, --exclude, --exclude-dir: шаблоны fnmatch() для -r
+  char **include;
+  int include_count;
+  char **exclude;
+  int exclude_count;
+  char **exclude_dir;
+  int exclude_dir_count;
+} s21grep_options_t;
+
+// Компилирует pattern_count (хотя бы один) шаблонов; строки копируются.
+// Возвращает NULL с errno EINVAL (ошибочный шаблон) или ENOMEM; текст
+// ошибки записывается в error[0..error_size), если error не NULL.
+S21GREP_API s21grep_t *s21grep_compile(const char *const *patterns,
+                                       int pattern_count, int flags,
+                                       char *error, size_t error_size);
+// Ищет в data[0..length). Последняя строка может быть без '\n'. Возвращает
+// число совпавших строк (найденных до остановки).
+S21GREP_API int s21grep_scan_buffer(s21grep_t *grep, const char *data,
+                                    size_t length, s21grep_callback_t callback,
+                                    void *context);
+// Ищет в fd с текущей позиции до конца: файл, канал или сокет. Смещения
+// считаются от этой позиции. Возвращает число совпавших строк или -1 с
+// errno ошибки чтения.
+S21GREP_API int s21grep_scan_fd(s21grep_t *grep, int fd,
+                                s21grep_callback_t callback, void *context);
+// Ищет в files[0..file_count) (без файлов - в stdin) и выводит строки в
+// stdout, ошибки - в stderr, как s21_grep с флагами options. Возвращает код
+// завершения grep: 0 - есть совпадения, 1 - нет, 2 - была ошибка.
+S21GREP_API int s21grep_run(s21grep_t *grep, const s21grep_options_t *options,
+                            char **files, int file_count);
+// --build-index DIR: строит индекс триграмм для --index. Возвращает код
+// завершения (0 или 2).
+S21GREP_API int s21grep_build_index(const char *dir, int follow_links,
+                                    int suppress_errors);
+S21GREP_API void s21grep_free(s21grep_t *grep);
+
+#endif
@@ -0,0 +1,388 @@
+#include "s21_grep_literal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define ERE_METACHARS ".[]()*+?{}|^$\\"
+
+char *extract_literal(const char *pattern, size_t *literal_len) {
+  size_t len = strlen(pattern);
+  char *literal = malloc(len + 1);
+  if (!literal) return NULL;
+
+  size_t out = 0;
+  int is_literal = 1;
+  for (size_t i = 0; i < len && is_literal; i++) {
+    char c = pattern[i];
+    if (c == '\\') {
+      // \. \* и т.п. - обычные символы; \w, \b, \1 и прочие GNU-расширения
+      // остаются за regex
+      if (i + 1 < len && strchr(ERE_METACHARS, pattern[i + 1])) {
+        literal[out++] = pattern[++i];
+      } else {
+        is_literal = 0;
+      }
+    } else if (strchr(ERE_METACHARS, c)) {
+      is_literal = 0;
+    } else {
+      literal[out++] = c;
+    }
+  }
+
+  if (!is_literal) {
+    free(literal);
+    return NULL;
+  }
+  literal[out] = '\0';
+  *literal_len = out;
+  return literal;
+}
+
+// Пропускает скобочное выражение, начинающееся в pattern[i] == '['.
+// Возвращает позицию после ']' или 0, если скобка не закрыта.
+static size_t skip_bracket(const char *pattern, size_t i) {
+  i++;
+  if (pattern[i] == '^') i++;
+  if (pattern[i] == ']') i++;
+  while (pattern[i] != '\0' && pattern[i] != ']') {
+    if (pattern[i] == '[' && pattern[i + 1] != '\0' &&
+        strchr(":.=", pattern[i + 1])) {
+      char close[3] = {pattern[i + 1], ']', '\0'};
+      const char *end = strstr(pattern + i + 2, close);
+      if (!end) return 0;
+      i = (size_t)(end - pattern) + 2;
+    } else {
+      i++;
+    }
+  }
+  return pattern[i] == ']' ? i + 1 : 0;
+}
+
+// Пропускает группу, начинающуюся в pattern[i] == '('. Возвращает позицию
+// после парной ')' или 0.
+static size_t skip_group(const char *pattern, size_t i) {
+  int depth = 0;
+  while (pattern[i] != '\0') {
+    if (pattern[i] == '\\') {
+      if (pattern[i + 1] == '\0') return 0;
+      i += 2;
+    } else if (pattern[i] == '[') {
+      i = skip_bracket(pattern, i);
+      if (i == 0) return 0;
+    } else {
+      if (pattern[i] == '(') depth++;
+      if (pattern[i] == ')' && --depth == 0) return i + 1;
+      i++;
+    }
+  }
+  return 0;
+}
+
+// Разбирает повторители после атома. Обнуляет *required, если атом может
+// не встретиться, и *single, если он может повториться. Возвращает позицию
+// после повторителей или 0 при ошибке.
+static size_t skip_quantifiers(const char *pattern, size_t i, int *required,
+                               int *single) {
+  for (;;) {
+    char c = pattern[i];
+    if (c == '*' || c == '?') {
+      *required = 0;
+      *single = 0;
+      i++;
+    } else if (c == '+') {
+      *single = 0;
+      i++;
+    } else if (c == '{') {
+      char *end = NULL;
+      long min = strtol(pattern + i + 1, &end, 10);
+      if (end == pattern + i + 1) return 0;
+      long max = min;
+      if (*end == ',') {
+        max = -1;
+        if (end[1] >= '0' && end[1] <= '9') max = strtol(end + 1, &end, 10);
+        else end++;
+      }
+      if (*end != '}') return 0;
+      if (min == 0) *required = 0;
+      if (min != 1 || max != 1) *single = 0;
+      i = (size_t)(end - pattern) + 1;
+    } else {
+      return i;
+    }
+  }
+}
+
+char *extract_required_literal(const char *pattern, size_t *literal_len) {
+  size_t len = strlen(pattern);
+  char *run = malloc(len + 1);
+  char *best = malloc(len + 1);
+  if (!run || !best) {
+    free(run);
+    free(best);
+    return NULL;
+  }
+
+  size_t run_len = 0, best_len = 0;
+  size_t i = 0;
+  int ok = 1;
+  while (ok && i < len) {
+    char c = pattern[i];
+    int is_char = 0;
+    if (c == '\\') {
+      // \w, \b, \1 и т.п. - не литералы
+      is_char = i + 1 < len && strchr(ERE_METACHARS, pattern[i + 1]);
+      if (is_char) c = pattern[i + 1];
+      i = i + 1 < len ? i + 2 : 0;
+    } else if (c == '[') {
+      i = skip_bracket(pattern, i);
+    } else if (c == '(') {
+      i = skip_group(pattern, i);
+    } else if (c == '|' || c == ')' || strchr("*+?{", c)) {
+      // Альтернатива верхнего уровня: общего литерала может не быть
+      i = 0;
+    } else {
+      is_char = c != '.' && c != '^' && c != '$' && c != '\n';
+      i++;
+    }
+    int required = 1, single = 1;
+    if (i != 0) i = skip_quantifiers(pattern, i, &required, &single);
+    if (i == 0) {
+      ok = 0;
+      break;
+    }
+
+    if (is_char && required) run[run_len++] = c;
+    // Повтор или пропуск атома обрывает последовательность; после x+
+    // последний x стоит вплотную к следующему атому
+    if (!is_char || !required || !single) {
+      if (run_len > best_len) {
+        memcpy(best, run, run_len);
+        best_len = run_len;
+      }
+      run_len = 0;
+      if (is_char && required) run[run_len++] = c;
+    }
+  }
+  if (ok && run_len > best_len) {
+    memcpy(best, run, run_len);
+    best_len = run_len;
+  }
+  free(run);
+
+  if (!ok || best_len == 0) {
+    free(best);
+    return NULL;
+  }
+  best[best_len] = '\0';
+  *literal_len = best_len;
+  return best;
+}
+
+char *escape_literal(const char *literal) {
+  size_t len = strlen(literal);
+  char *escaped = malloc(len * 2 + 1);
+  if (!escaped) return NULL;
+
+  size_t out = 0;
+  for (size_t i = 0; i < len; i++) {
+    if (strchr(ERE_METACHARS, literal[i])) escaped[out++] = '\\';
+    escaped[out++] = literal[i];
+  }
+  escaped[out] = '\0';
+  return escaped;
+}
+
+// Простой поиск: memchr по первому байту и memcmp остатка
+static const char *memmem_scalar(const char *haystack, size_t haystack_len,
+                                 const char *needle, size_t needle_len) {
+  if (haystack_len < needle_len) return NULL;
+  const char *end = haystack + (haystack_len - needle_len) + 1;
+  const char *p = haystack;
+  while (p < end) {
+    p = memchr(p, needle[0], (size_t)(end - p));
+    if (!p) return NULL;
+    if (memcmp(p + 1, needle + 1, needle_len - 1) == 0) return p;
+    p++;
+  }
+  return NULL;
+}
+
+const char *s21_memmem(const char *haystack, size_t haystack_len,
+                       const char *needle, size_t needle_len) {
+  if (needle_len == 0) return haystack;
+  if (haystack_len < needle_len) return NULL;
+  if (needle_len == 1) return memchr(haystack, needle[0], haystack_len);
+
+  // Позиции-кандидаты: [0, positions)
+  size_t positions = haystack_len - needle_len + 1;
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256i first32 = _mm256_set1_epi8(needle[0]);
+  const __m256i last32 = _mm256_set1_epi8(needle[needle_len - 1]);
+  for (; i + 32 <= positions; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(haystack + i));
+    __m256i b = _mm256_loadu_si256(
+        (const __m256i *)(haystack + i + needle_len - 1));
+    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(
+        _mm256_cmpeq_epi8(a, first32), _mm256_cmpeq_epi8(b, last32)));
+    while (mask) {
+      int bit = __builtin_ctz(mask);
+      if (memcmp(haystack + i + bit + 1, needle + 1, needle_len - 2) == 0) {
+        return haystack + i + bit;
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i first16 = _mm_set1_epi8(needle[0]);
+  const __m128i last16 = _mm_set1_epi8(needle[needle_len - 1]);
+  for (; i + 16 <= positions; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(haystack + i));
+    __m128i b =
+        _mm_loadu_si128((const __m128i *)(haystack + i + needle_len - 1));
+    unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(a, first16), _mm_cmpeq_epi8(b, last16)));
+    while (mask) {
+      int bit = __builtin_ctz(mask);
+      if (memcmp(haystack + i + bit + 1, needle + 1, needle_len - 2) == 0) {
+        return haystack + i + bit;
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  return memmem_scalar(haystack + i, haystack_len - i, needle, needle_len);
+}
+
+static unsigned char ascii_lower(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+void ascii_fold(char *s, size_t n) {
+  for (size_t i = 0; i < n; i++) s[i] = (char)ascii_lower((unsigned char)s[i]);
+}
+
+#if defined(__SSE2__)
+// Приводит 16 байт к нижнему регистру ASCII: после сдвига на 128 - 'A'
+// буквы 'A'..'Z' и только они становятся знаковыми -128..-103
+static __m128i fold16(__m128i x) {
+  __m128i shifted = _mm_add_epi8(x, _mm_set1_epi8((char)(128 - 'A')));
+  __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 26)));
+  return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+int s21_memeq_icase(const char *a, const char *b, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = fold16(_mm_loadu_si128((const __m128i *)(a + i)));
+    __m128i y = fold16(_mm_loadu_si128((const __m128i *)(b + i)));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) return 0;
+  }
+#endif
+  for (; i < n; i++) {
+    if (ascii_lower((unsigned char)a[i]) != ascii_lower((unsigned char)b[i])) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Сравнивает text с образцом, уже приведённым к нижнему регистру
+static int memeq_folded(const char *text, const char *folded, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = fold16(_mm_loadu_si128((const __m128i *)(text + i)));
+    __m128i y = _mm_loadu_si128((const __m128i *)(folded + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) return 0;
+  }
+#endif
+  for (; i < n; i++) {
+    if (ascii_lower((unsigned char)text[i]) != (unsigned char)folded[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Для буквы в нижнем регистре (x | 0x20) == c ровно при x, равном ей в
+// любом регистре; остальные байты сравниваются как есть
+static char case_bit(unsigned char c) {
+  return (char)(c >= 'a' && c <= 'z' ? 0x20 : 0);
+}
+
+const char *s21_memmem_icase(const char *haystack, size_t haystack_len,
+                             const char *needle, size_t needle_len) {
+  if (needle_len == 0) return haystack;
+  if (haystack_len < needle_len) return NULL;
+
+  unsigned char first = (unsigned char)needle[0];
+  unsigned char last = (unsigned char)needle[needle_len - 1];
+  size_t positions = haystack_len - needle_len + 1;
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256i first32 = _mm256_set1_epi8((char)first);
+  const __m256i last32 = _mm256_set1_epi8((char)last);
+  const __m256i first_bit32 = _mm256_set1_epi8(case_bit(first));
+  const __m256i last_bit32 = _mm256_set1_epi8(case_bit(last));
+  for (; i + 32 <= positions; i += 32) {
+    __m256i a = _mm256_or_si256(
+        _mm256_loadu_si256((const __m256i *)(haystack + i)), first_bit32);
+    __m256i b = _mm256_or_si256(
+        _mm256_loadu_si256((const __m256i *)(haystack + i + needle_len - 1)),
+        last_bit32);
+    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(
+        _mm256_cmpeq_epi8(a, first32), _mm256_cmpeq_epi8(b, last32)));
+    while (mask) {
+      int bit = __builtin_ctz(mask);
+      if (memeq_folded(haystack + i + bit, needle, needle_len)) {
+        return haystack + i + bit;
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i first16 = _mm_set1_epi8((char)first);
+  const __m128i last16 = _mm_set1_epi8((char)last);
+  const __m128i first_bit16 = _mm_set1_epi8(case_bit(first));
+  const __m128i last_bit16 = _mm_set1_epi8(case_bit(last));
+  for (; i + 16 <= positions; i += 16) {
+    __m128i a = _mm_or_si128(_mm_loadu_si128((const __m128i *)(haystack + i)),
+                             first_bit16);
+    __m128i b = _mm_or_si128(
+        _mm_loadu_si128((const __m128i *)(haystack + i + needle_len - 1)),
+        last_bit16);
+    unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(a, first16), _mm_cmpeq_epi8(b, last16)));
+    while (mask) {
+      int bit = __builtin_ctz(mask);
+      if (memeq_folded(haystack + i + bit, needle, needle_len)) {
+        return haystack + i + bit;
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  for (; i < positions; i++) {
+    if (ascii_lower((unsigned char)haystack[i]) == first &&
+        memeq_folded(haystack + i, needle, needle_len)) {
+      return haystack + i;
+    }
+  }
+  return NULL;
+}
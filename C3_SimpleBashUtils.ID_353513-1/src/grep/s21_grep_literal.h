@@ -0,0 +1,39 @@
+#ifndef S21_GREP_LITERAL_H
+#define S21_GREP_LITERAL_H
+
+#include <stddef.h>
+
+// Разбирает шаблон ERE без метасимволов в строку-литерал. Экранированные
+// метасимволы (\. \* ...) превращаются в обычные символы. Возвращает
+// выделенную строку и её длину или NULL, если шаблону нужен regex.
+char *extract_literal(const char *pattern, size_t *literal_len);
+
+// Находит самую длинную последовательность символов, которая обязана
+// входить в любое совпадение ERE (например, "ERROR" в "ERROR.*id=[0-9]+").
+// Учитываются только атомы верхнего уровня; при '|' вне скобок литерала
+// нет. Возвращает выделенную строку и её длину или NULL.
+char *extract_required_literal(const char *pattern, size_t *literal_len);
+
+// Экранирует строку для -F, чтобы её можно было передать в regcomp()
+char *escape_literal(const char *literal);
+
+// Поиск подстроки needle в haystack. На x86-64 использует SSE2 (и AVX2,
+// если собрано с -mavx2): сравнивает первый и последний байт образца
+// сразу для 16/32 позиций и проверяет memcmp только кандидатов.
+const char *s21_memmem(const char *haystack, size_t haystack_len,
+                       const char *needle, size_t needle_len);
+
+// Приводит строку к нижнему регистру ASCII на месте
+void ascii_fold(char *s, size_t n);
+
+// Сравнение без учёта регистра ASCII (-i в локали C), по 16 байт за шаг
+int s21_memeq_icase(const char *a, const char *b, size_t n);
+
+// Поиск без учёта регистра ASCII. needle должен быть уже приведён к нижнему
+// регистру (ascii_fold() при компиляции шаблона), текст не копируется:
+// первый и последний байт образца сравниваются для 16/32 позиций сразу, а
+// кандидаты проверяются сравнением блоков по 16 байт.
+const char *s21_memmem_icase(const char *haystack, size_t haystack_len,
+                             const char *needle, size_t needle_len);
+
+#endif
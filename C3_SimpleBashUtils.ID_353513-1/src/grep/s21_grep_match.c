@@ -0,0 +1,676 @@
+#include "s21_grep_match.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "s21_grep_literal.h"
+
+// Фильтр по обязательному литералу отключается после стольких попаданий
+// подряд в первую же строку и включается снова через PREFILTER_PAUSE поисков
+#define PREFILTER_DENSE_HITS 16
+#define PREFILTER_PAUSE 256
+
+// Ближайшее совпадение шаблона для -o: его нет или ещё не искали
+#define ONLY_NONE ((size_t)-1)
+#define ONLY_UNKNOWN ((size_t)-2)
+
+static void set_error(char *error, size_t error_size, const char *text) {
+  if (error && error_size > 0) snprintf(error, error_size, "%s", text);
+}
+
+static int regex_cflags(int flags) {
+  return REG_EXTENDED | REG_NEWLINE |
+         ((flags & MATCH_IGNORE_CASE) ? REG_ICASE : 0);
+}
+
+// Компилирует один шаблон: строка-литерал ищется без regex (с -i - без
+// учёта регистра ASCII), остальное уходит в regcomp() и, если шаблон из
+// поддерживаемого подмножества ERE, ещё и в ДКА. REG_NEWLINE нужен
+// для поиска по блоку из многих строк: ^ и $ срабатывают на границах строк,
+// а '.' и [^...] не переходят через '\n'.
+int compile_single_pattern(const char *pattern, int flags,
+                           compiled_patterns_t *compiled, int i) {
+  compiled->literals[i] = NULL;
+  compiled->literal_lengths[i] = 0;
+  compiled->in_multi[i] = 0;
+  compiled->dfas[i] = NULL;
+  compiled->reverse_dfas[i] = NULL;
+  compiled->required[i] = NULL;
+  compiled->empty_patterns[i] = (strlen(pattern) == 0);
+  if (compiled->empty_patterns[i]) return 0;
+
+  if (flags & MATCH_FIXED_STRINGS) {
+    compiled->literals[i] = strdup(pattern);
+    if (!compiled->literals[i]) return 1;
+    compiled->literal_lengths[i] = strlen(pattern);
+  } else {
+    compiled->literals[i] =
+        extract_literal(pattern, &compiled->literal_lengths[i]);
+  }
+  // Перевод строки внутри литерала не может совпасть ни с одной строкой:
+  // такой шаблон остаётся за regex
+  if (compiled->literals[i] &&
+      !memchr(compiled->literals[i], '\n', compiled->literal_lengths[i])) {
+    // С -i литерал приводится к нижнему регистру один раз здесь, а не при
+    // каждом сравнении
+    if (flags & MATCH_IGNORE_CASE) {
+      ascii_fold(compiled->literals[i], compiled->literal_lengths[i]);
+    }
+    return 0;
+  }
+  free(compiled->literals[i]);
+  compiled->literals[i] = NULL;
+
+  char *regex_source = NULL;
+  if (flags & MATCH_FIXED_STRINGS) {
+    regex_source = escape_literal(pattern);
+    if (!regex_source) return 1;
+  }
+
+  const char *source = regex_source ? regex_source : pattern;
+  int status = regcomp(&compiled->regexes[i], source, regex_cflags(flags));
+  if (status != 0) {
+    free(regex_source);
+    return 2;
+  }
+  // regcomp() уже проверил синтаксис; если ДКА не построился (обратные
+  // ссылки, \w и т.п. или нет памяти), шаблон ищется через regexec()
+  if (!(flags & MATCH_REGEX_ONLY)) {
+    dfa_t *dfa = malloc(sizeof(dfa_t));
+    dfa_t *reverse = malloc(sizeof(dfa_t));
+    int ignore_case = (flags & MATCH_IGNORE_CASE) != 0;
+    if (dfa && reverse && dfa_compile(source, ignore_case, dfa) == 0) {
+      if (dfa_compile_reverse(source, ignore_case, reverse) == 0) {
+        compiled->dfas[i] = dfa;
+        compiled->reverse_dfas[i] = reverse;
+      } else {
+        dfa_free(dfa);
+      }
+    }
+    if (!compiled->dfas[i]) {
+      free(dfa);
+      free(reverse);
+    }
+  }
+  // Строки без обязательного литерала отбрасываются до запуска regex
+  compiled->required[i] =
+      extract_required_literal(source, &compiled->required_lengths[i]);
+  if (compiled->required[i] && (flags & MATCH_IGNORE_CASE)) {
+    ascii_fold(compiled->required[i], compiled->required_lengths[i]);
+  }
+  free(regex_source);
+  return 0;
+}
+
+int compile_patterns(char *const *patterns, int pattern_count, int flags,
+                     compiled_patterns_t *compiled, char *error,
+                     size_t error_size) {
+  int count = pattern_count;
+  compiled->sources = patterns;
+  compiled->flags = flags;
+  compiled->pattern_count = 0;
+  compiled->ignore_case = (flags & MATCH_IGNORE_CASE) != 0;
+  compiled->has_multi = 0;
+  compiled->regexes = malloc(sizeof(regex_t) * count);
+  compiled->dfas = malloc(sizeof(dfa_t *) * count);
+  compiled->reverse_dfas = malloc(sizeof(dfa_t *) * count);
+  compiled->required = malloc(sizeof(char *) * count);
+  compiled->required_lengths = malloc(sizeof(size_t) * count);
+  compiled->empty_patterns = malloc(sizeof(int) * count);
+  compiled->literals = malloc(sizeof(char *) * count);
+  compiled->literal_lengths = malloc(sizeof(size_t) * count);
+  compiled->in_multi = malloc(sizeof(int) * count);
+  compiled->separate = malloc(sizeof(int) * count);
+  if (!compiled->regexes || !compiled->dfas || !compiled->reverse_dfas ||
+      !compiled->required ||
+      !compiled->required_lengths || !compiled->empty_patterns ||
+      !compiled->literals || !compiled->literal_lengths ||
+      !compiled->in_multi || !compiled->separate) {
+    set_error(error, error_size, "memory allocation failed");
+    free_compiled_patterns(compiled);
+    return 1;
+  }
+
+  // ИСПРАВЛЕНИЕ: обработка пустых и непустых паттернов отдельно
+  for (int i = 0; i < count; i++) {
+    int status = compile_single_pattern(patterns[i], flags, compiled, i);
+    if (status != 0) {
+      set_error(error, error_size,
+                status == 1 ? "memory allocation failed" : "invalid pattern");
+      free_compiled_patterns(compiled);
+      return status;
+    }
+    compiled->pattern_count = i + 1;
+  }
+  build_multi_literal(compiled);
+
+  // Шаблоны, которые проверяются по одному, а не общим автоматом
+  compiled->has_empty = 0;
+  compiled->separate_count = 0;
+  for (int i = 0; i < count; i++) {
+    if (compiled->empty_patterns[i]) {
+      compiled->has_empty = 1;
+    } else if (!compiled->in_multi[i]) {
+      compiled->separate[compiled->separate_count++] = i;
+    }
+  }
+  return 0;
+}
+
+// Если литералов несколько, строит по ним общий автомат: строка проверяется
+// одним проходом вместо поиска каждого литерала по очереди. Без памяти под
+// автомат литералы просто ищутся по одному.
+void build_multi_literal(compiled_patterns_t *compiled) {
+  int count = 0;
+  for (int i = 0; i < compiled->pattern_count; i++) {
+    if (compiled->literals[i]) count++;
+  }
+  if (count < 2) return;
+
+  char **literals = malloc(sizeof(char *) * count);
+  size_t *lengths = malloc(sizeof(size_t) * count);
+  if (literals && lengths) {
+    int k = 0;
+    for (int i = 0; i < compiled->pattern_count; i++) {
+      if (compiled->literals[i]) {
+        literals[k] = compiled->literals[i];
+        lengths[k++] = compiled->literal_lengths[i];
+      }
+    }
+    if (multi_literal_build(&compiled->multi, literals, lengths, count,
+                            compiled->ignore_case) == 0) {
+      compiled->has_multi = 1;
+      for (int i = 0; i < compiled->pattern_count; i++) {
+        compiled->in_multi[i] = compiled->literals[i] != NULL;
+      }
+    }
+  }
+  free(literals);
+  free(lengths);
+}
+
+void free_compiled_patterns(compiled_patterns_t *compiled) {
+  if (compiled->has_multi) multi_literal_free(&compiled->multi);
+  compiled->has_multi = 0;
+  for (int i = 0; i < compiled->pattern_count; i++) {
+    if (compiled->literals[i]) {
+      free(compiled->literals[i]);
+    } else if (!compiled->empty_patterns[i]) {
+      regfree(&compiled->regexes[i]);
+    }
+    if (compiled->dfas[i]) {
+      dfa_free(compiled->dfas[i]);
+      free(compiled->dfas[i]);
+      dfa_free(compiled->reverse_dfas[i]);
+      free(compiled->reverse_dfas[i]);
+    }
+    free(compiled->required[i]);
+  }
+  free(compiled->regexes);
+  free(compiled->dfas);
+  free(compiled->reverse_dfas);
+  free(compiled->required);
+  free(compiled->required_lengths);
+  free(compiled->empty_patterns);
+  free(compiled->literals);
+  free(compiled->literal_lengths);
+  free(compiled->in_multi);
+  free(compiled->separate);
+  compiled->regexes = NULL;
+  compiled->dfas = NULL;
+  compiled->reverse_dfas = NULL;
+  compiled->required = NULL;
+  compiled->required_lengths = NULL;
+  compiled->empty_patterns = NULL;
+  compiled->literals = NULL;
+  compiled->literal_lengths = NULL;
+  compiled->in_multi = NULL;
+  compiled->separate = NULL;
+  compiled->separate_count = 0;
+  compiled->pattern_count = 0;
+}
+
+// Шаблон ищется через regex_t, а не как литерал
+static int has_regex(const compiled_patterns_t *compiled, int i) {
+  return !compiled->literals[i] && !compiled->empty_patterns[i];
+}
+
+static void free_regex_copies(regex_t *copies,
+                              const compiled_patterns_t *compiled, int count) {
+  for (int i = 0; i < count; i++) {
+    if (has_regex(compiled, i)) regfree(&copies[i]);
+  }
+  free(copies);
+}
+
+// Свои копии regex: те же шаблоны уже прошли regcomp(), поэтому ошибкой
+// может быть только нехватка памяти. Возвращает NULL при ошибке.
+static regex_t *compile_regex_copies(const compiled_patterns_t *compiled) {
+  regex_t *copies = calloc((size_t)compiled->pattern_count + 1,
+                           sizeof(regex_t));
+  for (int i = 0; copies && i < compiled->pattern_count; i++) {
+    if (!has_regex(compiled, i)) continue;
+    char *escaped = NULL;
+    if (compiled->flags & MATCH_FIXED_STRINGS) {
+      escaped = escape_literal(compiled->sources[i]);
+    }
+    const char *source = escaped ? escaped : compiled->sources[i];
+    int failed = ((compiled->flags & MATCH_FIXED_STRINGS) && !escaped) ||
+                 regcomp(&copies[i], source, regex_cflags(compiled->flags));
+    free(escaped);
+    if (failed) {
+      free_regex_copies(copies, compiled, i);
+      copies = NULL;
+    }
+  }
+  return copies;
+}
+
+int match_thread_init(match_thread_t *thread,
+                      const compiled_patterns_t *compiled, int copy_regexes) {
+  thread->compiled = compiled;
+  thread->regexes = compiled->regexes;
+  thread->copies = NULL;
+  size_t count = (size_t)compiled->pattern_count + 1;
+  thread->dfa_caches = calloc(count, sizeof(dfa_cache_t));
+  thread->reverse_caches = calloc(count, sizeof(dfa_cache_t));
+  int failed = !thread->dfa_caches || !thread->reverse_caches;
+  for (int i = 0; !failed && i < compiled->pattern_count; i++) {
+    if (compiled->dfas[i]) {
+      failed = dfa_cache_init(&thread->dfa_caches[i], compiled->dfas[i]) ||
+               dfa_cache_init(&thread->reverse_caches[i],
+                              compiled->reverse_dfas[i]);
+    }
+  }
+  if (!failed && copy_regexes) {
+    thread->copies = compile_regex_copies(compiled);
+    failed = thread->copies == NULL;
+  }
+  if (failed) {
+    match_thread_free(thread);
+    return 1;
+  }
+  if (thread->copies) thread->regexes = thread->copies;
+  return 0;
+}
+
+void match_thread_free(match_thread_t *thread) {
+  const compiled_patterns_t *compiled = thread->compiled;
+  if (thread->copies) {
+    free_regex_copies(thread->copies, compiled, compiled->pattern_count);
+  }
+  // Кэши, до которых не дошла инициализация, нулевые
+  for (int i = 0; i < compiled->pattern_count; i++) {
+    if (thread->dfa_caches) dfa_cache_free(&thread->dfa_caches[i]);
+    if (thread->reverse_caches) dfa_cache_free(&thread->reverse_caches[i]);
+  }
+  free(thread->dfa_caches);
+  free(thread->reverse_caches);
+  thread->regexes = NULL;
+  thread->copies = NULL;
+  thread->dfa_caches = NULL;
+  thread->reverse_caches = NULL;
+}
+
+static const char *find_literal(const compiled_patterns_t *compiled,
+                                const char *haystack, size_t haystack_len,
+                                const char *literal, size_t literal_len) {
+  return compiled->ignore_case
+             ? s21_memmem_icase(haystack, haystack_len, literal, literal_len)
+             : s21_memmem(haystack, haystack_len, literal, literal_len);
+}
+
+// Ищет первое совпадение шаблона i в line[offset..len); границы совпадения
+// возвращаются относительно offset, как у regexec() от line + offset
+static int find_pattern_match(const compiled_patterns_t *compiled,
+                              match_cache_t *cache, int i, const char *line,
+                              size_t len, size_t offset, regmatch_t *match) {
+  if (compiled->literals[i]) {
+    const char *found =
+        find_literal(compiled, line + offset, len - offset,
+                     compiled->literals[i], compiled->literal_lengths[i]);
+    if (!found) return 0;
+    match->rm_so = (regoff_t)(found - (line + offset));
+    match->rm_eo = match->rm_so + (regoff_t)compiled->literal_lengths[i];
+    return 1;
+  }
+  if (compiled->required[i] &&
+      !find_literal(compiled, line + offset, len - offset,
+                    compiled->required[i], compiled->required_lengths[i])) {
+    return 0;
+  }
+  if (compiled->dfas[i]) {
+    size_t start, end;
+    match_thread_t *thread = cache->thread;
+    int found = dfa_match(compiled->dfas[i], &thread->dfa_caches[i],
+                          compiled->reverse_dfas[i], &thread->reverse_caches[i],
+                          line, line + offset, line + len, &start, &end);
+    if (found >= 0) {
+      match->rm_so = (regoff_t)start;
+      match->rm_eo = (regoff_t)end;
+      return found;
+    }
+    // Без памяти под состояния ДКА ищем через regexec()
+  }
+  // REG_STARTEND: строка не обязана заканчиваться '\0', а символ перед
+  // offset виден regexec() как контекст
+  match->rm_so = (regoff_t)offset;
+  match->rm_eo = (regoff_t)len;
+  const regex_t *regex = &cache->thread->regexes[i];
+  if (regexec(regex, line, 1, match, REG_STARTEND) != 0) {
+    return 0;
+  }
+  match->rm_so -= (regoff_t)offset;
+  match->rm_eo -= (regoff_t)offset;
+  return 1;
+}
+
+// Ближайшее непустое совпадение шаблона i в line[from..len). Найденное
+// совпадение самое левое и самое длинное, поэтому после пустого совпадения
+// непустое может начаться только за ним.
+static void next_nonempty_match(const compiled_patterns_t *compiled,
+                                match_cache_t *cache, int i,
+                                const char *line, size_t len, size_t from,
+                                size_t *start, size_t *end) {
+  regmatch_t match;
+  *start = ONLY_NONE;
+  while (from < len &&
+         find_pattern_match(compiled, cache, i, line, len, from, &match)) {
+    if (match.rm_eo > match.rm_so) {
+      *start = from + (size_t)match.rm_so;
+      *end = from + (size_t)match.rm_eo;
+      return;
+    }
+    from += (size_t)match.rm_so + 1;
+  }
+}
+
+int next_only_match(const compiled_patterns_t *compiled, match_cache_t *cache,
+                    const char *line, size_t len, size_t offset,
+                    size_t *match_start, size_t *match_end) {
+  size_t *starts = cache->only_start;
+  size_t *ends = cache->only_end;
+  if (offset == 0) {
+    // Литералы общего автомата не ищутся по одному, если в строке нет
+    // ни одного из них
+    size_t match_len;
+    int multi_found =
+        !compiled->has_multi ||
+        multi_literal_find(&compiled->multi, line, len, &match_len) != NULL;
+    for (int i = 0; i < compiled->pattern_count; i++) {
+      int none = compiled->empty_patterns[i] ||
+                 (compiled->in_multi[i] && !multi_found);
+      starts[i] = none ? ONLY_NONE : ONLY_UNKNOWN;
+    }
+  }
+
+  int best = -1;
+  for (int i = 0; i < compiled->pattern_count; i++) {
+    if (starts[i] == ONLY_NONE) continue;
+    // Совпадение, начавшееся до offset, перекрыто уже выведенным
+    if (starts[i] == ONLY_UNKNOWN || starts[i] < offset) {
+      next_nonempty_match(compiled, cache, i, line, len, offset, &starts[i],
+                          &ends[i]);
+      if (starts[i] == ONLY_NONE) continue;
+    }
+    if (best < 0 || starts[i] < starts[best] ||
+        (starts[i] == starts[best] && ends[i] > ends[best])) {
+      best = i;
+    }
+  }
+  if (best < 0) return 0;
+  *match_start = starts[best];
+  *match_end = ends[best];
+  return 1;
+}
+
+int match_cache_init(match_cache_t *cache, const compiled_patterns_t *compiled,
+                     match_thread_t *thread) {
+  cache->thread = thread;
+  cache->searcher_count = compiled->separate_count + 1;
+  cache->next = malloc(sizeof(char *) * (size_t)cache->searcher_count);
+  cache->next_len = malloc(sizeof(size_t) * (size_t)cache->searcher_count);
+  size_t pattern_count = (size_t)compiled->pattern_count + 1;
+  cache->only_start = malloc(sizeof(size_t) * pattern_count);
+  cache->only_end = malloc(sizeof(size_t) * pattern_count);
+  // Счётчики фильтра живут дольше блока: они сбрасываются только здесь
+  cache->prefilter_state = calloc(pattern_count, sizeof(int));
+  if (!cache->next || !cache->next_len || !cache->only_start ||
+      !cache->only_end || !cache->prefilter_state) {
+    match_cache_free(cache);
+    return 1;
+  }
+  match_cache_reset(cache);
+  return 0;
+}
+
+void match_cache_reset(match_cache_t *cache) {
+  cache->block_end = NULL;
+  for (int k = 0; k < cache->searcher_count; k++) cache->next[k] = NULL;
+}
+
+void match_cache_free(match_cache_t *cache) {
+  free(cache->next);
+  free(cache->next_len);
+  free(cache->only_start);
+  free(cache->only_end);
+  free(cache->prefilter_state);
+  cache->next = NULL;
+  cache->next_len = NULL;
+  cache->only_start = NULL;
+  cache->only_end = NULL;
+  cache->prefilter_state = NULL;
+  cache->searcher_count = 0;
+}
+
+// Ищет regex i в [from, search_end), begin - начало блока. Совпадение,
+// захватившее '\n' (например, через [[:space:]]), проверяется повторно в
+// пределах своей строки. ДКА через '\n' не переходит и возвращает не
+// начало, а конец ближайшего совпадения (длина тогда 0): для выбора строки
+// этого достаточно.
+static const char *search_regex(const compiled_patterns_t *compiled,
+                                match_cache_t *cache, int i,
+                                const char *begin, const char *from,
+                                const char *search_end, size_t *match_len) {
+  const regex_t *regex = &cache->thread->regexes[i];
+  if (compiled->dfas[i]) {
+    const char *found;
+    int status = dfa_search(compiled->dfas[i], &cache->thread->dfa_caches[i],
+                            begin, from, search_end, &found);
+    if (status >= 0) {
+      *match_len = 0;
+      return status ? found : NULL;
+    }
+  }
+  while (from <= search_end) {
+    regmatch_t match = {(regoff_t)(from - begin),
+                        (regoff_t)(search_end - begin)};
+    if (regexec(regex, begin, 1, &match, REG_STARTEND) != 0) {
+      return NULL;
+    }
+    const char *found = begin + match.rm_so;
+    size_t found_len = (size_t)(match.rm_eo - match.rm_so);
+    if (!memchr(found, '\n', found_len)) {
+      *match_len = found_len;
+      return found;
+    }
+
+    const char *line_end = memchr(found, '\n', (size_t)(search_end - found));
+    if (!line_end) line_end = search_end;
+    const char *line_start = found;
+    while (line_start > begin && line_start[-1] != '\n') line_start--;
+    regmatch_t line_match = {0, (regoff_t)(line_end - line_start)};
+    if (regexec(regex, line_start, 1, &line_match, REG_STARTEND) == 0) {
+      *match_len = (size_t)(line_match.rm_eo - line_match.rm_so);
+      return line_start + line_match.rm_so;
+    }
+    from = line_end + 1;
+  }
+  return NULL;
+}
+
+// Ищет regex i только в строках, где есть его обязательный литерал: их
+// находит SIMD-поиск подстроки, остальные строки regex не видит. Если
+// литерал раз за разом находится в первой же строке, фильтр ничего не
+// пропускает и лишь добавляет проходов, поэтому на время отключается.
+static const char *search_prefiltered(const compiled_patterns_t *compiled,
+                                      match_cache_t *cache, int i,
+                                      const char *begin,
+                                      const char *search_end,
+                                      size_t *match_len) {
+  int *state = &cache->prefilter_state[i];
+  if (*state < 0) {
+    (*state)++;
+    return search_regex(compiled, cache, i, begin, begin, search_end,
+                        match_len);
+  }
+  const char *from = begin;
+  while (from < search_end) {
+    const char *hit =
+        find_literal(compiled, from, (size_t)(search_end - from),
+                     compiled->required[i], compiled->required_lengths[i]);
+    if (!hit) return NULL;
+    const char *line_start = memrchr(from, '\n', (size_t)(hit - from));
+    if (line_start) {
+      line_start++;
+      *state = 0;
+    } else {
+      line_start = from;
+      if (++*state == PREFILTER_DENSE_HITS) *state = -PREFILTER_PAUSE;
+    }
+    const char *line_end = memchr(hit, '\n', (size_t)(search_end - hit));
+    if (!line_end) line_end = search_end;
+    const char *found =
+        search_regex(compiled, cache, i, begin, line_start, line_end,
+                     match_len);
+    if (found) return found;
+    from = line_end + 1;
+  }
+  return NULL;
+}
+
+// Следующий кандидат поисковика k начиная с begin
+static const char *search_next(const compiled_patterns_t *compiled,
+                               match_cache_t *cache, int k,
+                               const char *begin, const char *end,
+                               const char *search_end, size_t *match_len) {
+  if (k == compiled->separate_count) {
+    return multi_literal_find(&compiled->multi, begin, (size_t)(end - begin),
+                              match_len);
+  }
+  int i = compiled->separate[k];
+  if (!compiled->literals[i]) {
+    return compiled->required[i]
+               ? search_prefiltered(compiled, cache, i, begin, search_end,
+                                    match_len)
+               : search_regex(compiled, cache, i, begin, begin, search_end,
+                              match_len);
+  }
+  *match_len = compiled->literal_lengths[i];
+  return find_literal(compiled, begin, (size_t)(end - begin),
+                      compiled->literals[i], *match_len);
+}
+
+const char *find_matching_line(const compiled_patterns_t *compiled,
+                               match_cache_t *cache, const char *begin,
+                               const char *end, const char **line_end) {
+  if (begin >= end) return NULL;
+  // Завершающий '\n' блока не участвует в поиске regex: иначе $ совпал бы
+  // с несуществующей пустой строкой после него
+  const char *search_end = end[-1] == '\n' ? end - 1 : end;
+
+  const char *candidate = NULL;
+  if (compiled->has_empty) {
+    candidate = begin;
+  } else {
+    if (cache->block_end != end) {
+      match_cache_reset(cache);
+      cache->block_end = end;
+    }
+    for (int k = 0; k < cache->searcher_count; k++) {
+      if (k == compiled->separate_count && !compiled->has_multi) continue;
+      // Кандидат, найденный с более ранней позиции, остаётся первым и для
+      // begin, пока он не позади
+      if (cache->next[k] == NULL || cache->next[k] < begin) {
+        const char *found = search_next(compiled, cache, k, begin, end,
+                                        search_end, &cache->next_len[k]);
+        // end означает "нет совпадения"; пустое совпадение в самом конце
+        // блока без '\n' (например, $) относится к его последней строке
+        if (found == end) found = end - 1;
+        cache->next[k] = found ? found : end;
+      }
+      if (cache->next[k] != end &&
+          (candidate == NULL || cache->next[k] < candidate)) {
+        candidate = cache->next[k];
+      }
+    }
+  }
+  if (!candidate) return NULL;
+
+  const char *line_start = memrchr(begin, '\n', (size_t)(candidate - begin));
+  line_start = line_start ? line_start + 1 : begin;
+  *line_end = memchr(candidate, '\n', (size_t)(end - candidate));
+  if (!*line_end) *line_end = end;
+  return line_start;
+}
+
+// Побайтовые совпадения с '\n' вычитаются из 8-битных счётчиков (0xFF -
+// это -1); не позже чем через 255 шагов счётчики складываются через SAD.
+// Без оптимизации (-O0) intrinsics медленнее memchr() из libc, поэтому
+// векторный путь включается только в оптимизированной сборке.
+size_t count_newlines(const char *begin, const char *end) {
+  size_t count = 0;
+#if defined(__OPTIMIZE__)
+  size_t len = begin < end ? (size_t)(end - begin) : 0;
+  size_t i = 0;
+#if defined(__AVX2__)
+  const __m256i newline32 = _mm256_set1_epi8('\n');
+  while (i + 32 <= len) {
+    size_t steps = (len - i) / 32;
+    if (steps > 255) steps = 255;
+    __m256i counters = _mm256_setzero_si256();
+    for (size_t s = 0; s < steps; s++, i += 32) {
+      __m256i bytes = _mm256_loadu_si256((const __m256i *)(begin + i));
+      counters = _mm256_sub_epi8(counters,
+                                 _mm256_cmpeq_epi8(bytes, newline32));
+    }
+    __m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+    count += (size_t)_mm256_extract_epi64(sums, 0) +
+             (size_t)_mm256_extract_epi64(sums, 1) +
+             (size_t)_mm256_extract_epi64(sums, 2) +
+             (size_t)_mm256_extract_epi64(sums, 3);
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i newline16 = _mm_set1_epi8('\n');
+  while (i + 16 <= len) {
+    size_t steps = (len - i) / 16;
+    if (steps > 255) steps = 255;
+    __m128i counters = _mm_setzero_si128();
+    for (size_t s = 0; s < steps; s++, i += 16) {
+      __m128i bytes = _mm_loadu_si128((const __m128i *)(begin + i));
+      counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(bytes, newline16));
+    }
+    __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+    count += (size_t)_mm_cvtsi128_si32(sums) +
+             (size_t)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+  }
+#endif
+  for (; i < len; i++) count += begin[i] == '\n';
+#else
+  while (begin < end &&
+         (begin = memchr(begin, '\n', (size_t)(end - begin))) != NULL) {
+    count++;
+    begin++;
+  }
+#endif
+  return count;
+}
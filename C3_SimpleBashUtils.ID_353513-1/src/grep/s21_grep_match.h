@@ -0,0 +1,110 @@
+#ifndef S21_GREP_MATCH_H
+#define S21_GREP_MATCH_H
+
+#include <regex.h>
+#include <stddef.h>
+
+#include "s21_grep_ac.h"
+#include "s21_grep_dfa.h"
+
+// Флаги компиляции набора шаблонов
+#define MATCH_IGNORE_CASE 1    // -i
+#define MATCH_FIXED_STRINGS 2  // -F
+#define MATCH_REGEX_ONLY 4     // Только regexec(), без ДКА
+
+// Шаблоны, скомпилированные один раз за запуск; общие для всех файлов и
+// потоков и после компиляции используются только на чтение. Изменяемая
+// часть поиска - в match_thread_t.
+typedef struct {
+  regex_t *regexes;         // Скомпилированные regex
+  dfa_t **dfas;             // НКА для ДКА или NULL (ищет regexec())
+  dfa_t **reverse_dfas;     // Он же справа налево: начало совпадения -o
+  char **required;          // Литерал, обязательный в совпадении regex
+  size_t *required_lengths;  // или NULL; его длина
+  int *empty_patterns;      // 1, если шаблон пустой (совпадает со всеми)
+  char **literals;          // Литерал для поиска без regex или NULL
+  size_t *literal_lengths;  // Длины литералов
+  int *in_multi;            // 1, если литерал ищется общим автоматом
+  multi_literal_t multi;    // Все литералы набора (если их больше одного)
+  int has_multi;            // 1, если multi построен
+  int *separate;       // Непустые шаблоны вне multi, проверяются по одному
+  int separate_count;  // Количество таких шаблонов
+  int has_empty;       // Есть пустой шаблон: совпадает любая строка
+  int ignore_case;     // -i: литералы сравниваются без учёта регистра
+  int pattern_count;   // Количество шаблонов
+  char *const *sources;  // Исходные шаблоны (должны жить дольше compiled)
+  int flags;             // Флаги компиляции MATCH_*
+} compiled_patterns_t;
+
+// Состояние шаблонов, которое меняется при поиске, своё у каждого потока:
+// построенные состояния ДКА и regex_t, который regexec() в glibc блокирует
+// на время поиска
+typedef struct {
+  const compiled_patterns_t *compiled;  // Шаблоны этого состояния
+  const regex_t *regexes;   // Общие regex из compiled или copies
+  regex_t *copies;          // Свои копии regex или NULL
+  dfa_cache_t *dfa_caches;  // Кэш ДКА для compiled->dfas[i]
+  dfa_cache_t *reverse_caches;  // и для compiled->reverse_dfas[i]
+} match_thread_t;
+
+// Состояние поиска по одному блоку: для каждого поисковика запоминается
+// позиция следующего кандидата, чтобы не искать заново с каждой строки.
+// У каждого потока поиска своё состояние, шаблоны остаются общими.
+typedef struct {
+  const char *block_end;   // Конец блока, для которого действует кэш
+  const char **next;       // Кандидат поисковика или NULL (ещё не искали)
+  size_t *next_len;        // Длина совпадения кандидата
+  int searcher_count;      // separate_count + 1 (последний - multi)
+  size_t *only_start;      // -o: ближайшее непустое совпадение каждого
+  size_t *only_end;        // шаблона в текущей строке
+  match_thread_t *thread;  // Состояние шаблонов текущего потока
+  int *prefilter_state;    // Попаданий литерала подряд в первую же строку
+                           // (>= 0) или сколько поисков идти без него (< 0)
+} match_cache_t;
+
+int compile_single_pattern(const char *pattern, int flags,
+                           compiled_patterns_t *compiled, int i);
+// Возвращает 0, 1 при нехватке памяти или 2 для ошибочного шаблона; текст
+// ошибки записывается в error[0..error_size), если error не NULL
+int compile_patterns(char *const *patterns, int pattern_count, int flags,
+                     compiled_patterns_t *compiled, char *error,
+                     size_t error_size);
+void build_multi_literal(compiled_patterns_t *compiled);
+void free_compiled_patterns(compiled_patterns_t *compiled);
+
+// Состояние шаблонов для потока. copy_regexes 0 - regex берутся общие из
+// compiled: так можно только в одном потоке, обычно в том, что
+// скомпилировал шаблоны; 1 - компилируются свои копии. Возвращает 0 или 1
+// при нехватке памяти.
+int match_thread_init(match_thread_t *thread,
+                      const compiled_patterns_t *compiled, int copy_regexes);
+void match_thread_free(match_thread_t *thread);
+
+int match_cache_init(match_cache_t *cache, const compiled_patterns_t *compiled,
+                     match_thread_t *thread);
+void match_cache_reset(match_cache_t *cache);
+void match_cache_free(match_cache_t *cache);
+
+// Следующее совпадение для -o в line[offset..len): самое левое, а из них
+// самое длинное по всем шаблонам сразу, как у одного ERE из их
+// альтернатив. Пустые совпадения пропускаются. offset 0 начинает новую
+// строку, дальше offset - конец предыдущего совпадения: ближайшие
+// совпадения шаблонов хранятся в cache, и каждый шаблон проходит строку
+// один раз. Возвращает 1 и границы совпадения от начала строки или 0.
+int next_only_match(const compiled_patterns_t *compiled, match_cache_t *cache,
+                    const char *line, size_t len, size_t offset,
+                    size_t *match_start, size_t *match_end);
+
+// Ищет в [begin, end) первую строку, совпадающую хотя бы с одним шаблоном.
+// begin - начало строки, end - конец блока целых строк. Совпадение ищется
+// сразу по всему блоку, строка вокруг кандидата находится через
+// memchr/memrchr. Возвращает начало строки и её конец (позицию '\n' или
+// end) в line_end либо NULL.
+const char *find_matching_line(const compiled_patterns_t *compiled,
+                               match_cache_t *cache, const char *begin,
+                               const char *end, const char **line_end);
+
+// Число '\n' в [begin, end): SSE2/AVX2, если они доступны при сборке
+size_t count_newlines(const char *begin, const char *end);
+
+#endif
@@ -0,0 +1,184 @@
+#include "s21_grep_output.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+void output_init_stream(output_t *out, FILE *stream) {
+  memset(out, 0, sizeof(*out));
+  out->stream = stream;
+}
+
+void output_init_fd(output_t *out, int fd) {
+  memset(out, 0, sizeof(*out));
+  out->fd = fd;
+  out->flush_size = OUTPUT_FILE_BUFFER;
+  struct stat st;
+  if (isatty(fd)) {
+    out->line_buffered = 1;
+    out->flush_size = OUTPUT_TTY_BUFFER;
+  } else if (fstat(fd, &st) == 0 && (S_ISFIFO(st.st_mode) ||
+                                     S_ISSOCK(st.st_mode))) {
+    // Запись размером с канал не блокируется на полпути, пока читатель
+    // успевает его опустошать
+    out->flush_size = OUTPUT_PIPE_BUFFER;
+#if defined(F_GETPIPE_SZ)
+    int pipe_size = fcntl(fd, F_GETPIPE_SZ);
+    if (pipe_size > 0) out->flush_size = (size_t)pipe_size;
+#endif
+  }
+}
+
+void output_init_buffer(output_t *out) { memset(out, 0, sizeof(*out)); }
+
+int output_rewindable(const output_t *out, size_t flushes) {
+  return !out->stream && out->flushes == flushes;
+}
+
+static int output_reserve(output_t *out, size_t extra) {
+  if (out->failed) return 1;
+  if (out->length + extra <= out->capacity) return 0;
+  size_t capacity = out->capacity ? out->capacity : 4096;
+  while (capacity < out->length + extra) capacity *= 2;
+  char *grown = realloc(out->data, capacity);
+  if (!grown) {
+    out->failed = 1;
+    return 1;
+  }
+  out->data = grown;
+  out->capacity = capacity;
+  return 0;
+}
+
+// Записывает iov целиком, продолжая после частичной записи
+static int write_all(int fd, struct iovec *iov, int count) {
+  while (count > 0) {
+    ssize_t written = writev(fd, iov, count);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return 1;
+    }
+    size_t left = (size_t)written;
+    while (count > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count > 0) {
+      iov->iov_base = (char *)iov->iov_base + left;
+      iov->iov_len -= left;
+    }
+  }
+  return 0;
+}
+
+// Выводит накопленное и, если есть, ещё data одним writev()
+static void write_out(output_t *out, const char *data, size_t length) {
+  struct iovec iov[2];
+  int count = 0;
+  if (out->length) {
+    iov[count].iov_base = out->data;
+    iov[count++].iov_len = out->length;
+  }
+  if (length) {
+    iov[count].iov_base = (void *)data;
+    iov[count++].iov_len = length;
+  }
+  if (!out->failed && write_all(out->fd, iov, count) != 0) out->failed = 1;
+  out->length = 0;
+  out->flushes++;
+}
+
+// Для дескриптора: место под extra байт в буфере, при необходимости
+// после сброса накопленного
+static int fd_reserve(output_t *out, size_t extra) {
+  if (out->length + extra > out->flush_size && out->length) {
+    write_out(out, NULL, 0);
+  }
+  return output_reserve(out, extra);
+}
+
+static int output_room(output_t *out, size_t extra) {
+  return out->flush_size ? fd_reserve(out, extra) : output_reserve(out, extra);
+}
+
+// Терминалу строка отдаётся сразу, как только она закончилась
+static void fd_appended(output_t *out) {
+  if (out->line_buffered && out->length && out->data[out->length - 1] == '\n') {
+    write_out(out, NULL, 0);
+  }
+}
+
+void output_write(output_t *out, const char *data, size_t length) {
+  if (length == 0) return;
+  if (out->stream) {
+    fwrite(data, 1, length, out->stream);
+  } else if (out->flush_size && length >= OUTPUT_DIRECT_MIN) {
+    // Длинный кусок (обычно строка из файла) не копируется
+    write_out(out, data, length);
+  } else if (output_room(out, length) == 0) {
+    memcpy(out->data + out->length, data, length);
+    out->length += length;
+    if (out->flush_size) fd_appended(out);
+  }
+}
+
+void output_putc(output_t *out, char c) {
+  if (out->stream) {
+    putc(c, out->stream);
+  } else if (output_room(out, 1) == 0) {
+    out->data[out->length++] = c;
+    if (out->flush_size) fd_appended(out);
+  }
+}
+
+void output_number(output_t *out, size_t value) {
+  char digits[24];
+  char *p = digits + sizeof(digits);
+  do {
+    *--p = (char)('0' + value % 10);
+    value /= 10;
+  } while (value);
+  output_write(out, p, (size_t)(digits + sizeof(digits) - p));
+}
+
+void output_printf(output_t *out, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  if (out->stream) {
+    vfprintf(out->stream, format, args);
+  } else {
+    va_list copy;
+    va_copy(copy, args);
+    int needed = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    if (needed > 0 && output_room(out, (size_t)needed + 1) == 0) {
+      vsnprintf(out->data + out->length, (size_t)needed + 1, format, args);
+      out->length += (size_t)needed;
+      if (out->flush_size) fd_appended(out);
+    }
+  }
+  va_end(args);
+}
+
+int output_flush_to(output_t *out, output_t *dest) {
+  if (out->length) output_write(dest, out->data, out->length);
+  out->length = 0;
+  return out->failed;
+}
+
+int output_flush(output_t *out) {
+  if (out->flush_size && out->length) write_out(out, NULL, 0);
+  if (out->stream) fflush(out->stream);
+  return out->failed;
+}
+
+void output_free(output_t *out) {
+  free(out->data);
+  memset(out, 0, sizeof(*out));
+}
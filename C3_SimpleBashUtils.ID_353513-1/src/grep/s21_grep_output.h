@@ -0,0 +1,52 @@
+#ifndef S21_GREP_OUTPUT_H
+#define S21_GREP_OUTPUT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Размеры буфера вывода в дескриптор в зависимости от того, куда он ведёт
+#define OUTPUT_TTY_BUFFER 4096            // Терминал: сброс после строки
+#define OUTPUT_PIPE_BUFFER (64 * 1024)    // Канал без F_GETPIPE_SZ
+#define OUTPUT_FILE_BUFFER (1024 * 1024)  // Обычный файл
+// Куски не короче этого не копируются в буфер, а уходят в writev() вместе
+// с накопленным
+#define OUTPUT_DIRECT_MIN (16 * 1024)
+
+// Приёмник вывода: поток (stderr), дескриптор с собственным буфером
+// (stdout: write()/writev() без stdio) или буфер в памяти, который потом
+// целиком выводится в нужном порядке (-j). Обнулённый output_t - пустой
+// буфер в памяти.
+typedef struct {
+  FILE *stream;       // Поток для прямого вывода или NULL
+  int fd;             // Дескриптор для вывода через буфер
+  int line_buffered;  // Терминал: буфер сбрасывается после каждой строки
+  size_t flush_size;  // Порог сброса в fd; 0 - буфер только в памяти
+  char *data;         // Накопленный вывод
+  size_t length;      // Занято байт
+  size_t capacity;    // Размер data
+  size_t flushes;     // Сколько раз накопленное записано в fd
+  int failed;  // Не хватило памяти или запись не удалась: вывод потерян
+} output_t;
+
+void output_init_stream(output_t *out, FILE *stream);
+// Размер буфера и сброс по строкам выбираются по тому, терминал это,
+// канал или файл
+void output_init_fd(output_t *out, int fd);
+void output_init_buffer(output_t *out);
+// Вывод можно отменить до длины, сохранённой при счётчике flushes, если
+// с тех пор буфер не записывался в fd (и это не поток)
+int output_rewindable(const output_t *out, size_t flushes);
+void output_write(output_t *out, const char *data, size_t length);
+void output_putc(output_t *out, char c);
+// Десятичное число без printf()
+void output_number(output_t *out, size_t value);
+void output_printf(output_t *out, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+// Дописывает накопленное в dest и очищает буфер. Возвращает 0 или 1, если
+// часть вывода была потеряна из-за нехватки памяти.
+int output_flush_to(output_t *out, output_t *dest);
+// Записывает буфер дескриптора. Возвращает 0 или 1, если вывод потерян.
+int output_flush(output_t *out);
+void output_free(output_t *out);
+
+#endif
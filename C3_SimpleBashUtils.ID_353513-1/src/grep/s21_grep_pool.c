@@ -0,0 +1,513 @@
+#include "s21_grep_pool.h"
+
+#include <pthread.h>
+
+typedef struct {
+  const pool_job_t *job;
+  int *done;      // Задача выполнена и ждёт collect
+  int next_task;  // Следующая задача для свободного потока
+  int collected;  // Сколько задач уже забрано
+  int ahead;      // Предел next_task - collected
+  int stopped;    // collect попросил остановиться
+  pthread_mutex_t lock;
+  pthread_cond_t task_done;  // Поток закончил задачу
+  pthread_cond_t slot_free;  // Результат забран, можно брать задачу
+} pool_t;
+
+static void *pool_worker(void *arg) {
+  pool_t *pool = arg;
+  const pool_job_t *job = pool->job;
+  void *state = job->thread_start ? job->thread_start(job->context) : NULL;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->stopped && pool->next_task < job->task_count &&
+           pool->next_task - pool->collected >= pool->ahead) {
+      pthread_cond_wait(&pool->slot_free, &pool->lock);
+    }
+    if (pool->stopped || pool->next_task >= job->task_count) break;
+    int index = pool->next_task++;
+    pthread_mutex_unlock(&pool->lock);
+
+    job->run(job->context, state, index);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->done[index] = 1;
+    pthread_cond_signal(&pool->task_done);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  if (job->thread_finish) job->thread_finish(job->context, state);
+  return NULL;
+}
+
+// Забирает результаты по порядку по мере готовности
+static void pool_collect(pool_t *pool) {
+  const pool_job_t *job = pool->job;
+  for (int i = 0; i < job->task_count; i++) {
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->done[i]) pthread_cond_wait(&pool->task_done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+
+    int stop = job->collect(job->context, i);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->collected = i + 1;
+    pool->stopped = stop;
+    pthread_cond_broadcast(&pool->slot_free);
+    pthread_mutex_unlock(&pool->lock);
+    if (stop) break;
+  }
+}
+
+int pool_run(const pool_job_t *job) {
+  int jobs = job->jobs < job->task_count ? job->jobs : job->task_count;
+  if (jobs < 1) jobs = 1;
+  pool_t pool = {0};
+  pool.job = job;
+  pool.ahead = jobs * POOL_AHEAD_PER_JOB;
+  pool.done = calloc((size_t)job->task_count + 1, sizeof(int));
+  pthread_t *threads = malloc(sizeof(pthread_t) * (size_t)jobs);
+  if (!pool.done || !threads) {
+    free(pool.done);
+    free(threads);
+    return -1;
+  }
+  pthread_mutex_init(&pool.lock, NULL);
+  pthread_cond_init(&pool.task_done, NULL);
+  pthread_cond_init(&pool.slot_free, NULL);
+
+  int started = 0;
+  while (started < jobs &&
+         pthread_create(&threads[started], NULL, pool_worker, &pool) == 0) {
+    started++;
+  }
+  // Ни один поток не запустился: все задачи выполняет текущий поток
+  if (started == 0) {
+    pool.ahead = job->task_count;
+    pool_worker(&pool);
+  }
+
+  pool_collect(&pool);
+  for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+
+  pthread_cond_destroy(&pool.slot_free);
+  pthread_cond_destroy(&pool.task_done);
+  pthread_mutex_destroy(&pool.lock);
+  free(threads);
+  free(pool.done);
+  return pool.collected;
+}
+
+// Своё состояние шаблонов для потока или NULL, если на него нет памяти:
+// тогда задачи этого потока выполняет вызывающий поток, когда забирает их
+// результаты
+static void *start_thread_state(const compiled_patterns_t *compiled) {
+  match_thread_t *thread = malloc(sizeof(match_thread_t));
+  if (thread && match_thread_init(thread, compiled, 1) != 0) {
+    free(thread);
+    thread = NULL;
+  }
+  return thread;
+}
+
+static void finish_thread_state(void *state) {
+  if (state) {
+    match_thread_free(state);
+    free(state);
+  }
+}
+
+// Поиск по нескольким файлам
+
+// Результат поиска в одном файле, ожидающий вывода
+typedef struct {
+  output_t out;
+  output_t err;
+  int match_count;
+  int error_occurred;
+  int deferred;  // Потоку не хватило памяти: файл ищется при выводе
+} file_result_t;
+
+typedef struct {
+  char **files;
+  int file_count;
+  int multiple_files;
+  grep_options_t opts;
+  const compiled_patterns_t *compiled;
+  file_result_t *results;
+  output_t *out;  // Общий вывод, куда результаты идут по порядку
+  output_t *err;
+  int total_matches;
+  int error_occurred;
+} files_job_t;
+
+static void *files_thread_start(void *context) {
+  return start_thread_state(((files_job_t *)context)->compiled);
+}
+
+static void files_thread_finish(void *context, void *state) {
+  (void)context;
+  finish_thread_state(state);
+}
+
+static void files_run(void *context, void *state, int index) {
+  files_job_t *files = context;
+  file_result_t *result = &files->results[index];
+  if (!state) {
+    result->deferred = 1;
+    return;
+  }
+  grep_options_t opts = files->opts;
+  opts.thread = state;
+  result->match_count = process_file(
+      files->files[index], opts, files->compiled, files->multiple_files,
+      &result->out, &result->err, &result->error_occurred);
+}
+
+static int files_collect(void *context, int index) {
+  files_job_t *files = context;
+  file_result_t *result = &files->results[index];
+  if (result->deferred) {
+    // Вызывающий поток ищет своим состоянием шаблонов сразу в общий вывод
+    result->match_count = process_file(
+        files->files[index], files->opts, files->compiled,
+        files->multiple_files, files->out, files->err, &files->error_occurred);
+  }
+  int lost = output_flush_to(&result->err, files->err);
+  lost |= output_flush_to(&result->out, files->out);
+  if (lost) {
+    fprintf(stderr, "grep: %s: memory allocation failed\n",
+            files->files[index]);
+    files->error_occurred = 1;
+  }
+  if (result->error_occurred) files->error_occurred = 1;
+  files->total_matches += result->match_count;
+  output_free(&result->out);
+  output_free(&result->err);
+  // -q: совпадение найдено, остальные файлы не нужны
+  return files->opts.quiet && files->total_matches > 0;
+}
+
+int grep_files_parallel(char **files, int file_count, int multiple_files,
+                        grep_options_t opts,
+                        const compiled_patterns_t *compiled, output_t *out,
+                        output_t *err, int *error_occurred) {
+  files_job_t context = {0};
+  context.out = out;
+  context.err = err;
+  context.files = files;
+  context.file_count = file_count;
+  context.multiple_files = multiple_files;
+  context.opts = opts;
+  // Файлы уже ищутся параллельно: внутри файла - в одном потоке
+  context.opts.jobs = 1;
+  context.compiled = compiled;
+  context.results = calloc((size_t)file_count, sizeof(file_result_t));
+
+  pool_job_t job = {file_count,          opts.jobs,
+                    &context,            files_thread_start,
+                    files_thread_finish, files_run,
+                    files_collect};
+  int collected = context.results ? pool_run(&job) : -1;
+  if (collected < 0) {
+    // Пул не запустился (нет памяти): файлы ищутся по очереди здесь же
+    free(context.results);
+    int total_matches = 0;
+    for (int i = 0; i < file_count && !(opts.quiet && total_matches); i++) {
+      total_matches += process_file(files[i], context.opts, compiled,
+                                    multiple_files, out, err, error_occurred);
+    }
+    return total_matches;
+  }
+  // -q: вывод файлов, найденных впрок после остановки, не нужен
+  for (int i = collected; i < file_count; i++) {
+    output_free(&context.results[i].out);
+    output_free(&context.results[i].err);
+  }
+  free(context.results);
+  if (context.error_occurred) *error_occurred = 1;
+  return context.total_matches;
+}
+
+// Поиск по дереву каталогов
+
+// Пути из обхода передаются партиями: пока одна ищется, в другую уже
+// собираются следующие пути
+typedef struct {
+  walker_t *walker;
+  char **paths[2];
+  int counts[2];
+  int ready[2];  // Партия собрана и ждёт поиска
+  int last[2];   // После этой партии путей больше нет
+  int stopped;   // -q: поиск закончен, обход не нужен
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+} tree_feed_t;
+
+static void *tree_walk_thread(void *arg) {
+  tree_feed_t *feed = arg;
+  for (int k = 0;; k ^= 1) {
+    pthread_mutex_lock(&feed->lock);
+    while (feed->ready[k] && !feed->stopped) {
+      pthread_cond_wait(&feed->changed, &feed->lock);
+    }
+    int stopped = feed->stopped;
+    pthread_mutex_unlock(&feed->lock);
+    if (stopped) break;
+
+    int count = 0;
+    const char *path = NULL;
+    while (count < WALK_BATCH_FILES && (path = walk_next(feed->walker))) {
+      char *copy = strdup(path);
+      if (!copy) {
+        fprintf(stderr, "grep: %s: memory allocation failed\n", path);
+        feed->walker->error_occurred = 1;
+        continue;
+      }
+      feed->paths[k][count++] = copy;
+    }
+
+    pthread_mutex_lock(&feed->lock);
+    feed->counts[k] = count;
+    feed->last[k] = path == NULL;
+    feed->ready[k] = 1;
+    pthread_cond_broadcast(&feed->changed);
+    pthread_mutex_unlock(&feed->lock);
+    if (!path) break;
+  }
+  return NULL;
+}
+
+int grep_tree_parallel(walker_t *walker, grep_options_t opts,
+                       const compiled_patterns_t *compiled, output_t *out,
+                       output_t *err, int *error_occurred) {
+  tree_feed_t feed = {0};
+  feed.walker = walker;
+  feed.paths[0] = malloc(sizeof(char *) * WALK_BATCH_FILES * 2);
+  feed.paths[1] = feed.paths[0] + WALK_BATCH_FILES;
+  // Без потоков чтения каталоги читает сам поток обхода
+  walk_start_readers(walker, opts.jobs);
+  pthread_t thread;
+  pthread_mutex_init(&feed.lock, NULL);
+  pthread_cond_init(&feed.changed, NULL);
+  if (!feed.paths[0] ||
+      pthread_create(&thread, NULL, tree_walk_thread, &feed) != 0) {
+    pthread_cond_destroy(&feed.changed);
+    pthread_mutex_destroy(&feed.lock);
+    free(feed.paths[0]);
+    return -1;
+  }
+
+  int total_matches = 0;
+  for (int k = 0;; k ^= 1) {
+    pthread_mutex_lock(&feed.lock);
+    while (!feed.ready[k]) pthread_cond_wait(&feed.changed, &feed.lock);
+    pthread_mutex_unlock(&feed.lock);
+
+    if (feed.counts[k] > 0) {
+      total_matches +=
+          grep_files_parallel(feed.paths[k], feed.counts[k], 1, opts,
+                              compiled, out, err, error_occurred);
+    }
+    for (int i = 0; i < feed.counts[k]; i++) free(feed.paths[k][i]);
+    int done = feed.last[k] || (opts.quiet && total_matches > 0);
+
+    pthread_mutex_lock(&feed.lock);
+    feed.ready[k] = 0;
+    feed.stopped = done;
+    pthread_cond_broadcast(&feed.changed);
+    pthread_mutex_unlock(&feed.lock);
+    if (done) break;
+  }
+  pthread_join(thread, NULL);
+  // -q: партия, собранная впрок, не понадобилась
+  for (int k = 0; k < 2; k++) {
+    for (int i = 0; feed.ready[k] && i < feed.counts[k]; i++) {
+      free(feed.paths[k][i]);
+    }
+  }
+
+  pthread_cond_destroy(&feed.changed);
+  pthread_mutex_destroy(&feed.lock);
+  free(feed.paths[0]);
+  return total_matches;
+}
+
+// Поиск по частям одного файла
+
+typedef struct {
+  size_t begin;         // Начало части в файле
+  size_t end;           // Конец части (после '\n')
+  size_t newlines;      // Строк в части (-n)
+  size_t first_line;    // Строк до части (-n)
+  output_t out;         // Вывод части
+  int match_count;      // Совпадения в части
+  int faulted;          // Файл укоротили: дочитать потоком с resume
+  size_t resume;        // Смещение первой необработанной строки
+  size_t resume_line;   // Номер строки перед resume
+} chunk_t;
+
+typedef struct {
+  grep_scan_t *scan;  // Общее состояние файла, в него собирается результат
+  grep_scan_t base;   // Его копия до поиска: образец состояния для частей
+  const input_map_t *map;
+  chunk_t *chunks;
+  int chunk_count;
+  size_t lines;  // Префиксная сумма строк при подсчёте
+  int faulted;   // Сбой в одной из частей
+  size_t resume;
+} chunks_job_t;
+
+static void *chunks_thread_start(void *context) {
+  return start_thread_state(((chunks_job_t *)context)->base.compiled);
+}
+
+static void chunks_thread_finish(void *context, void *state) {
+  (void)context;
+  finish_thread_state(state);
+}
+
+// Фаза 1 (-n): число '\n' в части
+static void count_run(void *context, void *state, int index) {
+  (void)state;
+  chunks_job_t *chunks = context;
+  chunk_t *chunk = &chunks->chunks[index];
+  sigjmp_buf env;
+  INPUT_ARM_FAULT(env);
+  if (sigsetjmp(env, 1) != 0) {
+    chunk->faulted = 1;
+    return;
+  }
+  chunk->newlines = count_newlines(chunks->map->data + chunk->begin,
+                                   chunks->map->data + chunk->end);
+  INPUT_RELEASE_FAULT();
+}
+
+static int count_collect(void *context, int index) {
+  chunks_job_t *chunks = context;
+  chunk_t *chunk = &chunks->chunks[index];
+  if (chunk->faulted) {
+    chunks->faulted = 1;
+    chunks->resume = 0;
+    return 1;
+  }
+  chunk->first_line = chunks->lines;
+  chunks->lines += chunk->newlines;
+  return 0;
+}
+
+// Фаза 2: поиск в части с выводом в свой буфер
+static void search_run(void *context, void *state, int index) {
+  chunks_job_t *chunks = context;
+  chunk_t *chunk = &chunks->chunks[index];
+  grep_scan_t scan = chunks->base;
+  scan.out = &chunk->out;
+  scan.line_num = chunk->first_line;
+  scan.match_count = 0;
+
+  if (!state || match_cache_init(&scan.cache, scan.compiled, state) != 0) {
+    chunk->out.failed = 1;
+  } else {
+    chunk->faulted = scan_mapped_range(&scan, chunks->map, chunk->begin,
+                                       chunk->end, &chunk->resume);
+    chunk->match_count = scan.match_count;
+    chunk->resume_line = scan.line_num;
+    match_cache_free(&scan.cache);
+  }
+  // Без памяти под вывод или состояние шаблонов часть дочитывается потоком
+  // в вызывающем потоке сразу в общий вывод
+  if (chunk->out.failed) {
+    output_free(&chunk->out);
+    chunk->faulted = 1;
+    chunk->resume = chunk->begin;
+    chunk->resume_line = chunk->first_line;
+    chunk->match_count = 0;
+  }
+}
+
+static int search_collect(void *context, int index) {
+  chunks_job_t *chunks = context;
+  chunk_t *chunk = &chunks->chunks[index];
+  grep_scan_t *scan = chunks->scan;
+  output_write(scan->out, chunk->out.data, chunk->out.length);
+  output_free(&chunk->out);
+  scan->match_count += chunk->match_count;
+  if (chunk->faulted) {
+    scan->line_num = chunk->resume_line;
+    chunks->faulted = 1;
+    chunks->resume = chunk->resume;
+    return 1;
+  }
+  return scan_done(scan);
+}
+
+// Делит файл на части по PARALLEL_CHUNK_MIN, сдвигая границы за ближайший
+// '\n'. Возвращает число частей или -1 при SIGBUS.
+static int split_chunks(const input_map_t *map, chunk_t *chunks, int max) {
+  sigjmp_buf env;
+  INPUT_ARM_FAULT(env);
+  if (sigsetjmp(env, 1) != 0) return -1;
+  int count = 0;
+  size_t begin = 0;
+  while (begin < map->size && count < max) {
+    size_t end = map->size;
+    if (map->size - begin > PARALLEL_CHUNK_MIN) {
+      const char *newline =
+          memchr(map->data + begin + PARALLEL_CHUNK_MIN, '\n',
+                 map->size - begin - PARALLEL_CHUNK_MIN);
+      if (newline) end = (size_t)(newline - map->data) + 1;
+    }
+    chunks[count].begin = begin;
+    chunks[count].end = end;
+    count++;
+    begin = end;
+  }
+  INPUT_RELEASE_FAULT();
+  return count;
+}
+
+int scan_mapped_parallel(grep_scan_t *scan, const input_map_t *map,
+                         size_t *resume) {
+  // С -m части пришлось бы обрезать по порядку: последовательный поиск
+  // остановится раньше
+  if (scan->opts.jobs < 2 || scan->opts.max_count >= 0 ||
+      map->size < 2 * PARALLEL_CHUNK_MIN) {
+    return -1;
+  }
+
+  int max_chunks = (int)(map->size / PARALLEL_CHUNK_MIN) + 1;
+  chunks_job_t context = {0};
+  context.scan = scan;
+  context.base = *scan;
+  context.map = map;
+  context.chunks = calloc((size_t)max_chunks, sizeof(chunk_t));
+  if (!context.chunks) return -1;
+  context.chunk_count = split_chunks(map, context.chunks, max_chunks);
+  if (context.chunk_count < 2) {
+    free(context.chunks);
+    return -1;
+  }
+
+  pool_job_t job = {context.chunk_count,  scan->opts.jobs,
+                    &context,             NULL,
+                    NULL,                 count_run,
+                    count_collect};
+  int status = 0;
+  if (scan->opts.line_number) status = pool_run(&job);
+  if (status >= 0 && !context.faulted) {
+    job.thread_start = chunks_thread_start;
+    job.thread_finish = chunks_thread_finish;
+    job.run = search_run;
+    job.collect = search_collect;
+    status = pool_run(&job);
+  }
+  for (int i = 0; i < context.chunk_count; i++) {
+    output_free(&context.chunks[i].out);
+  }
+  free(context.chunks);
+
+  if (status < 0) return -1;
+  *resume = context.resume;
+  return context.faulted;
+}
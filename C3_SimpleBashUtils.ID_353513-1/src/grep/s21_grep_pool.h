@@ -0,0 +1,56 @@
+#ifndef S21_GREP_POOL_H
+#define S21_GREP_POOL_H
+
+#include "s21_grep.h"
+
+// Сколько задач на поток может быть выполнено впрок, пока результат ждёт
+// своей очереди: ограничивает память под буферы вывода
+#define POOL_AHEAD_PER_JOB 4
+
+// Большой файл при -j делится на части не меньше этого размера
+#define PARALLEL_CHUNK_MIN (8 * 1024 * 1024)
+
+// Задачи 0..task_count-1 выполняются в jobs потоках, а их результаты
+// забираются в текущем потоке строго по порядку
+typedef struct {
+  int task_count;
+  int jobs;
+  void *context;
+  // Состояние потока (например, своё состояние шаблонов); может быть NULL
+  void *(*thread_start)(void *context);
+  void (*thread_finish)(void *context, void *state);
+  void (*run)(void *context, void *state, int index);
+  // Вызывается по порядку; ненулевой ответ - остальные задачи не нужны
+  int (*collect)(void *context, int index);
+} pool_job_t;
+
+// Возвращает индекс первой незабранной задачи (task_count, если забраны все)
+int pool_run(const pool_job_t *job);
+
+// -j N: ищет в files[] в N потоках. Вывод каждого файла копится в буфере
+// и печатается в порядке командной строки, поэтому совпадает с
+// последовательным запуском байт в байт в out и err. Возвращает сумму
+// совпадений.
+int grep_files_parallel(char **files, int file_count, int multiple_files,
+                        grep_options_t opts,
+                        const compiled_patterns_t *compiled, output_t *out,
+                        output_t *err, int *error_occurred);
+
+// -r -j N: обход дерева идёт в отдельном потоке, ещё N потоков открывают и
+// читают подкаталоги впрок (walk_start_readers()). Найденные файлы ищутся
+// партиями по WALK_BATCH_FILES через grep_files_parallel(), пока собирается
+// следующая партия. Порядок вывода - порядок обхода. Возвращает сумму
+// совпадений или -1, если поток обхода не запустился.
+int grep_tree_parallel(walker_t *walker, grep_options_t opts,
+                       const compiled_patterns_t *compiled, output_t *out,
+                       output_t *err, int *error_occurred);
+
+// -j N для одного большого отображённого файла: файл делится на части по
+// границам строк, части ищутся параллельно, вывод собирается по порядку в
+// scan->out. Для -n номера строк частей находятся префиксной суммой числа
+// '\n' в них. Возвращает 0, 1 (файл укоротили: дочитать потоком с resume)
+// или -1, если файл слишком мал и ищется обычным способом.
+int scan_mapped_parallel(grep_scan_t *scan, const input_map_t *map,
+                         size_t *resume);
+
+#endif
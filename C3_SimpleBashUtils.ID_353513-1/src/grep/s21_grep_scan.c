@@ -0,0 +1,570 @@
+#include "s21_grep.h"
+
+#include "s21_grep_index.h"
+#include "s21_grep_pool.h"
+
+// Префикс собирается из кусков без разбора формата printf()
+static void print_line_prefix(const grep_scan_t *scan, size_t line_num) {
+  if (scan->multiple_files && !scan->opts.no_filename) {
+    output_write(scan->out, scan->filename, scan->filename_length);
+    output_putc(scan->out, ':');
+  }
+  if (scan->opts.line_number) {
+    output_number(scan->out, line_num);
+    output_putc(scan->out, ':');
+  }
+}
+
+static void print_line(const grep_scan_t *scan, const char *line,
+                       const char *line_end, size_t line_num) {
+  print_line_prefix(scan, line_num);
+  output_write(scan->out, line, (size_t)(line_end - line));
+  output_putc(scan->out, '\n');
+}
+
+// Номер строки, начинающейся в line (line не раньше scan->counted).
+// Строки считаются только с -n: без номеров memchr по промежуткам не нужен.
+static size_t line_number_at(grep_scan_t *scan, const char *line,
+                             const char *line_end, const char *end) {
+  if (!scan->opts.line_number) return 0;
+  scan->line_num += count_newlines(scan->counted, line) + 1;
+  scan->counted = line_end < end ? line_end + 1 : end;
+  return scan->line_num;
+}
+
+// -o для совпавшей строки: выводит все непересекающиеся совпадения всех
+// шаблонов за один проход по строке. Строка засчитывается как совпавшая,
+// даже если все её совпадения пустые (как у GNU grep).
+static void print_only_matching(grep_scan_t *scan, const char *line,
+                                size_t len, size_t line_num) {
+  size_t start, end;
+  size_t offset = 0;
+  while (next_only_match(scan->compiled, &scan->cache, line, len, offset,
+                         &start, &end)) {
+    print_line_prefix(scan, line_num);
+    output_write(scan->out, line + start, end - start);
+    output_putc(scan->out, '\n');
+    offset = end;
+  }
+}
+
+// libs21grep: отдаёт совпадения строки так же, как их выводит -o
+static void report_line(grep_scan_t *scan, const char *line,
+                        const char *line_end, size_t line_num) {
+  size_t len = (size_t)(line_end - line);
+  s21grep_match_t match = {line, len, line_num,
+                           scan->base_offset + (uint64_t)(line - scan->base),
+                           0, len};
+  if (scan->opts.invert_match) {
+    scan->stopped = scan->on_match(scan->on_match_context, &match) != 0;
+    return;
+  }
+  int found = 0;
+  size_t offset = 0;
+  while (!scan->stopped &&
+         next_only_match(scan->compiled, &scan->cache, line, len, offset,
+                         &match.match_start, &match.match_end)) {
+    found = 1;
+    scan->stopped = scan->on_match(scan->on_match_context, &match) != 0;
+    offset = match.match_end;
+  }
+  if (!found) {
+    match.match_start = 0;
+    match.match_end = 0;
+    scan->stopped = scan->on_match(scan->on_match_context, &match) != 0;
+  }
+}
+
+int output_suppressed(const grep_options_t *opts) {
+  return opts->count_matches || opts->list_files || opts->quiet;
+}
+
+int scan_done(const grep_scan_t *scan) {
+  if (scan->stopped) return 1;
+  if ((scan->opts.list_files || scan->opts.quiet) && scan->match_count > 0) {
+    return 1;
+  }
+  return scan->opts.max_count >= 0 && scan->match_count >= scan->opts.max_count;
+}
+
+// Запоминает позицию, с которой можно продолжить поиск потоком, если
+// отображённый файл укоротят (SIGBUS): всё до pos уже выведено и посчитано
+static void mark_resume(grep_scan_t *scan, const char *pos) {
+  scan->resume = pos;
+  scan->resume_line_num = scan->line_num;
+  scan->resume_match_count = scan->match_count;
+  scan->resume_out_length = scan->out ? scan->out->length : 0;
+  scan->resume_out_flushes = scan->out ? scan->out->flushes : 0;
+}
+
+// Выводит несовпавшие строки [begin, end) для -v
+static void scan_inverted_gap(grep_scan_t *scan, const char *begin,
+                              const char *end) {
+  int silent = output_suppressed(&scan->opts) || scan->opts.only_matching;
+  while (begin < end && !scan_done(scan)) {
+    const char *line_end = memchr(begin, '\n', (size_t)(end - begin));
+    if (!line_end) line_end = end;
+    scan->match_count++;
+    if (!silent) {
+      size_t line_num = line_number_at(scan, begin, line_end, end);
+      if (scan->on_match) {
+        report_line(scan, begin, line_end, line_num);
+      } else {
+        print_line(scan, begin, line_end, line_num);
+      }
+      mark_resume(scan, line_end + 1);
+    }
+    begin = line_end + 1;
+  }
+}
+
+// -c без -o, -m, -l и -q: строки не выводятся и не нумеруются, поиск
+// только считает совпавшие строки
+static int count_only(const grep_options_t *opts) {
+  return opts->count_matches && !opts->only_matching && !opts->list_files &&
+         !opts->quiet && opts->max_count < 0;
+}
+
+// Считает строки блока [begin, end) для -c: после каждой совпавшей строки
+// поиск продолжается со следующей. Для -v ответ - число строк блока минус
+// совпавшие, сами несовпавшие строки не перебираются.
+static void count_block(grep_scan_t *scan, const char *begin,
+                        const char *end) {
+  match_cache_reset(&scan->cache);
+  size_t matched = 0;
+  const char *p = begin;
+  const char *line_end = NULL;
+  while (p < end &&
+         find_matching_line(scan->compiled, &scan->cache, p, end, &line_end)) {
+    matched++;
+    p = line_end + 1;
+  }
+
+  if (scan->opts.invert_match) {
+    // Последняя строка блока может быть без '\n' только в конце файла
+    size_t lines = count_newlines(begin, end) + (end[-1] != '\n');
+    matched = lines - matched;
+  }
+  scan->match_count += (int)matched;
+  mark_resume(scan, end);
+}
+
+// Обрабатывает блок целых строк [begin, end). Последняя строка блока может
+// не заканчиваться '\n' только в конце файла.
+static void scan_block(grep_scan_t *scan, const char *begin,
+                       const char *end) {
+  grep_options_t opts = scan->opts;
+  if (count_only(&opts)) {
+    count_block(scan, begin, end);
+    return;
+  }
+  int silent = output_suppressed(&opts);
+  match_cache_reset(&scan->cache);
+  scan->counted = begin;
+
+  const char *p = begin;
+  while (p < end) {
+    mark_resume(scan, p);
+    const char *line_end = NULL;
+    const char *line =
+        find_matching_line(scan->compiled, &scan->cache, p, end, &line_end);
+    if (opts.invert_match) {
+      scan_inverted_gap(scan, p, line ? line : end);
+      if (scan_done(scan)) return;
+      if (!line) break;
+      line_number_at(scan, line, line_end, end);
+    } else {
+      if (!line) break;
+      size_t line_num = line_number_at(scan, line, line_end, end);
+      scan->match_count++;
+      if (silent) {
+        // -c, -l, -q: строки не выводятся
+      } else if (scan->on_match) {
+        report_line(scan, line, line_end, line_num);
+      } else if (opts.only_matching) {
+        print_only_matching(scan, line, (size_t)(line_end - line), line_num);
+      } else {
+        print_line(scan, line, line_end, line_num);
+      }
+      if (scan_done(scan)) return;
+    }
+    p = line_end + 1;
+  }
+
+  if (opts.line_number && scan->counted < end) {
+    scan->line_num += count_newlines(scan->counted, end);
+  }
+  mark_resume(scan, end);
+}
+
+// Проверяет начало файла [data, data + length) на NUL и настраивает поиск
+// по --binary-files. Возвращает 1, если двоичный файл читать не нужно.
+static int check_binary(grep_scan_t *scan, const char *data, size_t length) {
+  scan->binary_checked = 1;
+  if (scan->opts.binary_files == BINARY_TEXT) return 0;
+  if (length > SCAN_BLOCK_SIZE) length = SCAN_BLOCK_SIZE;
+  if (!memchr(data, '\0', length)) return 0;
+  if (scan->opts.binary_files == BINARY_SKIP) return 1;
+  // Строки не выводятся, а для сообщения хватит первого совпадения
+  if (!output_suppressed(&scan->opts)) {
+    scan->binary = 1;
+    scan->opts.quiet = 1;
+  }
+  return 0;
+}
+
+// Читает файл блоками по SCAN_BLOCK_SIZE и отдаёт в scan_block() всё до
+// последнего '\n'; неполная строка переносится в начало следующего блока.
+// Возвращает 0 или errno ошибки чтения. После данных в буфере всегда есть
+// '\0': перехватчик regexec() в ASan читает строку до него даже с
+// REG_STARTEND.
+int scan_fd(grep_scan_t *scan, int fd) {
+  size_t capacity = SCAN_BLOCK_SIZE;
+  char *buffer = malloc(capacity + 1);
+  if (!buffer) return ENOMEM;
+
+  size_t filled = 0;
+  uint64_t offset = scan->base_offset;
+  int error = 0;
+  scan->base = buffer;
+  for (;;) {
+    if (filled == capacity) {
+      // Строка длиннее буфера: расширяем
+      char *grown = realloc(buffer, capacity * 2 + 1);
+      if (!grown) {
+        error = ENOMEM;
+        break;
+      }
+      buffer = grown;
+      capacity *= 2;
+      scan->base = buffer;
+    }
+    ssize_t got = read(fd, buffer + filled, capacity - filled);
+    if (got < 0) {
+      if (errno == EINTR) continue;
+      error = errno;
+      break;
+    }
+    if (!scan->binary_checked && got > 0 &&
+        check_binary(scan, buffer, (size_t)got)) {
+      break;
+    }
+    if (got == 0) {
+      buffer[filled] = '\0';
+      scan->base_offset = offset;
+      if (filled > 0) scan_block(scan, buffer, buffer + filled);
+      break;
+    }
+
+    const char *last_newline = memrchr(buffer + filled, '\n', (size_t)got);
+    filled += (size_t)got;
+    if (!last_newline) continue;
+    buffer[filled] = '\0';
+
+    size_t block_len = (size_t)(last_newline - buffer) + 1;
+    scan->base_offset = offset;
+    scan_block(scan, buffer, buffer + block_len);
+    if (scan_done(scan)) break;
+    memmove(buffer, buffer + block_len, filled - block_len);
+    filled -= block_len;
+    offset += block_len;
+  }
+
+  free(buffer);
+  return error;
+}
+
+// Ищет в [pos, end) окнами по MAP_WINDOW_SIZE, выровненными по строкам
+static void scan_windows(grep_scan_t *scan, const char *pos,
+                         const char *end) {
+  while (pos < end) {
+    mark_resume(scan, pos);
+    const char *window_end = end;
+    if ((size_t)(end - pos) > MAP_WINDOW_SIZE) {
+      window_end = memrchr(pos, '\n', MAP_WINDOW_SIZE);
+      if (!window_end) {
+        window_end = memchr(pos + MAP_WINDOW_SIZE, '\n',
+                            (size_t)(end - pos) - MAP_WINDOW_SIZE);
+      }
+      window_end = window_end ? window_end + 1 : end;
+    }
+    scan_block(scan, pos, window_end);
+    if (scan_done(scan)) break;
+    pos = window_end;
+  }
+}
+
+int scan_mapped_range(grep_scan_t *scan, const input_map_t *map,
+                      size_t begin, size_t end_offset, size_t *resume) {
+  sigjmp_buf env;
+  INPUT_ARM_FAULT(env);
+  if (sigsetjmp(env, 1) != 0) {
+    // Вывод строк после resume, ещё не записанный из буфера, отбрасывается:
+    // при дочитывании потоком они выводятся заново
+    *resume = (size_t)(scan->resume - map->data);
+    scan->line_num = scan->resume_line_num;
+    scan->match_count = scan->resume_match_count;
+    if (scan->out && output_rewindable(scan->out, scan->resume_out_flushes)) {
+      scan->out->length = scan->resume_out_length;
+    }
+    return 1;
+  }
+
+  scan->base = map->data;
+  scan->base_offset = 0;
+  scan_windows(scan, map->data + begin, map->data + end_offset);
+  INPUT_RELEASE_FAULT();
+  return 0;
+}
+
+void scan_buffer(grep_scan_t *scan, const char *data, size_t length) {
+  scan->base = data;
+  scan->base_offset = 0;
+  scan_windows(scan, data, data + length);
+}
+
+// check_binary() для отображённого файла: если его укоротили, проверка
+// повторится при чтении потоком
+static int check_binary_mapped(grep_scan_t *scan, const input_map_t *map) {
+  sigjmp_buf env;
+  int skip = 0;
+  INPUT_ARM_FAULT(env);
+  if (sigsetjmp(env, 1) == 0) {
+    skip = check_binary(scan, map->data, map->size);
+  }
+  INPUT_RELEASE_FAULT();
+  return skip;
+}
+
+// Конец новых целых строк отображённого файла после start и число строк
+// в них. Возвращает 1, если файл укоротили.
+static int locate_appended(const input_map_t *map, size_t start, size_t *stop,
+                           size_t *newlines) {
+  sigjmp_buf env;
+  INPUT_ARM_FAULT(env);
+  if (sigsetjmp(env, 1) != 0) return 1;
+  const char *last = memrchr(map->data + start, '\n', map->size - start);
+  *stop = last ? (size_t)(last - map->data) + 1 : start;
+  *newlines = count_newlines(map->data + start, map->data + *stop);
+  INPUT_RELEASE_FAULT();
+  return 0;
+}
+
+// --state-file: ищет только в целых строках, дописанных после сохранённого
+// смещения, и запоминает новое. Незаконченная последняя строка ждёт
+// следующего запуска; после -q, -l или -m все новые строки тоже считаются
+// просмотренными. Файл отображается даже при S21_MMAP=0: конец последней
+// целой строки находится с конца файла, без чтения всего дописанного.
+static int scan_appended(grep_scan_t *scan, int fd, const struct stat *st,
+                         state_table_t *state) {
+  uint64_t offset, lines;
+  state_lookup(state, scan->filename, fd, st, &offset, &lines);
+  if ((uint64_t)st->st_size > offset) {
+    input_map_t map;
+    errno = 0;
+    if (input_map(fd, INPUT_MMAP, &map) != 0) return errno ? errno : EIO;
+    size_t start = (size_t)offset;
+    size_t stop = start;
+    size_t newlines = 0;
+    size_t resume = 0;
+    int faulted =
+        map.size <= start || locate_appended(&map, start, &stop, &newlines);
+    if (!faulted && stop > start && !check_binary_mapped(scan, &map)) {
+      scan->line_num = lines;
+      faulted = scan_mapped_range(scan, &map, start, stop, &resume);
+    }
+    input_unmap(&map);
+    // Файл усекли: в следующий раз он просматривается с начала
+    offset = faulted ? 0 : stop;
+    lines = faulted ? 0 : lines + newlines;
+  }
+  return state_update(state, scan->filename, fd, st, offset, lines) ? ENOMEM
+                                                                   : 0;
+}
+
+int process_file(const char *filename, grep_options_t opts,
+                 const compiled_patterns_t *compiled, int multiple_files,
+                 output_t *out, output_t *err, int *error_occurred) {
+  int is_stdin = strcmp(filename, "-") == 0;
+  int fd = is_stdin ? STDIN_FILENO : open(filename, O_RDONLY);
+  if (fd < 0) {
+    if (!opts.suppress_errors) {
+      output_printf(err, "grep: %s: No such file or directory\n", filename);
+    }
+    *error_occurred = 1;
+    return 0;
+  }
+  int match_count = process_fd(filename, fd, opts, compiled, multiple_files,
+                               out, err, error_occurred);
+  if (!is_stdin) close(fd);
+  return match_count;
+}
+
+int process_fd(const char *filename, int fd, grep_options_t opts,
+               const compiled_patterns_t *compiled, int multiple_files,
+               output_t *out, output_t *err, int *error_occurred) {
+  int is_stdin = strcmp(filename, "-") == 0;
+  int fd_done = 0;
+  grep_scan_t scan = {0};
+  scan.filename = filename;
+  scan.filename_length = strlen(filename);
+  scan.opts = opts;
+  scan.compiled = compiled;
+  scan.multiple_files = multiple_files;
+  scan.out = out;
+  int error =
+      match_cache_init(&scan.cache, compiled, opts.thread) != 0 ? ENOMEM : 0;
+
+  struct stat st;
+  if (!error && opts.state && !is_stdin && fstat(fd, &st) == 0 &&
+      S_ISREG(st.st_mode)) {
+    error = scan_appended(&scan, fd, &st, opts.state);
+    fd_done = 1;
+  }
+  input_map_t map;
+  if (!error && !fd_done && !is_stdin &&
+      input_map(fd, opts.input_mode, &map) == 0) {
+    size_t resume = 0;
+    int faulted = 0;
+    // -I: двоичный файл пропускается после проверки первого блока
+    if (!check_binary_mapped(&scan, &map)) {
+      faulted = scan_mapped_parallel(&scan, &map, &resume);
+      if (faulted < 0) {
+        faulted = scan_mapped_range(&scan, &map, 0, map.size, &resume);
+      }
+    }
+    input_unmap(&map);
+    if (!faulted) {
+      fd_done = 1;
+    } else if (lseek(fd, (off_t)resume, SEEK_SET) < 0) {
+      error = errno;
+    }
+  }
+  if (!error && !fd_done) error = scan_fd(&scan, fd);
+  match_cache_free(&scan.cache);
+
+  if (error) {
+    if (!opts.suppress_errors) {
+      output_printf(err, "grep: %s: %s\n", filename, strerror(error));
+    }
+    *error_occurred = 1;
+  }
+
+  int match_count = scan.match_count;
+  if (opts.quiet) {
+    // -q: ничего не выводится
+  } else if (opts.count_matches) {
+    // ИСПРАВЛЕНИЕ: при множественных файлах всегда показывать имя файла для -c
+    // кроме случая когда явно указан -h
+    if (multiple_files && !opts.no_filename) {
+      output_printf(out, "%s:%d\n", filename, match_count);
+    } else {
+      output_printf(out, "%d\n", match_count);
+    }
+  } else if (opts.list_files && match_count > 0) {
+    output_printf(out, "%s\n", filename);
+  } else if (scan.binary && match_count > 0) {
+    output_printf(out, "Binary file %s matches\n",
+                  is_stdin ? "(standard input)" : filename);
+  }
+
+  return match_count;
+}
+
+double monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+int stats_enabled(void) {
+  const char *stats = getenv("S21_GREP_STATS");
+  return stats && strcmp(stats, "0") != 0;
+}
+
+// S21_GREP_STATS=1: выводит в stderr время компиляции шаблонов
+void print_compile_stats(int pattern_count, double compile_ms) {
+  if (stats_enabled()) {
+    fprintf(stderr, "grep: stats: %d patterns compiled in %.3f ms\n",
+            pattern_count, compile_ms);
+  }
+}
+
+// -r: ищет во всех файлах под каталогом root. Без операнда обходится "."
+// и пути выводятся без "./".
+static int grep_tree(const char *root, int implicit_root, grep_options_t opts,
+                     const compiled_patterns_t *compiled, output_t *out,
+                     output_t *err, int *error_occurred) {
+  walker_t walker;
+  int error = walk_open(&walker, root, opts.recursive == 2, &opts.filter,
+                        opts.suppress_errors);
+  if (error) {
+    if (!opts.suppress_errors) {
+      output_printf(err, "grep: %s: %s\n", root, strerror(error));
+    }
+    *error_occurred = 1;
+    walk_close(&walker);
+    return 0;
+  }
+  if (implicit_root) walker.prefix_skip = 2;
+
+  // --index: файлы без триграмм литерала не читаются. Для -v и -c нужны и
+  // несовпавшие файлы, там отбора нет.
+  grep_index_t index = {0};
+  int indexed = opts.use_index && !opts.invert_match &&
+                !opts.count_matches && index_open(&index, root) == 0;
+  if (indexed && index_select(&index, compiled) != 0) {
+    index_close(&index);
+    indexed = 0;
+  }
+  walker.accept = index_accept;
+  walker.accept_context = indexed ? &index : NULL;
+
+  int match_count = -1;
+  if (opts.jobs > 1) {
+    match_count = grep_tree_parallel(&walker, opts, compiled, out, err,
+                                     error_occurred);
+  }
+  if (match_count < 0) {
+    match_count = 0;
+    const char *path;
+    // -q: после первого совпадения обход не продолжается
+    while (!(opts.quiet && match_count) && (path = walk_next(&walker))) {
+      match_count += process_file(path, opts, compiled, 1, out, err,
+                                  error_occurred);
+    }
+  }
+  if (walker.error_occurred) *error_occurred = 1;
+  walk_close(&walker);
+  if (indexed && stats_enabled()) {
+    fprintf(stderr, "grep: stats: index %s: %zu files searched, %zu skipped\n",
+            root, index.searched, index.skipped);
+  }
+  if (indexed) index_close(&index);
+  return match_count;
+}
+
+int is_directory(const char *path) {
+  struct stat st;
+  return strcmp(path, "-") != 0 && stat(path, &st) == 0 &&
+         S_ISDIR(st.st_mode);
+}
+
+int grep_recursive(char **files, int file_count, int multiple_files,
+                   grep_options_t opts, const compiled_patterns_t *compiled,
+                   output_t *out, output_t *err, int *error_occurred) {
+  if (file_count == 0) {
+    return grep_tree(".", 1, opts, compiled, out, err, error_occurred);
+  }
+  int match_count = 0;
+  for (int i = 0; i < file_count && !(opts.quiet && match_count); i++) {
+    if (is_directory(files[i])) {
+      match_count +=
+          grep_tree(files[i], 0, opts, compiled, out, err, error_occurred);
+    } else if (walk_file_selected(&opts.filter, files[i])) {
+      match_count += process_file(files[i], opts, compiled, multiple_files,
+                                  out, err, error_occurred);
+    }
+  }
+  return match_count;
+}
@@ -0,0 +1,261 @@
+#include "s21_grep_state.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static uint64_t hash_path(const char *path) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+    hash = (hash ^ *p) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const unsigned char *data,
+                           size_t size) {
+  for (size_t i = 0; i < size; i++) hash = (hash ^ data[i]) * 1099511628211ULL;
+  return hash;
+}
+
+// Хеш первых STATE_FINGERPRINT_BYTES байтов файла и стольких же перед
+// offset. Возвращает 1, если их не прочитать.
+static int fingerprint(int fd, uint64_t offset, uint64_t *result) {
+  unsigned char block[STATE_FINGERPRINT_BYTES];
+  size_t size = offset < STATE_FINGERPRINT_BYTES ? (size_t)offset
+                                                 : STATE_FINGERPRINT_BYTES;
+  uint64_t hash = 14695981039346656037ULL;
+  if (pread(fd, block, size, 0) != (ssize_t)size) return 1;
+  hash = hash_bytes(hash, block, size);
+  if (pread(fd, block, size, (off_t)(offset - size)) != (ssize_t)size) {
+    return 1;
+  }
+  *result = hash_bytes(hash, block, size);
+  return 0;
+}
+
+static uint64_t hash_inode(uint64_t dev, uint64_t ino) {
+  uint64_t hash = (dev * 0x9E3779B97F4A7C15ULL) ^ ino;
+  return hash ^ (hash >> 29);
+}
+
+static size_t *path_slot(const state_table_t *state, const char *path) {
+  size_t mask = state->slots - 1;
+  for (size_t i = hash_path(path) & mask;; i = (i + 1) & mask) {
+    size_t entry = state->by_path[i];
+    if (!entry || strcmp(state->entries[entry - 1].path, path) == 0) {
+      return &state->by_path[i];
+    }
+  }
+}
+
+static size_t *inode_slot(const state_table_t *state, uint64_t dev,
+                          uint64_t ino) {
+  size_t mask = state->slots - 1;
+  for (size_t i = hash_inode(dev, ino) & mask;; i = (i + 1) & mask) {
+    size_t entry = state->by_inode[i];
+    if (!entry) return &state->by_inode[i];
+    const state_position_t *saved = &state->entries[entry - 1].saved;
+    if (saved->dev == dev && saved->ino == ino) return &state->by_inode[i];
+  }
+}
+
+// Перестраивает таблицы поиска, если они заполнены больше чем наполовину
+static int reserve_slots(state_table_t *state) {
+  if ((state->count + 1) * 2 <= state->slots) return 0;
+  size_t slots = state->slots ? state->slots * 2 : 64;
+  size_t *by_path = calloc(slots, sizeof(size_t));
+  size_t *by_inode = calloc(slots, sizeof(size_t));
+  if (!by_path || !by_inode) {
+    free(by_path);
+    free(by_inode);
+    return 1;
+  }
+  free(state->by_path);
+  free(state->by_inode);
+  state->by_path = by_path;
+  state->by_inode = by_inode;
+  state->slots = slots;
+  for (size_t i = 0; i < state->count; i++) {
+    const state_entry_t *entry = &state->entries[i];
+    *path_slot(state, entry->path) = i + 1;
+    if (entry->has_saved) {
+      size_t *slot = inode_slot(state, entry->saved.dev, entry->saved.ino);
+      if (!*slot) *slot = i + 1;
+    }
+  }
+  return 0;
+}
+
+// Запись пути path; новая добавляется. NULL - нет памяти.
+static state_entry_t *find_or_add(state_table_t *state, const char *path) {
+  size_t *slot = state->slots ? path_slot(state, path) : NULL;
+  if (slot && *slot) return &state->entries[*slot - 1];
+  if (reserve_slots(state) != 0) return NULL;
+  if (state->count == state->capacity) {
+    size_t capacity = state->capacity ? state->capacity * 2 : 64;
+    state_entry_t *grown =
+        realloc(state->entries, sizeof(state_entry_t) * capacity);
+    if (!grown) return NULL;
+    state->entries = grown;
+    state->capacity = capacity;
+  }
+  state_entry_t *entry = &state->entries[state->count];
+  memset(entry, 0, sizeof(*entry));
+  if (!(entry->path = strdup(path))) return NULL;
+  *path_slot(state, path) = ++state->count;
+  return entry;
+}
+
+void state_init(state_table_t *state) {
+  memset(state, 0, sizeof(*state));
+  pthread_mutex_init(&state->lock, NULL);
+}
+
+int state_load(state_table_t *state, const char *path) {
+  state_init(state);
+  state->path = path;
+  FILE *stream = fopen(path, "r");
+  if (!stream) return errno == ENOENT ? 0 : errno;
+
+  char *line = NULL;
+  size_t size = 0;
+  ssize_t length = getline(&line, &size, stream);
+  // Чужой файл не перезаписывается
+  int error = length < 0 || strcmp(line, STATE_HEADER) != 0 ? EINVAL : 0;
+  while (!error && (length = getline(&line, &size, stream)) > 0) {
+    if (line[length - 1] == '\n') line[length - 1] = '\0';
+    state_position_t saved = {0};
+    int path_start = 0;
+    int fields = sscanf(line,
+                        "%" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64
+                        " %" SCNx64 " %n",
+                        &saved.dev, &saved.ino, &saved.offset, &saved.lines,
+                        &saved.fingerprint, &path_start);
+    if (fields != 5 || path_start == 0 || line[path_start] == '\0') {
+      continue;  // Повреждённая строка: файл будет просмотрен заново
+    }
+    state_entry_t *entry = find_or_add(state, line + path_start);
+    if (!entry) {
+      error = ENOMEM;
+      break;
+    }
+    entry->saved = saved;
+    entry->has_saved = 1;
+    size_t *slot = inode_slot(state, saved.dev, saved.ino);
+    if (!*slot) *slot = (size_t)(entry - state->entries) + 1;
+  }
+  free(line);
+  fclose(stream);
+  return error;
+}
+
+int state_lookup(state_table_t *state, const char *path, int fd,
+                 const struct stat *st, uint64_t *offset, uint64_t *lines) {
+  uint64_t dev = (uint64_t)st->st_dev;
+  uint64_t ino = (uint64_t)st->st_ino;
+  state_position_t found = {0};
+  int has_found = 0;
+  pthread_mutex_lock(&state->lock);
+  if (state->slots) {
+    size_t entry = *path_slot(state, path);
+    if (entry && state->entries[entry - 1].has_saved &&
+        state->entries[entry - 1].saved.dev == dev &&
+        state->entries[entry - 1].saved.ino == ino) {
+      found = state->entries[entry - 1].saved;
+      has_found = 1;
+    } else if ((entry = *inode_slot(state, dev, ino)) != 0) {
+      found = state->entries[entry - 1].saved;
+      has_found = 1;
+    }
+  }
+  pthread_mutex_unlock(&state->lock);
+  // Отпечаток читается из файла уже без блокировки
+  uint64_t current;
+  int same = has_found && found.offset <= (uint64_t)st->st_size &&
+             fingerprint(fd, found.offset, &current) == 0 &&
+             current == found.fingerprint;
+  *offset = same ? found.offset : 0;
+  *lines = same ? found.lines : 0;
+  return has_found;
+}
+
+int state_update(state_table_t *state, const char *path, int fd,
+                 const struct stat *st, uint64_t offset, uint64_t lines) {
+  // Путь с '\n' не записать в строку файла состояния
+  if (strchr(path, '\n')) return 0;
+  // Без отпечатка файл в следующий раз просматривается с начала
+  uint64_t print = 0;
+  if (fingerprint(fd, offset, &print) != 0) offset = lines = 0;
+  pthread_mutex_lock(&state->lock);
+  state_entry_t *entry = find_or_add(state, path);
+  if (entry) {
+    entry->current.dev = (uint64_t)st->st_dev;
+    entry->current.ino = (uint64_t)st->st_ino;
+    entry->current.offset = offset;
+    entry->current.lines = lines;
+    entry->current.fingerprint = print;
+    entry->has_current = 1;
+  }
+  pthread_mutex_unlock(&state->lock);
+  return entry == NULL;
+}
+
+void state_commit(state_table_t *state) {
+  pthread_mutex_lock(&state->lock);
+  if (state->slots) memset(state->by_inode, 0, sizeof(size_t) * state->slots);
+  for (size_t i = 0; i < state->count; i++) {
+    state_entry_t *entry = &state->entries[i];
+    if (entry->has_current) {
+      entry->saved = entry->current;
+      entry->has_saved = 1;
+    }
+    if (entry->has_saved) {
+      size_t *slot = inode_slot(state, entry->saved.dev, entry->saved.ino);
+      if (!*slot) *slot = i + 1;
+    }
+  }
+  pthread_mutex_unlock(&state->lock);
+}
+
+int state_save(state_table_t *state) {
+  size_t length = strlen(state->path);
+  char *temporary = malloc(length + 5);
+  if (!temporary) return ENOMEM;
+  memcpy(temporary, state->path, length);
+  memcpy(temporary + length, ".tmp", 5);
+
+  FILE *stream = fopen(temporary, "w");
+  int error = stream ? 0 : errno;
+  if (stream && fputs(STATE_HEADER, stream) == EOF) error = errno;
+  for (size_t i = 0; i < state->count && !error; i++) {
+    const state_entry_t *entry = &state->entries[i];
+    if (!entry->has_current && access(entry->path, F_OK) != 0) continue;
+    const state_position_t *position =
+        entry->has_current ? &entry->current : &entry->saved;
+    if (fprintf(stream,
+                "%" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIx64
+                " %s\n",
+                position->dev, position->ino, position->offset,
+                position->lines, position->fingerprint, entry->path) < 0) {
+      error = errno;
+    }
+  }
+  if (stream && fclose(stream) != 0 && !error) error = errno;
+  if (!error && rename(temporary, state->path) != 0) error = errno;
+  if (error && stream) unlink(temporary);
+  free(temporary);
+  return error;
+}
+
+void state_free(state_table_t *state) {
+  for (size_t i = 0; i < state->count; i++) free(state->entries[i].path);
+  free(state->entries);
+  free(state->by_path);
+  free(state->by_inode);
+  pthread_mutex_destroy(&state->lock);
+  memset(state, 0, sizeof(*state));
+}
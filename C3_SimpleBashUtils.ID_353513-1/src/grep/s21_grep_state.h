@@ -0,0 +1,72 @@
+#ifndef S21_GREP_STATE_H
+#define S21_GREP_STATE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+// Первая строка файла состояния; дальше по строке на файл:
+// "<dev> <inode> <смещение> <строк до смещения> <отпечаток> <путь>"
+#define STATE_HEADER "# s21_grep state 1\n"
+// Отпечаток - хеш первых байтов файла и байтов перед смещением
+#define STATE_FINGERPRINT_BYTES 256
+
+// Докуда просмотрен файл
+typedef struct {
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t offset;       // Конец последней просмотренной целой строки
+  uint64_t lines;        // Строк до offset (для -n)
+  uint64_t fingerprint;  // Содержимое до offset: тот же ли это текст
+} state_position_t;
+
+typedef struct {
+  char *path;
+  state_position_t saved;    // Из файла состояния
+  state_position_t current;  // После поиска в этом запуске
+  int has_saved;
+  int has_current;
+} state_entry_t;
+
+// --state-file: состояние всех файлов, общее для потоков поиска. Поиск
+// идёт по сохранённым значениям, новые значения пишутся отдельно: файл,
+// переименованный при ротации, находится по старому inode, даже если под
+// его прежним именем уже искали новый файл.
+typedef struct {
+  const char *path;
+  state_entry_t *entries;
+  size_t count;
+  size_t capacity;
+  size_t *by_path;   // Открытая адресация: номер записи + 1 или 0
+  size_t *by_inode;  // По сохранённым dev и inode
+  size_t slots;      // Размер обеих таблиц (степень двойки)
+  pthread_mutex_t lock;
+} state_table_t;
+
+// Пустое состояние только в памяти (--follow без --state-file)
+void state_init(state_table_t *state);
+// Читает файл состояния; если его ещё нет, состояние пустое. Возвращает 0
+// или errno (EINVAL, если это не файл состояния).
+int state_load(state_table_t *state, const char *path);
+// С какого места продолжить файл path (открыт как fd): с сохранённого для
+// этого пути, если это тот же файл (dev и inode), иначе с сохранённого для
+// того же файла под старым именем, иначе с начала. Если файл стал короче
+// смещения или отпечаток не совпал (файл усекли и дописали заново, inode
+// достался новому файлу), тоже с начала. Возвращает 1, если позиция
+// найдена в состоянии.
+int state_lookup(state_table_t *state, const char *path, int fd,
+                 const struct stat *st, uint64_t *offset, uint64_t *lines);
+// Запоминает, что path (открыт как fd) просмотрен до offset, вместе с
+// отпечатком. Возвращает 0 или 1 при нехватке памяти.
+int state_update(state_table_t *state, const char *path, int fd,
+                 const struct stat *st, uint64_t offset, uint64_t lines);
+// Делает новые значения сохранёнными: --follow продолжает каждый файл с
+// места, где закончился предыдущий поиск в нём
+void state_commit(state_table_t *state);
+// Атомарно перезаписывает файл состояния. Записи удалённых файлов, в
+// которых в этот раз не искали, не сохраняются. Возвращает 0 или errno.
+int state_save(state_table_t *state);
+void state_free(state_table_t *state);
+
+#endif
@@ -0,0 +1,465 @@
+#include "s21_grep_walk.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Что сделано с подкаталогом, отданным потокам чтения
+#define AHEAD_QUEUED 0   // Ждёт в очереди
+#define AHEAD_READING 1  // Читается
+#define AHEAD_DONE 2     // Прочитан или не открылся (fd == -1)
+
+// Подкаталог, который поток чтения открывает и читает впрок. Ошибки не
+// сохраняются: не прочитанный впрок каталог обход откроет сам и сам о них
+// сообщит.
+struct walk_ahead {
+  size_t offset;  // Запись в dents родительского уровня
+  int depth;      // Глубина родительского уровня
+  int parent_fd;
+  char name[NAME_MAX + 1];
+  int state;  // AHEAD_*, меняется под lock
+  int fd;
+  struct stat st;
+  char *dents;  // Первая порция записей
+  size_t dents_length;
+  walk_ahead_t *prev;  // Очередь потоков чтения
+  walk_ahead_t *next;
+  walk_ahead_t *level_next;  // Следующий подкаталог того же уровня
+};
+
+struct walk_readers {
+  pthread_t *threads;
+  int thread_count;
+  int open_flags;
+  int stop;
+  int outstanding;  // Отданных и ещё не забранных каталогов (поток обхода)
+  // Сначала идут каталоги, до которых обход дойдёт раньше: глубокие
+  // уровни впереди, внутри уровня - по порядку записей
+  walk_ahead_t *queue;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;  // Очередь пополнилась или пора выходить
+  pthread_cond_t done;  // Какой-то каталог прочитан
+};
+
+static int matches_any(char *const *globs, int count, const char *name) {
+  for (int i = 0; i < count; i++) {
+    if (fnmatch(globs[i], name, 0) == 0) return 1;
+  }
+  return 0;
+}
+
+int walk_file_selected(const walk_filter_t *filter, const char *name) {
+  const char *slash = strrchr(name, '/');
+  const char *base = slash && slash[1] ? slash + 1 : name;
+  if (filter->include_count &&
+      !matches_any(filter->include, filter->include_count, base)) {
+    return 0;
+  }
+  return !matches_any(filter->exclude, filter->exclude_count, base);
+}
+
+static void walk_error(walker_t *walker, const char *path, int error) {
+  if (!walker->suppress_errors) {
+    // Сам корень "." выводится как есть
+    if (strlen(path) > walker->prefix_skip) path += walker->prefix_skip;
+    fprintf(stderr, "grep: %s: %s\n", path, strerror(error));
+  }
+  walker->error_occurred = 1;
+}
+
+// Дописывает к пути каталога длины length имя записи
+static int set_path(walker_t *walker, size_t length, const char *name) {
+  size_t name_length = strlen(name);
+  int slash = length > 0 && walker->path[length - 1] != '/';
+  size_t needed = length + (size_t)slash + name_length + 1;
+  if (needed > walker->path_capacity) {
+    size_t capacity = walker->path_capacity * 2;
+    if (capacity < needed) capacity = needed;
+    char *grown = realloc(walker->path, capacity);
+    if (!grown) return ENOMEM;
+    walker->path = grown;
+    walker->path_capacity = capacity;
+  }
+  if (slash) walker->path[length++] = '/';
+  memcpy(walker->path + length, name, name_length + 1);
+  return 0;
+}
+
+static int dir_open_flags(const walker_t *walker) {
+  int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+  return walker->follow_links ? flags : flags | O_NOFOLLOW;
+}
+
+static void free_ahead(walk_ahead_t *ahead) {
+  if (!ahead) return;
+  if (ahead->fd >= 0) close(ahead->fd);
+  free(ahead->dents);
+  free(ahead);
+}
+
+static void unlink_queued(walk_readers_t *readers, walk_ahead_t *ahead) {
+  if (ahead->prev) {
+    ahead->prev->next = ahead->next;
+  } else {
+    readers->queue = ahead->next;
+  }
+  if (ahead->next) ahead->next->prev = ahead->prev;
+}
+
+static void read_ahead(int open_flags, walk_ahead_t *ahead) {
+  ahead->fd = openat(ahead->parent_fd, ahead->name, open_flags);
+  if (ahead->fd < 0) return;
+  ssize_t got = -1;
+  if (fstat(ahead->fd, &ahead->st) == 0 &&
+      (ahead->dents = malloc(WALK_DENTS_SIZE)) != NULL) {
+    got = getdents64(ahead->fd, ahead->dents, WALK_DENTS_SIZE);
+  }
+  if (got < 0) {
+    close(ahead->fd);
+    ahead->fd = -1;
+  } else {
+    ahead->dents_length = (size_t)got;
+  }
+}
+
+static void *reader_thread(void *arg) {
+  walk_readers_t *readers = arg;
+  pthread_mutex_lock(&readers->lock);
+  for (;;) {
+    while (!readers->stop && !readers->queue) {
+      pthread_cond_wait(&readers->wake, &readers->lock);
+    }
+    if (readers->stop) break;
+    walk_ahead_t *ahead = readers->queue;
+    unlink_queued(readers, ahead);
+    ahead->state = AHEAD_READING;
+    pthread_mutex_unlock(&readers->lock);
+    read_ahead(readers->open_flags, ahead);
+    pthread_mutex_lock(&readers->lock);
+    ahead->state = AHEAD_DONE;
+    pthread_cond_broadcast(&readers->done);
+  }
+  pthread_mutex_unlock(&readers->lock);
+  return NULL;
+}
+
+int walk_start_readers(walker_t *walker, int count) {
+  walk_readers_t *readers = calloc(1, sizeof(walk_readers_t));
+  if (!readers) return ENOMEM;
+  readers->threads = malloc(sizeof(pthread_t) * (size_t)count);
+  if (!readers->threads) {
+    free(readers);
+    return ENOMEM;
+  }
+  readers->open_flags = dir_open_flags(walker);
+  pthread_mutex_init(&readers->lock, NULL);
+  pthread_cond_init(&readers->wake, NULL);
+  pthread_cond_init(&readers->done, NULL);
+  int error = 0;
+  while (readers->thread_count < count && !error) {
+    error = pthread_create(&readers->threads[readers->thread_count], NULL,
+                           reader_thread, readers);
+    if (!error) readers->thread_count++;
+  }
+  if (readers->thread_count == 0) {
+    pthread_cond_destroy(&readers->done);
+    pthread_cond_destroy(&readers->wake);
+    pthread_mutex_destroy(&readers->lock);
+    free(readers->threads);
+    free(readers);
+    return error;
+  }
+  walker->readers = readers;
+  return 0;
+}
+
+static void stop_readers(walk_readers_t *readers) {
+  pthread_mutex_lock(&readers->lock);
+  readers->stop = 1;
+  pthread_cond_broadcast(&readers->wake);
+  pthread_mutex_unlock(&readers->lock);
+  for (int i = 0; i < readers->thread_count; i++) {
+    pthread_join(readers->threads[i], NULL);
+  }
+  pthread_cond_destroy(&readers->done);
+  pthread_cond_destroy(&readers->wake);
+  pthread_mutex_destroy(&readers->lock);
+  free(readers->threads);
+  free(readers);
+}
+
+// Забирает у потоков чтения подкаталог записи offset уровня: прочитанный
+// впрок или NULL, если обходу нужно открыть его самому. Подкаталоги
+// пропущенных записей освобождаются; offset SIZE_MAX освобождает все.
+static walk_ahead_t *take_ahead(walker_t *walker, walk_level_t *level,
+                                size_t offset) {
+  walk_readers_t *readers = walker->readers;
+  while (level->ahead && level->ahead->offset <= offset) {
+    walk_ahead_t *ahead = level->ahead;
+    level->ahead = ahead->level_next;
+    if (!level->ahead) level->ahead_last = NULL;
+    readers->outstanding--;
+    pthread_mutex_lock(&readers->lock);
+    if (ahead->state == AHEAD_QUEUED) unlink_queued(readers, ahead);
+    while (ahead->state == AHEAD_READING) {
+      pthread_cond_wait(&readers->done, &readers->lock);
+    }
+    pthread_mutex_unlock(&readers->lock);
+    if (ahead->offset == offset && ahead->fd >= 0) return ahead;
+    free_ahead(ahead);
+  }
+  return NULL;
+}
+
+// Отдаёт потокам чтения подкаталоги из ещё не просмотренных записей dents
+// уровня depth, пока их не станет WALK_AHEAD_DIRS. Ссылки при -R и записи
+// без типа обход разбирает сам.
+static void queue_ahead(walker_t *walker, int depth) {
+  walk_readers_t *readers = walker->readers;
+  walk_level_t *level = &walker->levels[depth];
+  if (level->ahead_pos < level->dents_pos) level->ahead_pos = level->dents_pos;
+  walk_ahead_t *first = NULL;
+  walk_ahead_t *last = NULL;
+  while (level->ahead_pos < level->dents_length &&
+         readers->outstanding < WALK_AHEAD_DIRS) {
+    const struct dirent64 *entry =
+        (const struct dirent64 *)(level->dents + level->ahead_pos);
+    size_t offset = level->ahead_pos;
+    const char *name = entry->d_name;
+    if (entry->d_type != DT_DIR || strcmp(name, ".") == 0 ||
+        strcmp(name, "..") == 0 ||
+        matches_any(walker->filter->exclude_dir,
+                    walker->filter->exclude_dir_count, name)) {
+      level->ahead_pos += entry->d_reclen;
+      continue;
+    }
+    walk_ahead_t *ahead = calloc(1, sizeof(walk_ahead_t));
+    if (!ahead) break;
+    level->ahead_pos += entry->d_reclen;
+    ahead->offset = offset;
+    ahead->depth = depth;
+    ahead->parent_fd = level->fd;
+    ahead->fd = -1;
+    snprintf(ahead->name, sizeof(ahead->name), "%s", name);
+    if (last) {
+      last->level_next = ahead;
+      ahead->prev = last;
+      last->next = ahead;
+    } else {
+      first = ahead;
+    }
+    last = ahead;
+    readers->outstanding++;
+  }
+  if (!first) return;
+  if (level->ahead_last) {
+    level->ahead_last->level_next = first;
+  } else {
+    level->ahead = first;
+  }
+  level->ahead_last = last;
+
+  pthread_mutex_lock(&readers->lock);
+  walk_ahead_t *before = readers->queue;
+  walk_ahead_t *after = NULL;
+  while (before && before->depth >= depth) {
+    after = before;
+    before = before->next;
+  }
+  first->prev = after;
+  last->next = before;
+  if (after) {
+    after->next = first;
+  } else {
+    readers->queue = first;
+  }
+  if (before) before->prev = last;
+  pthread_cond_broadcast(&readers->wake);
+  pthread_mutex_unlock(&readers->lock);
+}
+
+// Открывает каталог fd уровнем обхода; ahead - тот же каталог, прочитанный
+// впрок, или NULL. Путь каталога уже в walker->path.
+static int push_level(walker_t *walker, int fd, walk_ahead_t *ahead) {
+  struct stat st;
+  if (ahead) {
+    st = ahead->st;
+  } else if (fstat(fd, &st) != 0) {
+    int error = errno;
+    close(fd);
+    return error;
+  }
+  // -R: каталог, уже открытый выше на пути, дал бы бесконечный обход
+  for (int i = 0; walker->follow_links && i < walker->depth; i++) {
+    if (walker->levels[i].dev == st.st_dev &&
+        walker->levels[i].ino == st.st_ino) {
+      if (!walker->suppress_errors) {
+        fprintf(stderr, "grep: %s: warning: recursive directory loop\n",
+                walker->path + walker->prefix_skip);
+      }
+      close(fd);
+      return 0;
+    }
+  }
+  if (walker->depth == walker->capacity) {
+    int capacity = walker->capacity ? walker->capacity * 2 : 16;
+    walk_level_t *grown =
+        realloc(walker->levels, sizeof(walk_level_t) * (size_t)capacity);
+    if (!grown) {
+      close(fd);
+      return ENOMEM;
+    }
+    // Буферы записей выделяются при первом заходе на уровень и остаются
+    // для следующих каталогов той же глубины
+    for (int i = walker->capacity; i < capacity; i++) {
+      grown[i].dents = NULL;
+      grown[i].ahead = NULL;
+    }
+    walker->levels = grown;
+    walker->capacity = capacity;
+  }
+  walk_level_t *level = &walker->levels[walker->depth];
+  level->dents_pos = 0;
+  level->dents_length = 0;
+  if (ahead && ahead->dents) {
+    // Буфер с прочитанными записями переходит к уровню
+    char *dents = level->dents;
+    level->dents = ahead->dents;
+    ahead->dents = dents;
+    level->dents_length = ahead->dents_length;
+  }
+  if (!level->dents && !(level->dents = malloc(WALK_DENTS_SIZE))) {
+    close(fd);
+    return ENOMEM;
+  }
+  level->fd = fd;
+  level->dev = st.st_dev;
+  level->ino = st.st_ino;
+  level->path_length = strlen(walker->path);
+  level->ahead = NULL;
+  level->ahead_last = NULL;
+  level->ahead_pos = 0;
+  walker->depth++;
+  return 0;
+}
+
+int walk_open(walker_t *walker, const char *root, int follow_links,
+              const walk_filter_t *filter, int suppress_errors) {
+  memset(walker, 0, sizeof(*walker));
+  walker->follow_links = follow_links;
+  walker->filter = filter;
+  walker->suppress_errors = suppress_errors;
+  if (set_path(walker, 0, root) != 0) return ENOMEM;
+  // Каталог из командной строки открывается и по ссылке, как у GNU grep -r
+  int fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) return errno;
+  return push_level(walker, fd, NULL);
+}
+
+// Тип записи; по ссылке (при -R) и там, где getdents64() его не сообщает,
+// - через fstatat()
+static int entry_type(walker_t *walker, int dir_fd,
+                      const struct dirent64 *entry) {
+  int type = entry->d_type;
+  if (type != DT_UNKNOWN && !(type == DT_LNK && walker->follow_links)) {
+    return type;
+  }
+  struct stat st;
+  int flags = walker->follow_links ? 0 : AT_SYMLINK_NOFOLLOW;
+  if (fstatat(dir_fd, entry->d_name, &st, flags) != 0) {
+    walk_error(walker, walker->path, errno);
+    return DT_UNKNOWN;
+  }
+  if (S_ISDIR(st.st_mode)) return DT_DIR;
+  if (S_ISREG(st.st_mode)) return DT_REG;
+  return S_ISLNK(st.st_mode) ? DT_LNK : DT_UNKNOWN;
+}
+
+const char *walk_relative_path(const walker_t *walker) {
+  const char *relative = walker->path + walker->levels[0].path_length;
+  return *relative == '/' ? relative + 1 : relative;
+}
+
+const char *walk_next(walker_t *walker) {
+  while (walker->depth > 0) {
+    walk_level_t *level = &walker->levels[walker->depth - 1];
+    if (level->dents_pos >= level->dents_length) {
+      // Родительский каталог остаётся открытым, пока его подкаталоги
+      // читаются впрок
+      if (walker->readers) take_ahead(walker, level, SIZE_MAX);
+      ssize_t got = getdents64(level->fd, level->dents, WALK_DENTS_SIZE);
+      if (got < 0) {
+        walker->path[level->path_length] = '\0';
+        walk_error(walker, walker->path, errno);
+      }
+      if (got <= 0) {
+        close(level->fd);
+        walker->depth--;
+        continue;
+      }
+      level->dents_pos = 0;
+      level->dents_length = (size_t)got;
+      level->ahead_pos = 0;
+    }
+    if (walker->readers) queue_ahead(walker, walker->depth - 1);
+
+    const struct dirent64 *entry =
+        (const struct dirent64 *)(level->dents + level->dents_pos);
+    size_t offset = level->dents_pos;
+    level->dents_pos += entry->d_reclen;
+    const char *name = entry->d_name;
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+    int error = set_path(walker, level->path_length, name);
+    if (error) {
+      walk_error(walker, walker->path, error);
+      continue;
+    }
+
+    // Символические ссылки без -R, устройства, каналы и сокеты пропускаются
+    int type = entry_type(walker, level->fd, entry);
+    if (type == DT_DIR) {
+      const walk_filter_t *filter = walker->filter;
+      if (matches_any(filter->exclude_dir, filter->exclude_dir_count, name)) {
+        continue;
+      }
+      walk_ahead_t *ahead =
+          walker->readers ? take_ahead(walker, level, offset) : NULL;
+      int fd = ahead ? ahead->fd
+                     : openat(level->fd, name, dir_open_flags(walker));
+      if (ahead) ahead->fd = -1;
+      error = fd < 0 ? errno : push_level(walker, fd, ahead);
+      free_ahead(ahead);
+      if (error) walk_error(walker, walker->path, error);
+    } else if (type == DT_REG && walk_file_selected(walker->filter, name) &&
+               (!walker->accept ||
+                walker->accept(walker->accept_context, walker))) {
+      return walker->path + walker->prefix_skip;
+    }
+  }
+  return NULL;
+}
+
+void walk_close(walker_t *walker) {
+  if (walker->readers) stop_readers(walker->readers);
+  for (int i = 0; i < walker->depth; i++) {
+    while (walker->levels[i].ahead) {
+      walk_ahead_t *ahead = walker->levels[i].ahead;
+      walker->levels[i].ahead = ahead->level_next;
+      free_ahead(ahead);
+    }
+    close(walker->levels[i].fd);
+  }
+  for (int i = 0; i < walker->capacity; i++) free(walker->levels[i].dents);
+  free(walker->levels);
+  free(walker->path);
+  memset(walker, 0, sizeof(*walker));
+}
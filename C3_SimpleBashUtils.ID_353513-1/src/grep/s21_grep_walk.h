@@ -0,0 +1,87 @@
+#ifndef S21_GREP_WALK_H
+#define S21_GREP_WALK_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Буфер getdents64() на один уровень обхода: каталог с миллионами записей
+// читается порциями, а не целиком
+#define WALK_DENTS_SIZE (32 * 1024)
+// Столько путей ищется одной партией при -r -j: обход следующей партии идёт
+// параллельно с поиском по текущей
+#define WALK_BATCH_FILES 1024
+// Сколько подкаталогов могут быть открыты и прочитаны потоками чтения
+// впрок: каждый держит дескриптор и порцию записей WALK_DENTS_SIZE
+#define WALK_AHEAD_DIRS 64
+
+// Фильтры -r по имени файла (--include, --exclude) и каталога
+// (--exclude-dir); шаблоны fnmatch() сравниваются с последним компонентом
+typedef struct {
+  char **include;
+  int include_count;
+  char **exclude;
+  int exclude_count;
+  char **exclude_dir;
+  int exclude_dir_count;
+} walk_filter_t;
+
+typedef struct walk_ahead walk_ahead_t;
+typedef struct walk_readers walk_readers_t;
+
+// Открытый каталог на пути обхода
+typedef struct {
+  int fd;
+  dev_t dev;           // Для поиска циклов по ссылкам при -R
+  ino_t ino;
+  size_t path_length;  // Длина пути каталога в walker_t.path
+  char *dents;         // Прочитанные, но ещё не разобранные записи
+  size_t dents_pos;
+  size_t dents_length;
+  // Подкаталоги из dents, отданные потокам чтения, по порядку записей, и
+  // докуда dents просмотрен в поиске таких подкаталогов
+  walk_ahead_t *ahead;
+  walk_ahead_t *ahead_last;
+  size_t ahead_pos;
+} walk_level_t;
+
+// Обход дерева в глубину в порядке записей каталога (как у GNU grep): в
+// памяти только открытые каталоги текущего пути, по одному на уровень, и
+// не больше WALK_AHEAD_DIRS каталогов, прочитанных впрок
+typedef struct walker walker_t;
+struct walker {
+  walk_level_t *levels;
+  int depth;
+  int capacity;
+  char *path;  // Путь текущего файла
+  size_t path_capacity;
+  size_t prefix_skip;  // Сколько байт пути не выводить ("./" без операнда)
+  int follow_links;    // -R: переходить по символическим ссылкам
+  const walk_filter_t *filter;
+  int suppress_errors;
+  int error_occurred;
+  // Дополнительный отбор файлов (например, по индексу) или NULL: 0 -
+  // пропустить текущий файл
+  int (*accept)(void *context, const walker_t *walker);
+  void *accept_context;
+  walk_readers_t *readers;  // Потоки чтения каталогов впрок или NULL
+};
+
+// Подходит ли имя файла под --include/--exclude
+int walk_file_selected(const walk_filter_t *filter, const char *name);
+
+// Начинает обход каталога root. Возвращает 0 или номер ошибки errno.
+int walk_open(walker_t *walker, const char *root, int follow_links,
+              const walk_filter_t *filter, int suppress_errors);
+// Запускает count потоков, которые открывают и читают подкаталоги впрок,
+// пока обход до них не дошёл. Порядок обхода и ошибки те же, что без них.
+// Возвращает 0 или номер ошибки errno (обход идёт без потоков чтения).
+int walk_start_readers(walker_t *walker, int count);
+// Путь текущего файла относительно корня обхода
+const char *walk_relative_path(const walker_t *walker);
+// Следующий обычный файл: путь действителен до следующего вызова.
+// Возвращает NULL, когда обход закончен. Ошибки чтения каталогов выводятся
+// в stderr (без -s) и отмечаются в error_occurred.
+const char *walk_next(walker_t *walker);
+void walk_close(walker_t *walker);
+
+#endif
@@ -205,6 +205,92 @@ run_test_with_file "Flag -f with empty lines" "" "$TEST_DIR/patterns3.txt" "$TES
 run_test_with_file "Flag -f with -n" "-n" "$TEST_DIR/patterns1.txt" "$TEST_DIR/test1.txt" 0
 run_test_with_file "Flag -f with -c" "-c" "$TEST_DIR/patterns1.txt" "$TEST_DIR/test1.txt" 0
 
+# Шаблонов в файле больше, чем аргументов командной строки
+for i in $(seq 1 2000); do echo "id${i}x"; done > "$TEST_DIR/patterns_many.txt"
+echo "world" >> "$TEST_DIR/patterns_many.txt"
+run_test_with_file "Flag -f with many patterns" "-c" "$TEST_DIR/patterns_many.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+# -e после -f, заполнившего массив шаблонов
+echo -e "a\nb\nc\nd\ne\nf" > "$TEST_DIR/patterns_fill.txt"
+run_test_with_file "Flag -f then -e" "" "$TEST_DIR/patterns_fill.txt" "-e world -e zzz $TEST_DIR/test1.txt" 0
+
+# Набор литералов: малый (упакованный префильтр) и большой (Ахо-Корасик)
+echo -e "foo\nqux\nWORLD" > "$TEST_DIR/patterns_small.txt"
+for i in $(seq 1 50); do echo "word$i"; done > "$TEST_DIR/patterns_large.txt"
+echo -e "hello\nbaz\nline" >> "$TEST_DIR/patterns_large.txt"
+run_test_with_file "Literal set (small)" "" "$TEST_DIR/patterns_small.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+run_test_with_file "Literal set (small) with -i" "-i" "$TEST_DIR/patterns_small.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+run_test_with_file "Literal set (large)" "-n" "$TEST_DIR/patterns_large.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+run_test_with_file "Literal set (large) with -i -c" "-i -c" "$TEST_DIR/patterns_large.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+run_test_with_file "Literal set (large) with -v" "-v" "$TEST_DIR/patterns_large.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+run_test_with_file "Literal set (large) with -l" "-l" "$TEST_DIR/patterns_large.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt $TEST_DIR/test3.txt" 0
+run_test_with_file "Literal set (large) with -o" "-o" "$TEST_DIR/patterns_large.txt" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+
+# Поиск по блокам: границы строк, последняя строка без '\n', файл больше
+# блока чтения и строка длиннее блока
+printf "first\n\nmiddle line\nlast" > "$TEST_DIR/no_newline.txt"
+seq 1 100000 > "$TEST_DIR/large.txt"
+head -c 300000 /dev/zero | tr '\0' 'x' >> "$TEST_DIR/large.txt"
+echo "needle" >> "$TEST_DIR/large.txt"
+run_test "Block: empty lines with -n" "-n" "^$" "$TEST_DIR/multiline.txt" 0
+run_test "Block: last line without newline" "-n" "last$" "$TEST_DIR/no_newline.txt" 0
+run_test "Block: end anchor on every line" "-c" "$" "$TEST_DIR/no_newline.txt" 0
+run_test "Block: no match across lines" "" "e[[:space:]]*m" "$TEST_DIR/no_newline.txt" 1
+run_test "Block: -v with -n" "-v -n" "line" "$TEST_DIR/no_newline.txt" 0
+run_test "Block: large file with -n" "-n" "99999" "$TEST_DIR/large.txt" 0
+run_test "Block: line longer than block" "-n" "x*needle" "$TEST_DIR/large.txt" 0
+run_test "Block: large file with -v -c" "-v -c" "1" "$TEST_DIR/large.txt" 0
+
+# Обычные файлы читаются через mmap; S21_MMAP переключает способ чтения
+S21_GREP="S21_MMAP=0 ./s21_grep"
+run_test "Read: large file with -n" "-n" "99999" "$TEST_DIR/large.txt" 0
+run_test "Read: last line without newline" "-n" "last$" "$TEST_DIR/no_newline.txt" 0
+S21_GREP="S21_MMAP=huge ./s21_grep"
+run_test "Huge pages: line longer than block" "-n" "x*needle" "$TEST_DIR/large.txt" 0
+S21_GREP="./s21_grep"
+
+# -j: параллельный поиск по файлам, вывод должен совпадать с GNU grep
+# без -j (порядок командной строки, -c, -l и код возврата)
+run_parallel_test() {
+  local test_name="$1"
+  local flags="$2"
+  local pattern="$3"
+  local input_file="$4"
+
+  ((TEST_COUNT++))
+  echo "Running Test $TEST_COUNT: $test_name"
+  eval $S21_GREP -j 4 $flags "'$pattern'" $input_file > s21_output.txt 2> s21_error.txt
+  s21_exit_code=$?
+  eval $GNU_GREP $flags "'$pattern'" $input_file > gnu_output.txt 2> gnu_error.txt
+  gnu_exit_code=$?
+  echo "Command: $S21_GREP -j 4 $flags '$pattern' $input_file"
+  echo "s21 exit code: $s21_exit_code, gnu exit code: $gnu_exit_code"
+  if [ $s21_exit_code -eq $gnu_exit_code ] && diff -q s21_output.txt gnu_output.txt > /dev/null; then
+    echo "PASS"
+    ((SUCCESS_COUNT++))
+  else
+    echo "FAIL: Parallel output differs"
+    ((FAIL_COUNT++))
+  fi
+}
+
+PARALLEL_FILES=""
+for i in $(seq 1 24); do
+  seq $i 7 20000 > "$TEST_DIR/parallel_$i.txt"
+  PARALLEL_FILES="$PARALLEL_FILES $TEST_DIR/parallel_$i.txt"
+done
+run_parallel_test "Parallel: -n" "-n" "77" "$PARALLEL_FILES"
+run_parallel_test "Parallel: -c" "-c" "1$" "$PARALLEL_FILES"
+run_parallel_test "Parallel: -l" "-l" "^1999" "$PARALLEL_FILES"
+run_parallel_test "Parallel: no match" "" "abc" "$PARALLEL_FILES"
+run_parallel_test "Parallel: missing file" "-c" "5" "$PARALLEL_FILES nonexistent.txt"
+
+# Один большой файл (больше двух частей по 8 МБ) ищется по частям
+seq 1 3000000 > "$TEST_DIR/huge.txt"
+run_parallel_test "Parallel chunks: -n" "-n" "^2[0-9]*77$" "$TEST_DIR/huge.txt"
+run_parallel_test "Parallel chunks: -c" "-c" "5" "$TEST_DIR/huge.txt"
+run_parallel_test "Parallel chunks: -v -n" "-v -n" "[0-8]" "$TEST_DIR/huge.txt"
+run_parallel_test "Parallel chunks: -l" "-l" "2999999" "$TEST_DIR/huge.txt"
+
 # Тест -f с несуществующим файлом паттернов
 echo "Testing -f with non-existent pattern file..."
 $S21_GREP -f "nonexistent_patterns.txt" "$TEST_DIR/test1.txt" > s21_output.txt 2> s21_error.txt
@@ -228,6 +314,18 @@ run_test "Flag -o with -n" "-o -n" "hello" "$TEST_DIR/test1.txt" 0
 run_test "Flag -o with multiple files" "-o" "hello" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
 run_test "Flag -o with -h" "-o -h" "hello" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
 run_test "Flag -o with regex" "-o" "H.*o" "$TEST_DIR/test1.txt" 0
+# -o по всем шаблонам сразу: самое левое, затем самое длинное совпадение
+echo -e "abcd ab bcd\nxyz\n\nfoo.bar=12;baz=345" > "$TEST_DIR/only.txt"
+awk 'BEGIN { for (i = 0; i < 30000; i++) printf "{\"k%d\":%d},", i, i; print "" }' > "$TEST_DIR/long_line.txt"
+run_test "Flag -o overlapping patterns" "-o -e ab -e" "bcd" "$TEST_DIR/only.txt" 0
+run_test "Flag -o longest of patterns" "-o -e b -e" "abc" "$TEST_DIR/only.txt" 0
+run_test "Flag -o literal and regex" "-o -e ba -e" "[a-z][a-z]*=" "$TEST_DIR/only.txt" 0
+run_test "Flag -o empty and regular pattern" "-o -n -e d -e" "" "$TEST_DIR/only.txt" 0
+run_test "Flag -o empty match only" "-o -c" "^$" "$TEST_DIR/only.txt" 0
+run_test "Flag -o anchored after match" "-o" "^ab" "$TEST_DIR/only.txt" 0
+run_test "Flag -o long line" "-o" "k[0-9]*5\"" "$TEST_DIR/long_line.txt" 0
+run_test "Flag -o long line end anchor" "-o -c" "$" "$TEST_DIR/long_line.txt" 0
+run_test "Long line output" "-n" "k29999" "$TEST_DIR/long_line.txt $TEST_DIR/only.txt" 0
 
 # ИСПРАВЛЕНИЕ: Специальный тест для -o -v (должен не выводить ничего)
 ((TEST_COUNT++))
@@ -251,6 +349,458 @@ else
   ((FAIL_COUNT++))
 fi
 
+# Тесты для флага -F и литеральных шаблонов
+echo -e "a.b\na+b\naxb\n(x)\nprice: 5\$\nhello.world" > "$TEST_DIR/literal.txt"
+run_test "Flag -F basic" "-F" "hello" "$TEST_DIR/test1.txt" 0
+run_test "Flag -F with metacharacters" "-F" "a.b" "$TEST_DIR/literal.txt" 0
+run_test "Flag -F with dollar" "-F" "5\$" "$TEST_DIR/literal.txt" 0
+run_test "Flag -F with -i" "-F -i" "HELLO" "$TEST_DIR/test1.txt" 0
+run_test "Flag -F with -o" "-F -o" "l" "$TEST_DIR/test1.txt" 0
+run_test "Flag -F with -v -c" "-F -v -c" "(x)" "$TEST_DIR/literal.txt" 0
+run_test "Escaped metacharacter literal" "" "hello\.world" "$TEST_DIR/literal.txt" 0
+run_test "Long literal pattern" "" "hello world test line" "$TEST_DIR/test1.txt" 1
+
+# Тесты подсчёта -c: строки считаются без вывода, для -v - через '\n'
+run_test "Count large file" "-c" "9" "$TEST_DIR/large.txt" 0
+run_test "Count -v large file" "-c -v" "9" "$TEST_DIR/large.txt" 0
+run_test "Count -v no final newline" "-c -v" "line" "$TEST_DIR/no_newline.txt" 0
+run_test "Count -v all lines match" "-c -v" "" "$TEST_DIR/test1.txt" 1
+run_test "Count -v -i multiple files" "-c -v -i" "HELLO" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt $TEST_DIR/large.txt" 0
+run_parallel_test "Parallel chunks: -c -v" "-c -v" "5" "$TEST_DIR/huge.txt"
+
+# Тесты ранней остановки: -q, -m NUM и -l
+run_test "Flag -q match" "-q" "hello" "$TEST_DIR/test1.txt" 0
+run_test "Flag -q no match" "-q" "zzzz" "$TEST_DIR/test1.txt" 1
+run_test "Flag -q with -c" "-q -c" "hello" "$TEST_DIR/test1.txt" 0
+run_test "Flag -q with missing file" "-q" "hello" "nonexistent.txt $TEST_DIR/test1.txt" 0
+run_test "Flag -q large file" "-q" "needle" "$TEST_DIR/large.txt" 0
+run_test "Flag -m 1" "-m 1" "l" "$TEST_DIR/test1.txt" 0
+run_test "Flag -m with -c" "-m 2 -c" "l" "$TEST_DIR/test1.txt $TEST_DIR/test2.txt" 0
+run_test "Flag -m with -v -n" "-m 2 -v -n" "hello" "$TEST_DIR/test1.txt" 0
+run_test "Flag -m with -o" "-m 1 -o" "l" "$TEST_DIR/test1.txt" 0
+run_test "Flag -m 0" "-m 0" "hello" "$TEST_DIR/test1.txt" 1
+run_test "Flag -m negative" "-m -1" "l" "$TEST_DIR/test1.txt" 0
+run_test "Flag -m large file" "-m 3 -n" "99" "$TEST_DIR/large.txt" 0
+run_test "Flag -l large file" "-l" "1" "$TEST_DIR/large.txt" 0
+run_parallel_test "Parallel: -q" "-q" "5" "$PARALLEL_FILES"
+run_parallel_test "Parallel: -m" "-m 2" "5" "$PARALLEL_FILES"
+run_parallel_test "Parallel chunks: -m" "-m 5 -n" "77$" "$TEST_DIR/huge.txt"
+
+# Тесты фильтра по обязательному литералу: строки без литерала до regex
+# не доходят, строки с литералом проверяются regex целиком
+echo -e "ERROR db timeout=30\nERROR db retry\nINFO timeout=5\nerror x timeout=7\nERROR timeout=\nWARN ERROR late timeout=12ms\nabcabcd\nxabcx" > "$TEST_DIR/prefilter.txt"
+run_test "Required literal" "" "ERROR.*timeout=[0-9][0-9]*" "$TEST_DIR/prefilter.txt" 0
+run_test "Required literal with -i" "-i" "ERROR.*timeout=[0-9][0-9]*" "$TEST_DIR/prefilter.txt" 0
+run_test "Required literal with -v -n" "-v -n" "ERROR.*timeout=[0-9][0-9]*" "$TEST_DIR/prefilter.txt" 0
+run_test "Required literal with -o" "-o" "timeout=[0-9][0-9]*" "$TEST_DIR/prefilter.txt" 0
+run_test "Required literal with -c" "-c" "^ERROR.[a-z][a-z]*.timeout" "$TEST_DIR/prefilter.txt" 0
+run_test "Required literal not matching" "" "timeout=[a-z][a-z]*" "$TEST_DIR/prefilter.txt" 1
+run_test "Required literal after repeat" "" "abcc*d" "$TEST_DIR/prefilter.txt" 0
+run_test "Optional atoms around literal" "-o" "x*abcd*" "$TEST_DIR/prefilter.txt" 0
+run_test "Required literal large file" "-n" "^99*1[0-9]*5$" "$TEST_DIR/large.txt" 0
+
+# Тесты -i: литералы сравниваются без учёта регистра ASCII блоками по 16/32
+# байта; '@' и '`', '[' и '{' отличаются тем же битом 0x20, что и регистр
+echo -e "Request_ID=DeadBeef-0123456789-ABCDEF path=/Api\nrequest_id=deadbeef-0123456789-abcdef\nREQUEST_ID=DEADBEEF-0123456789-ABCDEX\nmail@host\nmail\`host\n[x] {x}\nxx\n" > "$TEST_DIR/icase.txt"
+run_test "Flag -i long literal" "-i" "request_id=deadbeef-0123456789-abcdef" "$TEST_DIR/icase.txt" 0
+run_test "Flag -i long literal with -o" "-i -o" "DEADBEEF-0123456789-ABCDE" "$TEST_DIR/icase.txt" 0
+run_test "Flag -i non-letters" "-i -n" "mail@" "$TEST_DIR/icase.txt" 0
+run_test "Flag -i bracket" "-i -c" "\[X" "$TEST_DIR/icase.txt" 0
+run_test "Flag -i literal set" "-i -c -e path=/api -e" "MAIL@" "$TEST_DIR/icase.txt" 0
+
+# Тесты -r/-R: порядок файлов - порядок записей каталога, как у GNU grep
+TREE="$TEST_DIR/tree"
+mkdir -p "$TREE/src/deep" "$TREE/build" "$TREE/docs"
+echo -e "int main\nreturn 0" > "$TREE/src/main.c"
+echo -e "int helper\nstatic int x" > "$TREE/src/deep/util.c"
+echo -e "int header" > "$TREE/src/deep/util.h"
+echo -e "int generated" > "$TREE/build/out.c"
+echo -e "no ints here\nint in docs" > "$TREE/docs/readme.txt"
+ln -s ../src "$TREE/docs/src_link"
+ln -s .. "$TREE/src/deep/up"
+run_test "Flag -r" "-r" "int" "$TREE" 0
+run_test "Flag -r with -n and trailing slash" "-r -n" "int" "$TREE/" 0
+run_test "Flag -r single file" "-r" "int" "$TREE/src/main.c" 0
+run_test "Flag -r with -c" "-r -c" "int" "$TREE" 0
+run_test "Flag -r with -l" "-r -l" "helper" "$TREE" 0
+run_test "Flag -r with -h -o" "-r -h -o" "int [a-z]*" "$TREE/src" 0
+run_test "Flag -r --include" "-r --include='*.c'" "int" "$TREE" 0
+run_test "Flag -r --exclude" "-r --exclude='*.c' --exclude=util.h" "int" "$TREE" 0
+run_test "Flag -r --exclude-dir" "-r --exclude-dir=build --exclude-dir='d*'" "int" "$TREE" 0
+run_test "Flag -r mixed operands" "-r" "int" "$TREE/docs $TREE/src/main.c" 0
+run_test "Flag -r no match" "-r" "nothing" "$TREE" 1
+run_test "Flag -R follows links" "-R" "helper" "$TREE/docs" 0
+run_parallel_test "Parallel: -r" "-r -n" "int" "$TREE"
+run_parallel_test "Parallel: -r -q" "-r -q" "int" "$TREE"
+for i in $(seq 1 1500); do echo "line $i" > "$TREE/docs/many_$i.txt"; done
+run_parallel_test "Parallel: -r several batches" "-r -c" "1" "$TREE/docs"
+# Подкаталогов больше WALK_AHEAD_DIRS: часть читается впрок, часть - самим
+# обходом
+for i in $(seq 1 200); do
+  mkdir -p "$TREE/wide/d$i/sub"
+  echo "int $i" > "$TREE/wide/d$i/sub/f.c"
+  echo "int top $i" > "$TREE/wide/d$i/g.c"
+done
+run_parallel_test "Parallel: -r read-ahead" "-r -n" "int" "$TREE/wide"
+run_parallel_test "Parallel: -r read-ahead --exclude-dir" "-r --exclude-dir=sub" "int" "$TREE/wide"
+
+# Тесты --binary-files: файл с NUL в первом блоке считается двоичным
+printf 'foo\0bar\nfoo baz\nqux\n' > "$TEST_DIR/binary.bin"
+run_test "Binary file with -c" "-c" "foo" "$TEST_DIR/binary.bin $TEST_DIR/test2.txt" 0
+run_test "Binary file with -I -c" "-I -c" "foo" "$TEST_DIR/binary.bin $TEST_DIR/test2.txt" 0
+run_test "Binary file with -I -l" "-I -l" "foo" "$TEST_DIR/binary.bin $TEST_DIR/test2.txt" 0
+run_test "Binary file without-match" "--binary-files=without-match" "foo" "$TEST_DIR/binary.bin" 1
+run_test "Binary file as text" "--binary-files=text -n" "foo" "$TEST_DIR/binary.bin" 0
+run_test "Binary file with -a" "-a -v" "qux" "$TEST_DIR/binary.bin" 0
+run_test "Binary file with -q" "-q" "baz" "$TEST_DIR/binary.bin" 0
+run_test "Binary file no match" "" "nothing" "$TEST_DIR/binary.bin" 1
+run_test "Binary file unknown type" "--binary-files=data" "foo" "$TEST_DIR/binary.bin" 2
+
+# Тесты --index: поиск по индексу должен совпадать с полным поиском -r,
+# в том числе для файлов, изменённых или добавленных после построения
+run_index_test() {
+  local test_name="$1"
+  local flags="$2"
+  local pattern="$3"
+  local dir="$4"
+  local s21_flags="$5"
+
+  ((TEST_COUNT++))
+  echo "Running Test $TEST_COUNT: $test_name"
+  eval $S21_GREP --index $s21_flags $flags "'$pattern'" $dir > s21_output.txt 2> s21_error.txt
+  s21_exit_code=$?
+  eval $GNU_GREP -r --exclude=.s21_grep_index $flags "'$pattern'" $dir > gnu_output.txt 2> gnu_error.txt
+  gnu_exit_code=$?
+  echo "Command: $S21_GREP --index $s21_flags $flags '$pattern' $dir"
+  echo "s21 exit code: $s21_exit_code, gnu exit code: $gnu_exit_code"
+  if [ $s21_exit_code -eq $gnu_exit_code ] && diff -q s21_output.txt gnu_output.txt > /dev/null; then
+    echo "PASS"
+    ((SUCCESS_COUNT++))
+  else
+    echo "FAIL: Indexed output differs"
+    ((FAIL_COUNT++))
+  fi
+}
+
+INDEXED="$TEST_DIR/indexed"
+mkdir -p "$INDEXED/2023" "$INDEXED/2024"
+for i in $(seq 1 40); do
+  seq $i 13 3000 | sed "s/^/id=/" > "$INDEXED/2023/app_$i.log"
+done
+echo -e "ERROR db timeout=30\nINFO ok" > "$INDEXED/2024/db.log"
+echo -e "Request_ID=DeadBeef\nWARN disk" > "$INDEXED/2024/api.log"
+$S21_GREP --build-index "$INDEXED"
+run_index_test "Index: literal" "-n" "id=2999" "$INDEXED"
+run_index_test "Index: required literal" "" "ERROR.*timeout=[0-9]" "$INDEXED"
+run_index_test "Index: -i" "-i" "request_id=deadbeef" "$INDEXED"
+run_index_test "Index: several patterns -l" "-l -e id=1234 -e" "WARN" "$INDEXED"
+run_index_test "Index: no literal" "-c" "^[0-9]" "$INDEXED"
+run_index_test "Index: no match" "" "id=99999" "$INDEXED"
+run_index_test "Index: -v" "-v -l" "id=" "$INDEXED"
+echo "id=99999 appended" >> "$INDEXED/2023/app_7.log"
+echo "id=99999 new" > "$INDEXED/2024/new.log"
+run_index_test "Index: changed and new files" "-n" "id=99999" "$INDEXED"
+run_index_test "Index: -j" "-n" "id=29" "$INDEXED" "-j 3"
+# Пропускаются только сам индекс и его временный файл, а не все файлы с
+# тем же началом имени
+echo "id=99999 backup" > "$INDEXED/.s21_grep_index.bak"
+$S21_GREP --build-index "$INDEXED"
+run_index_test "Index: file named like the index" "-n" "id=99999" "$INDEXED"
+
+# Тесты --state-file: каждый запуск ищет только строки, дописанные после
+# прошлого. Ожидаемый вывод - GNU grep по одним новым строкам.
+run_state_test() {
+  local test_name="$1"
+  local command="$2"
+  local expected="$3"
+
+  ((TEST_COUNT++))
+  echo "Running Test $TEST_COUNT: $test_name"
+  eval $S21_GREP --state-file "$STATE" $command > s21_output.txt 2> s21_error.txt
+  eval $expected > gnu_output.txt 2> gnu_error.txt
+  echo "Command: $S21_GREP --state-file $STATE $command"
+  if diff -q s21_output.txt gnu_output.txt > /dev/null; then
+    echo "PASS"
+    ((SUCCESS_COUNT++))
+  else
+    echo "FAIL: Incremental output differs"
+    ((FAIL_COUNT++))
+  fi
+}
+
+STATE="$TEST_DIR/grep.state"
+LOG="$TEST_DIR/app.log"
+seq 1 5000 | sed "s/^/event /" > "$LOG"
+seq 5001 5100 | sed "s/^/event /" > "$TEST_DIR/appended.txt"
+run_state_test "State: first run" "-c 7 $LOG" "$GNU_GREP -c 7 $LOG"
+cat "$TEST_DIR/appended.txt" >> "$LOG"
+run_state_test "State: appended lines" "-c 7 $LOG" "$GNU_GREP -c 7 $TEST_DIR/appended.txt"
+run_state_test "State: nothing new" "-c 7 $LOG" "echo 0"
+printf 'event 5101 7\nevent 51' >> "$LOG"
+run_state_test "State: line numbers continue" "-n 7 $LOG" "$GNU_GREP -n 7 $LOG | tail -n 1"
+printf '02 7\n' >> "$LOG"
+run_state_test "State: completed last line" "-n 7 $LOG" "echo 5102:event 5102 7"
+seq 1 10 | sed "s/^/event /" > "$LOG"
+run_state_test "State: truncated file" "-c 1 $LOG" "$GNU_GREP -c 1 $LOG"
+echo "event 11 after rotation" >> "$LOG"
+mv "$LOG" "$LOG.1"
+echo "event 1 new file" > "$LOG"
+run_state_test "State: rotated file" "-h event $LOG $LOG.1" "echo event 1 new file; echo event 11 after rotation"
+# Новый файл под тем же именем (inode может достаться ему же) и файл,
+# усечённый на месте и дописанный дальше прежнего смещения: поиск с начала
+printf 'old entry\n' > "$LOG"
+run_state_test "State: before recreate" "-n MATCH $LOG" "true"
+rm "$LOG"
+printf 'MATCH new1\nMATCH new2\nMATCH new3\n' > "$LOG"
+run_state_test "State: recreated file" "-n MATCH $LOG" "$GNU_GREP -n MATCH $LOG"
+: > "$LOG"
+printf 'MATCH again1\nMATCH again2\nMATCH again3\nMATCH again4\n' >> "$LOG"
+run_state_test "State: truncated and regrown" "-n MATCH $LOG" "$GNU_GREP -n MATCH $LOG"
+
+# Тесты --follow: s21_grep следит за файлами в фоне, пока в них дописывают
+# строки, и завершается по SIGTERM. Ожидаемый вывод - GNU grep по одним
+# дописанным строкам. Вместо пауз тесты ждут условий, не дольше 5 секунд.
+
+# Ждёт, пока процесс $1 не заснёт в poll(): файлы открыты и просмотрены
+wait_follow_ready() {
+  for _ in $(seq 1 100); do
+    grep -q poll "/proc/$1/wchan" 2> /dev/null && return
+    sleep 0.05
+  done
+}
+
+# Ждёт, пока в s21_output.txt не станет хотя бы $1 строк
+wait_output_lines() {
+  for _ in $(seq 1 100); do
+    [ "$(wc -l < s21_output.txt)" -ge "$1" ] && return
+    sleep 0.05
+  done
+}
+
+# Ждёт, пока s21_output.txt не совпадёт с gnu_output.txt
+wait_output_expected() {
+  for _ in $(seq 1 100); do
+    diff -q s21_output.txt gnu_output.txt > /dev/null && return
+    sleep 0.05
+  done
+}
+
+run_follow_test() {
+  local test_name="$1"
+  local command="$2"
+  local actions="$3"
+  local expected="$4"
+
+  ((TEST_COUNT++))
+  echo "Running Test $TEST_COUNT: $test_name"
+  eval exec $S21_GREP --follow $command > s21_output.txt 2> s21_error.txt &
+  local pid=$!
+  wait_follow_ready $pid
+  eval "$actions"
+  eval $expected > gnu_output.txt 2> gnu_error.txt
+  wait_output_expected
+  kill $pid 2> /dev/null
+  wait $pid
+  echo "Command: $S21_GREP --follow $command"
+  if diff -q s21_output.txt gnu_output.txt > /dev/null; then
+    echo "PASS"
+    ((SUCCESS_COUNT++))
+  else
+    echo "FAIL: Followed output differs"
+    ((FAIL_COUNT++))
+  fi
+}
+
+FOLLOWED="$TEST_DIR/followed.log"
+OTHER="$TEST_DIR/other.log"
+seq 1 1000 | sed "s/^/event /" > "$FOLLOWED"
+seq 1001 1100 | sed "s/^/event /" > "$TEST_DIR/appended.txt"
+run_follow_test "Follow: appended lines" "-n 7 $FOLLOWED" \
+  "cat $TEST_DIR/appended.txt >> $FOLLOWED" \
+  "$GNU_GREP -n 7 $FOLLOWED | awk -F: '\$1 > 1000'"
+run_follow_test "Follow: completed last line" "5 $FOLLOWED" \
+  "printf 'event 1101 5\\nevent 11' >> $FOLLOWED; wait_output_lines 1; printf '02 5\\n' >> $FOLLOWED" \
+  "printf 'event 1101 5\\nevent 1102 5\\n'"
+echo "event 1" > "$OTHER"
+run_follow_test "Follow: rotation and truncation" "event $FOLLOWED $OTHER" \
+  "mv $FOLLOWED $FOLLOWED.1; echo 'event new file' > $FOLLOWED; wait_output_lines 1; echo 'event 2' > $OTHER" \
+  "echo $FOLLOWED:event new file; echo $OTHER:event 2"
+# Строки, дописанные в файл прямо перед ротацией и после неё в старый
+# файл, не теряются: старый файл дочитывается до перехода на новый
+run_follow_test "Follow: lines around rotation" "-h event $FOLLOWED" \
+  "echo 'event before' >> $FOLLOWED; mv $FOLLOWED $FOLLOWED.2; echo 'event after rename' >> $FOLLOWED.2; echo 'event rotated' > $FOLLOWED" \
+  "printf 'event before\\nevent after rename\\nevent rotated\\n'"
+rm -f "$OTHER"
+run_follow_test "Follow: file created later" "-s event $OTHER $FOLLOWED" \
+  "echo 'event created' > $OTHER" "echo $OTHER:event created"
+run_follow_test "Follow: -m per file" "-m 2 -h event $FOLLOWED" \
+  "seq 1 5 | sed 's/^/event /' >> $FOLLOWED" "printf 'event 1\\nevent 2\\n'"
+
+# -q завершает слежение на первом совпадении
+((TEST_COUNT++))
+echo "Running Test $TEST_COUNT: Follow: -q exits on match"
+$S21_GREP --follow -q needle "$FOLLOWED" &
+follow_pid=$!
+wait_follow_ready $follow_pid
+echo "needle" >> "$FOLLOWED"
+for _ in $(seq 1 100); do
+  kill -0 $follow_pid 2> /dev/null || break
+  sleep 0.05
+done
+if kill $follow_pid 2> /dev/null; then
+  wait $follow_pid
+  s21_exit_code=1
+else
+  wait $follow_pid
+  s21_exit_code=$?
+fi
+echo "Command: $S21_GREP --follow -q needle $FOLLOWED"
+if [ $s21_exit_code -eq 0 ]; then
+  echo "PASS"
+  ((SUCCESS_COUNT++))
+else
+  echo "FAIL: --follow -q did not exit with 0"
+  ((FAIL_COUNT++))
+fi
+
+((TEST_COUNT++))
+echo "Running Test $TEST_COUNT: Follow: standard input rejected"
+echo event | $S21_GREP --follow event > s21_output.txt 2> s21_error.txt
+s21_exit_code=$?
+echo "Command: echo event | $S21_GREP --follow event"
+if [ $s21_exit_code -eq 2 ] && [ -s s21_error.txt ]; then
+  echo "PASS"
+  ((SUCCESS_COUNT++))
+else
+  echo "FAIL: --follow without FILE should fail"
+  ((FAIL_COUNT++))
+fi
+
+# libs21grep: программа на библиотеке выводит каждое совпадение как
+# grep -n -b -o (номер строки, смещение совпадения, совпадение)
+cat > "$TEST_DIR/lib_consumer.c" << 'EOF'
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "s21_grep_lib.h"
+
+// Внутренние функции библиотеки не видны: такое же имя в программе не
+// конфликтует с ними при сборке
+int process_file(const char *name) { return name != NULL; }
+
+static int print_match(void *context, const s21grep_match_t *match) {
+  int *limit = context;
+  printf("%zu:%llu:%.*s\n", match->line_number,
+         (unsigned long long)(match->offset + match->match_start),
+         (int)(match->match_end - match->match_start),
+         match->line + match->match_start);
+  return *limit > 0 && --*limit == 0;
+}
+
+// lib_consumer buffer|fd FLAGS LIMIT FILE PATTERN...
+int main(int argc, char *argv[]) {
+  if (argc < 6) return 2;
+  int flags = (strchr(argv[2], 'i') ? S21GREP_IGNORE_CASE : 0) |
+              (strchr(argv[2], 'F') ? S21GREP_FIXED_STRINGS : 0);
+  int limit = atoi(argv[3]);
+  char error[128];
+  s21grep_t *grep = s21grep_compile((const char *const *)argv + 5, argc - 5,
+                                    flags, error, sizeof(error));
+  if (!grep) {
+    fprintf(stderr, "lib_consumer: %s\n", error);
+    return 2;
+  }
+  int fd = open(argv[4], O_RDONLY);
+  int matched = -1;
+  if (fd >= 0 && strcmp(argv[1], "fd") == 0) {
+    matched = s21grep_scan_fd(grep, fd, print_match, &limit);
+  } else if (fd >= 0) {
+    static char data[1 << 22];
+    ssize_t length = read(fd, data, sizeof(data));
+    if (length >= 0) {
+      matched = s21grep_scan_buffer(grep, data, (size_t)length, print_match,
+                                    &limit);
+    }
+  }
+  if (fd >= 0) close(fd);
+  s21grep_free(grep);
+  return matched > 0 ? 0 : matched == 0 ? 1 : 2;
+}
+EOF
+gcc -Wall -Wextra -Werror -std=c11 -D_GNU_SOURCE -pthread -I. \
+  -o "$TEST_DIR/lib_consumer" "$TEST_DIR/lib_consumer.c" libs21grep.a
+
+run_lib_test() {
+  local test_name="$1"
+  local command="$2"
+  local expected="$3"
+
+  ((TEST_COUNT++))
+  echo "Running Test $TEST_COUNT: $test_name"
+  eval "$TEST_DIR/lib_consumer" $command > s21_output.txt 2> s21_error.txt
+  eval $expected > gnu_output.txt 2> gnu_error.txt
+  echo "Command: lib_consumer $command"
+  if diff -q s21_output.txt gnu_output.txt > /dev/null; then
+    echo "PASS"
+    ((SUCCESS_COUNT++))
+  else
+    echo "FAIL: Library matches differ"
+    ((FAIL_COUNT++))
+  fi
+}
+
+LIB_INPUT="$TEST_DIR/lib_input.txt"
+printf 'foo bar foo\nnothing\nFOO\nbarfoo\nlast foo' > "$LIB_INPUT"
+run_lib_test "Library: buffer" "buffer - 0 $LIB_INPUT foo" \
+  "$GNU_GREP -n -b -o foo $LIB_INPUT"
+run_lib_test "Library: fd" "fd - 0 $LIB_INPUT foo bar" \
+  "$GNU_GREP -n -b -o -e foo -e bar $LIB_INPUT"
+run_lib_test "Library: -i -F" "fd iF 0 $LIB_INPUT 'o b' FOO" \
+  "$GNU_GREP -n -b -o -i -F -e 'o b' -e FOO $LIB_INPUT"
+run_lib_test "Library: callback stops scan" "buffer - 3 $LIB_INPUT foo" \
+  "$GNU_GREP -n -b -o foo $LIB_INPUT | head -n 3"
+seq 1 200000 | sed "s/^/line /" > "$TEST_DIR/lib_big.txt"
+run_lib_test "Library: offsets across read blocks" \
+  "fd - 0 $TEST_DIR/lib_big.txt 'line 19999[0-9]'" \
+  "$GNU_GREP -n -b -o 'line 19999[0-9]' $TEST_DIR/lib_big.txt"
+run_lib_test "Library: offsets in buffer" \
+  "buffer - 0 $TEST_DIR/lib_big.txt 'line 19999[0-9]'" \
+  "$GNU_GREP -n -b -o 'line 19999[0-9]' $TEST_DIR/lib_big.txt"
+run_lib_test "Library: compile error text" \
+  "buffer - 0 $LIB_INPUT foo 'a(' 2>&1; echo \$?" \
+  "printf 'lib_consumer: invalid pattern\\n2\\n'"
+
+# Из архива видны только функции s21grep_*
+((TEST_COUNT++))
+echo "Running Test $TEST_COUNT: Library exports only s21grep_*"
+exported=$(nm -g --defined-only libs21grep.a | awk 'NF == 3 && $3 !~ /^s21grep_/')
+if [ -z "$exported" ]; then
+  echo "PASS"
+  ((SUCCESS_COUNT++))
+else
+  echo "FAIL: Library exports internal symbols:"
+  echo "$exported" | head -5
+  ((FAIL_COUNT++))
+fi
+
+# Вместо строк двоичного файла - одно сообщение после первого совпадения
+((TEST_COUNT++))
+echo "Running Test $TEST_COUNT: Binary file matches message"
+$S21_GREP -n "foo" "$TEST_DIR/binary.bin" "$TEST_DIR/test2.txt" > s21_output.txt 2> s21_error.txt
+s21_exit_code=$?
+printf 'Binary file %s matches\n%s:1:foo bar\n' "$TEST_DIR/binary.bin" "$TEST_DIR/test2.txt" > gnu_output.txt
+echo "Command: $S21_GREP -n foo $TEST_DIR/binary.bin $TEST_DIR/test2.txt"
+if [ $s21_exit_code -eq 0 ] && diff -q s21_output.txt gnu_output.txt > /dev/null; then
+  echo "PASS"
+  ((SUCCESS_COUNT++))
+else
+  echo "FAIL: Binary file message differs"
+  ((FAIL_COUNT++))
+fi
+
 echo ""
 echo "=== COMPLEX COMBINATION TESTS ==="
 
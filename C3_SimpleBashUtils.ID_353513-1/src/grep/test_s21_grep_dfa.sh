@@ -0,0 +1,122 @@
+#!/bin/bash
+
+# Сравнение встроенного ДКА с regexec(): один и тот же s21_grep запускается
+# с S21_GREP_ENGINE=regex (POSIX regex из libc) и S21_GREP_ENGINE=dfa
+S21_GREP="./s21_grep"
+TEST_DIR="test_files_dfa"
+
+mkdir -p $TEST_DIR
+
+# Счетчик тестов
+TEST_COUNT=0
+SUCCESS_COUNT=0
+FAIL_COUNT=0
+
+# Функция для запуска теста: вывод и код возврата обоих движков должны
+# совпасть
+run_engine_test() {
+  local flags="$1"
+  local pattern="$2"
+  local input_file="$3"
+
+  ((TEST_COUNT++))
+  S21_GREP_ENGINE=regex $S21_GREP $flags "$pattern" $input_file > regex_output.txt 2>&1
+  regex_exit_code=$?
+  S21_GREP_ENGINE=dfa $S21_GREP $flags "$pattern" $input_file > dfa_output.txt 2>&1
+  dfa_exit_code=$?
+  if [ $regex_exit_code -eq $dfa_exit_code ] && diff -q regex_output.txt dfa_output.txt > /dev/null; then
+    ((SUCCESS_COUNT++))
+  else
+    echo "FAIL: $S21_GREP $flags '$pattern' $input_file"
+    echo "regex exit code: $regex_exit_code, dfa exit code: $dfa_exit_code"
+    diff regex_output.txt dfa_output.txt | head -10
+    ((FAIL_COUNT++))
+  fi
+}
+
+# Тестовые файлы
+cat > "$TEST_DIR/text.txt" << 'EOF'
+abc
+foo bar
+
+AAbcd
+foobarbaz
+barbaz x
+12 345 6
+]a
+\back
+}{
+abcd ab abcbcd
+xyz zz y
+2026-10-17 12:00:01 host1 INFO request_id=91b7584a path=/api/v1/items status=200 took=1ms
+2026-10-17 12:00:02 host2 WARN request_id=0f3c2e11 path=/api/v2/orders status=503 took=250ms
+2026-10-17 12:00:03 host3 ERROR request_id=deadbeef path=/api/v1/users status=404 took=12ms
+	tab	separated	line
+MiXeD CaSe Line
+EOF
+printf 'last line without newline abc' >> "$TEST_DIR/text.txt"
+
+# Строки из a и b: длинные повторы {n} дают больше состояний, чем помещается
+# в кэш ДКА, и проверяют его сброс
+awk 'BEGIN { srand(21); for (i = 0; i < 3000; i++) { n = int(rand() * 40); s = ""; for (j = 0; j < n; j++) s = s (rand() < 0.5 ? "a" : "b"); print s } }' > "$TEST_DIR/ab.txt"
+
+PATTERNS=(
+  'a.c' '^$' 'x$' '^[0-9]+' 'a|b' '(ab)+' 'o{2}' 'fo{1,2}' 'o{0}b'
+  '[[:upper:]]' '[[:digit:]]{2,}' '[[:space:]]' '[^a-z]' '[A-Z]' '[]a]'
+  '[^]a]' '[a-]' '[\]' '}' '\.' '\/' 'a*' 'x*y*z*' '(a*)*' '^' '$'
+  '^.*$' '.' '..' '(a|ab)(c|bcd)' '(^a|b$)' '^(foo|bar)baz'
+  'status=[45][0-9]{2}' 'took=[0-9]+ms$' '(INFO|WARN).*/api/v[12]'
+  'request_id=[a-f0-9]{8}' '[^ ]+ [^ ]+ [A-Z]{4,5}' 'abc$' 'c$'
+  'a(b|c)*d' 'case line' '\w+' '(a)\1' 'a{,2}' '(^a)+b' '(b|c$)*'
+)
+FLAGS=("" "-o" "-c" "-v" "-i" "-n" "-o -i" "-c -v -i")
+
+for pattern in "${PATTERNS[@]}"; do
+  for flags in "${FLAGS[@]}"; do
+    run_engine_test "$flags" "$pattern" "$TEST_DIR/text.txt"
+  done
+done
+
+for pattern in '(a|b)*a(a|b){12}$' 'a(a|b){11}b' '^(ab|ba)*$' 'b{3,5}a{2}' \
+    '(a|b)*a(a|b){9}(a|b)*$'; do
+  for flags in "-c" "-o" "-n" "-c -v"; do
+    run_engine_test "$flags" "$pattern" "$TEST_DIR/ab.txt"
+  done
+done
+
+# -o на длинной строке: самое левое совпадение ищется за один проход, а не
+# от каждой позиции до ближайшего конца совпадения
+awk 'BEGIN { s = ""; for (i = 0; i < 2000; i++) s = s "a"; print s "b"; print "x" s "c" }' > "$TEST_DIR/long.txt"
+for pattern in 'a*c|b' '(a|b)+b|c' 'x?a+(c|d)'; do
+  run_engine_test "-o" "$pattern" "$TEST_DIR/long.txt"
+done
+
+((TEST_COUNT++))
+awk 'BEGIN { s = ""; for (i = 0; i < 80000; i++) s = s "a"; print s "b" }' > "$TEST_DIR/long_b.txt"
+only_output=$(S21_GREP_ENGINE=dfa timeout 5 $S21_GREP -o 'a*c|b' "$TEST_DIR/long_b.txt")
+if [ $? -eq 0 ] && [ "$only_output" = "b" ]; then
+  ((SUCCESS_COUNT++))
+else
+  echo "FAIL: $S21_GREP -o 'a*c|b' $TEST_DIR/long_b.txt (timeout or wrong output)"
+  ((FAIL_COUNT++))
+fi
+
+# Результаты
+echo "--------------------------------"
+echo "Total tests: $TEST_COUNT"
+echo "Passed: $SUCCESS_COUNT"
+echo "Failed: $FAIL_COUNT"
+
+if [ $FAIL_COUNT -eq 0 ]; then
+  echo "ALL TESTS PASSED!"
+  exit_code=0
+else
+  echo "SOME TESTS FAILED!"
+  exit_code=1
+fi
+
+# Очистка
+rm -f regex_output.txt dfa_output.txt
+rm -rf $TEST_DIR
+
+exit $exit_code